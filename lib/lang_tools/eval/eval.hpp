@@ -5,7 +5,10 @@
 #ifndef LANG_TOOLS_EVAL_HPP
 #define LANG_TOOLS_EVAL_HPP
 
+#include <functional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "result/Result.hpp"
 
@@ -19,8 +22,61 @@ namespace lang_tools
     template <typename Term>
     using Context = std::unordered_map<std::string, Term>;
 
+    /**
+     * What a REPL keeps between inputs. Evaluators borrow it for the length
+     * of one call, so what a call costs doesn't depend on how much has been
+     * defined.
+     */
+    template <typename Term>
+    class Session
+    {
+    public:
+        using Listener = std::function<void(const std::string&, const Term&)>;
+
+        auto context() const -> const Context<Term>&
+        {
+            return definitions;
+        }
+
+        // told of each definition as it is added or replaced, so that what
+        // is built from the definitions is kept up to date as they change
+        // rather than rebuilt from all of them for each input
+        auto on_define(Listener listener) -> void
+        {
+            listeners.push_back(std::move(listener));
+        }
+
+        // existing definitions win over those in the merged context
+        auto load(Context<Term> more) -> void
+        {
+            for (auto& [name, term] : more)
+            {
+                auto [definition, added] {definitions.try_emplace(name, std::move(term))};
+                if (added)
+                    notify(definition->first, definition->second);
+            }
+        }
+
+        // replaces any existing definition of the name
+        auto define(const std::string& name, Term term) -> void
+        {
+            auto definition {definitions.insert_or_assign(name, std::move(term)).first};
+            notify(definition->first, definition->second);
+        }
+
+    private:
+        Context<Term> definitions {};
+        std::vector<Listener> listeners {};
+
+        auto notify(const std::string& name, const Term& term) const -> void
+        {
+            for (const Listener& listener : listeners)
+                listener(name, term);
+        }
+    };
+
     template <typename Value, typename Term>
-    using Evaluator = std::function<EvalResult<Value>(Term, Context<Term>)>;
+    using Evaluator = std::function<EvalResult<Value>(const Term&, const Session<Term>&)>;
 }
 
 #endif //LANG_TOOLS_EVAL_HPP
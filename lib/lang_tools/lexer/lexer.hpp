@@ -6,70 +6,97 @@
 #define LANG_TOOLS_LEX_H
 
 #include <functional>
+#include <iostream>
 #include <optional>
 #include <string>
 #include <stdexcept>
 
-#include "result/Result.hpp"
-
 
 namespace lang_tools
 {
 
     using LexErr = std::string;
 
+    /**
+     * A lexer reads the next token from the stream into the token it is
+     * given, reusing whatever storage that token already has, and returns
+     * nothing on success or why it couldn't. Any callable with that shape
+     * works; the token iterators take its type as a parameter so that the
+     * calls can be inlined. This alias is for when a lexer has to be chosen
+     * at runtime.
+     */
     template <typename Token>
-    using LexResult = result::Result<Token, LexErr>;
-
-    template <typename Token>
-    using Lexer = std::function<LexResult<Token>(std::istream&)>;
+    using Lexer = std::function<std::optional<LexErr>(std::istream&, Token&)>;
 
-    template<typename Token>
+    template<typename Token, typename Lex = Lexer<Token>>
     class token_iterator
     {
     public:
         // TODO: what should difference_type be?
         using difference_type = std::ptrdiff_t;
-        using value_type = LexResult<Token>;
-        using reference = LexResult<Token>&;
-        using pointer = LexResult<Token>*;
+        using value_type = Token;
+        using reference = Token&;
+        using pointer = Token*;
         using iterator_category = std::input_iterator_tag;
 
         token_iterator() = default;
-        token_iterator(Lexer<Token> reader, std::istream& source);
-        token_iterator(Lexer<Token> reader, std::istream&& source) = delete;
+        token_iterator(const Lex& reader, std::istream& source);
+        token_iterator(const Lex& reader, std::istream&& source) = delete;
 
-        template <typename T>
-        friend auto operator ==(const token_iterator<T>& lhs, const token_iterator<T>& rhs) -> bool;
+        template <typename T, typename L>
+        friend auto operator ==(const token_iterator<T, L>& lhs, const token_iterator<T, L>& rhs) -> bool;
 
-        template <typename T>
-        friend auto operator !=(const token_iterator<T>& lhs, const token_iterator<T>& rhs) -> bool;
+        template <typename T, typename L>
+        friend auto operator !=(const token_iterator<T, L>& lhs, const token_iterator<T, L>& rhs) -> bool;
 
         auto operator ++()    -> token_iterator&;
         auto operator ++(int) -> token_iterator;
-        auto operator  *()    -> LexResult<Token>&;
-        auto operator ->()    -> LexResult<Token>*;
+        auto operator  *()    -> Token&;
+        auto operator ->()    -> Token*;
 
-        auto read_next() -> LexResult<Token>&;
+        // why the current token couldn't be read, if it couldn't
+        auto error() const -> const std::optional<LexErr>&
+        {
+            return failure;
+        }
+
+        auto read_next() -> token_iterator&;
 
     private:
+        // both null once the source runs out; the lexer is borrowed, not copied
+        const Lex* reader {nullptr};
+        std::istream* source {nullptr};
+
+        Token current {};
+        std::optional<LexErr> failure {};
+    };
 
-        struct data_t
+    /**
+     * The tokens of a stream, for use in a range-based for. Check the
+     * iterator's error() before using a token, so use an explicit loop when
+     * the input may not lex.
+     */
+    template<typename Token, typename Lex = Lexer<Token>>
+    class token_range
+    {
+    public:
+        token_range(const Lex& reader, std::istream& source)
+            : reader {reader}, source {source}
+        {}
+
+        auto begin() const -> token_iterator<Token, Lex>
+        {
+            return token_iterator<Token, Lex>(reader, source);
+        }
+
+        auto end() const -> token_iterator<Token, Lex>
         {
-        public:
-            const Lexer<Token> reader;
-            std::istream& source;
-            LexResult<Token> current;
-            data_t(Lexer<Token> reader, std::istream& source)
-                : reader {reader}, source {source}, current {reader(source)}
-            {}
-        };
-
-        std::optional<data_t> data {};
-
-        auto unsafe_get_current() -> LexResult<Token>&;
-        auto unsafe_get_reader()  -> const Lexer<Token>&;
-        auto unsafe_get_source()  -> std::istream&;
+            return token_iterator<Token, Lex>();
+        }
+
+    private:
+        const Lex& reader;
+        std::istream& source;
     };
 
 
@@ -77,90 +104,72 @@ namespace lang_tools
     /////   Operators
     ////////////////////////////////////////////////////////////////////////
 
-    template<typename T>
-    auto operator!=(const token_iterator<T>& lhs, const token_iterator<T>& rhs) -> bool
+    template<typename T, typename L>
+    auto operator!=(const token_iterator<T, L>& lhs, const token_iterator<T, L>& rhs) -> bool
     {
         // ending condition is that one is null
         // TODO: check this against how istream_iterator != is implemented
         return !(lhs == rhs);
     }
 
-    template<typename Token>
-    auto token_iterator<Token>::operator++() -> token_iterator&
+    template<typename Token, typename Lex>
+    auto token_iterator<Token, Lex>::operator++() -> token_iterator&
     {
-        read_next();
-        return *this;
+        return read_next();
     }
 
-    template<typename Token>
-    auto token_iterator<Token>::operator++(int) -> token_iterator
+    template<typename Token, typename Lex>
+    auto token_iterator<Token, Lex>::operator++(int) -> token_iterator
     {
         token_iterator copy = *this;
         read_next();
-        return std::move(copy);
+        return copy;
     }
 
-    template<typename Token>
-    auto token_iterator<Token>::read_next() -> LexResult<Token>&
+    template<typename Token, typename Lex>
+    auto token_iterator<Token, Lex>::read_next() -> token_iterator&
     {
-        LexResult<Token>& current = unsafe_get_current();
-        const Lexer<Token>& reader = unsafe_get_reader();
-        std::istream& source = unsafe_get_source();
-        if (source.peek() < 0)
-            data.reset();
+        if (source == nullptr || source->peek() < 0)
+        {
+            reader = nullptr;
+            source = nullptr;
+        }
         else
-            current = reader(source);
-        return current;
+            failure = (*reader)(*source, current);
+        return *this;
     }
 
     /**
      * @tparam Token    The type of token the lexer produces.
-     * @return          A reference to the last extracted token.
+     * @return          A reference to the last extracted token. It holds
+     *                  nothing meaningful if error() is set.
      * @throws          std::out_of_range if no token is available.
      */
-    template<typename Token>
-    auto token_iterator<Token>::operator*() -> LexResult<Token>&
+    template<typename Token, typename Lex>
+    auto token_iterator<Token, Lex>::operator*() -> Token&
     {
-        if (!(data.has_value()))
+        if (source == nullptr)
             throw std::out_of_range("no result available");
-        return unsafe_get_current();
+        return current;
     }
 
-    template<typename Token>
-    auto token_iterator<Token>::operator->() -> LexResult<Token>*
+    template<typename Token, typename Lex>
+    auto token_iterator<Token, Lex>::operator->() -> Token*
     {
-        return &(unsafe_get_current());
+        return &current;
     }
 
-    template<typename T>
-    auto operator ==(const token_iterator<T>& lhs, const token_iterator<T>& rhs) -> bool
+    template<typename T, typename L>
+    auto operator ==(const token_iterator<T, L>& lhs, const token_iterator<T, L>& rhs) -> bool
     {
-        return bool(lhs.data) == bool(rhs.data);
+        return (lhs.source == nullptr) == (rhs.source == nullptr);
     }
 
-    template<typename Token>
-    token_iterator<Token>::token_iterator(Lexer<Token> reader, std::istream& source)
-        : data { std::in_place, reader, source }
+    template<typename Token, typename Lex>
+    token_iterator<Token, Lex>::token_iterator(const Lex& reader, std::istream& source)
+        : reader {&reader}, source {&source}, failure {reader(source, current)}
     {}
 
-    template<typename Token>
-    auto token_iterator<Token>::unsafe_get_current() -> LexResult<Token>&
-    {
-        return data.value().current;
-    }
-
-    template<typename Token>
-    auto token_iterator<Token>::unsafe_get_reader() -> const Lexer<Token>&
-    {
-        return data.value().reader;
-    }
-
-    template<typename Token>
-    auto token_iterator<Token>::unsafe_get_source() -> std::istream&
-    {
-        return data.value().source;
-    }
-
 }
 
 #endif //LANG_TOOLS_LEX_H
@@ -18,6 +18,7 @@ namespace lang_tools
     template <typename Term>
     using ParseResult = result::Result<Term, ParseErr>;
 
+    // parsers consume their tokens, so callers should move the queue in
     template <typename Term, typename Token>
     using Parser = std::function<ParseResult<Term>(std::queue<Token>)>;
 
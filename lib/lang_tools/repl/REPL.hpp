@@ -20,13 +20,13 @@
 
 namespace lang_tools
 {
-    template <typename Token, typename Term, typename Value>
+    template <typename Token, typename Term, typename Value, typename Lex = Lexer<Token>>
     class REPL {
     public:
 
         // constructors
         REPL() = delete;
-        REPL(Lexer<Token> lexer,
+        REPL(Lex lexer,
                 Parser<Term, Token> parser,
                 Evaluator<Value, Term> evaluator);
 
@@ -64,18 +64,24 @@ namespace lang_tools
 
         auto load_context(Context<Term> ctxt) -> REPL&;
 
+        // see Session::on_define
+        auto on_define(typename Session<Term>::Listener listener) -> REPL&;
+
+        // registers (or replaces) a command matched against the whole input line
+        auto add_command(const std::string& name, typename Command::op_type operation) -> REPL&;
+
     private:
         // in and out streams
         std::ostream& out {std::cout};
         std::istream& in {std::cin};
 
         // components
-        Lexer<Token> lexer;
+        Lex lexer;
         Parser<Term, Token> parser;
         Evaluator<Value, Term> evaluator;
 
-        // context
-        std::unordered_map<std::string, Term> context {};
+        // definitions, lent to the evaluator for each input
+        Session<Term> session {};
 
         // messages
         std::string prompt {"> "};
@@ -118,29 +124,10 @@ namespace lang_tools
         auto goodbye() const -> void;
         auto exit() -> void;
 
-        struct token_stream
-        {
-            REPL& owner;
-            std::istream& in;
-
-            explicit token_stream(REPL& owner, std::istream& in)
-                : owner { owner }, in { in } {}
-
-            auto begin() -> token_iterator<Token>
-            {
-                return token_iterator<Token>(owner.lexer, in);
-            }
-
-            auto end() -> token_iterator<Token>
-            {
-                return token_iterator<Token>();
-            }
-        };
-
     };
 
-    template <typename Token, typename Term, typename Value>
-    auto REPL<Token, Term, Value>::run() -> void
+    template <typename Token, typename Term, typename Value, typename Lex>
+    auto REPL<Token, Term, Value, Lex>::run() -> void
     {
         // initialize buffer and stream
         std::string buffer;
@@ -172,54 +159,54 @@ namespace lang_tools
         }
     }
 
-    template <typename Token, typename Term, typename Value>
-    auto REPL<Token, Term, Value>::
+    template <typename Token, typename Term, typename Value, typename Lex>
+    auto REPL<Token, Term, Value, Lex>::
             welcome() const -> void
     {
         out << welcome_msg << std::endl;
     }
 
-    template <typename Token, typename Term, typename Value>
-    auto REPL<Token, Term, Value>::
+    template <typename Token, typename Term, typename Value, typename Lex>
+    auto REPL<Token, Term, Value, Lex>::
             set_prompt(std::string new_prompt) -> REPL &
     {
         prompt = std::move(new_prompt);
         return *this;
     }
 
-    template <typename Token, typename Term, typename Value>
-    auto REPL<Token, Term, Value>::
+    template <typename Token, typename Term, typename Value, typename Lex>
+    auto REPL<Token, Term, Value, Lex>::
             set_goodbye(std::string new_goodbye) -> REPL &
     {
         goodbye_msg = std::move(new_goodbye);
         return *this;
     }
 
-    template <typename Token, typename Term, typename Value>
-    auto REPL<Token, Term, Value>::
+    template <typename Token, typename Term, typename Value, typename Lex>
+    auto REPL<Token, Term, Value, Lex>::
             set_welcome(std::string new_welcome) -> REPL &
     {
         welcome_msg = std::move(new_welcome);
         return *this;
     }
 
-    template <typename Token, typename Term, typename Value>
-    auto REPL<Token, Term, Value>::
+    template <typename Token, typename Term, typename Value, typename Lex>
+    auto REPL<Token, Term, Value, Lex>::
             exit() -> void
     {
         out << goodbye_msg
             << std::endl;
     }
 
-    template <typename Token, typename Term, typename Value>
-    auto REPL<Token, Term, Value>::
+    template <typename Token, typename Term, typename Value, typename Lex>
+    auto REPL<Token, Term, Value, Lex>::
             goodbye() const -> void
     {
         out << goodbye_msg << std::endl;
     }
 
-    template <typename Token, typename Term, typename Value>
-    auto REPL<Token, Term, Value>::
+    template <typename Token, typename Term, typename Value, typename Lex>
+    auto REPL<Token, Term, Value, Lex>::
             loop(std::string& buffer, std::stringstream& stream) -> void
     {
         // display prompt
@@ -246,23 +233,21 @@ namespace lang_tools
 
             // get tokens
             std::queue<Token> tokens;
-            for (LexResult<Token>& result : token_stream(*this, stream))
+            token_range<Token, Lex> lexed {lexer, stream};
+            for (auto token {lexed.begin()}; token != lexed.end(); ++token)
             {
-                Token* ok {result.get_ok()};
-                if (ok != nullptr)
-                    tokens.push(*ok);
-                else
+                if (token.error().has_value())
                 {
-                    LexErr* err {result.get_err()};
-                    out << "lex error: " << *err << std::endl;
+                    out << "lex error: " << token.error().value() << std::endl;
                     return;
                 }
+                tokens.push(std::move(*token));
             }
             // if loop finished, then no errors occurred
             // otherwise returned early
 
             // get term
-            ParseResult<Term> parse_result {parser(tokens)};
+            ParseResult<Term> parse_result {parser(std::move(tokens))};
             ParseErr* parse_err {parse_result.get_err()};
             if (parse_err != nullptr)
             {
@@ -271,9 +256,9 @@ namespace lang_tools
             }
 
             // no parse error
-            // attempt to evaluate term in context
+            // attempt to evaluate term in the session's context
             Term* ok {parse_result.get_ok()};
-            EvalResult<Value> eval_result {evaluator(*ok, context)};
+            EvalResult<Value> eval_result {evaluator(*ok, session)};
 
             Value* ok_val {eval_result.get_ok()};
             if (ok_val == nullptr)
@@ -289,27 +274,43 @@ namespace lang_tools
         }
     }
 
-    template <typename Token, typename Term, typename Value>
-    REPL<Token, Term, Value>::REPL(Lexer<Token> lexer, Parser<Term, Token> parser,
+    template <typename Token, typename Term, typename Value, typename Lex>
+    REPL<Token, Term, Value, Lex>::REPL(Lex lexer, Parser<Term, Token> parser,
             Evaluator<Value, Term> evaluator)
-        : lexer {lexer}, parser {parser}, evaluator {evaluator}
+        : lexer {std::move(lexer)}, parser {parser}, evaluator {evaluator}
     {}
 
-    template<typename Token, typename Term, typename Value>
-    auto REPL<Token, Term, Value>::load_context(Context<Term> ctxt) -> REPL&
+    template<typename Token, typename Term, typename Value, typename Lex>
+    auto REPL<Token, Term, Value, Lex>::load_context(Context<Term> ctxt) -> REPL&
+    {
+        session.load(std::move(ctxt));
+        return *this;
+    }
+
+    template<typename Token, typename Term, typename Value, typename Lex>
+    auto REPL<Token, Term, Value, Lex>::on_define(typename Session<Term>::Listener listener) -> REPL&
+    {
+        session.on_define(std::move(listener));
+        return *this;
+    }
+
+    template<typename Token, typename Term, typename Value, typename Lex>
+    auto REPL<Token, Term, Value, Lex>::add_command(const std::string& name,
+            typename Command::op_type operation) -> REPL&
     {
-        context.merge(ctxt);
+        commands.erase(name);
+        commands.emplace(name, Command {std::move(operation)});
         return *this;
     }
 
-    template <typename Token, typename Term, typename Value>
-    REPL<Token, Term, Value>::
+    template <typename Token, typename Term, typename Value, typename Lex>
+    REPL<Token, Term, Value, Lex>::
     Command::Command(REPL::REPL::Command::op_type operation)
         : operation { operation }
     {}
 
-    template <typename Token, typename Term, typename Value>
-    auto REPL<Token, Term, Value>::
+    template <typename Token, typename Term, typename Value, typename Lex>
+    auto REPL<Token, Term, Value, Lex>::
             Command::run(REPL::state_t& state_in, const std::string& buffer) -> std::optional<std::string>
     {
         return operation(state_in, buffer);
@@ -4,6 +4,8 @@
 #include <functional>
 #include <initializer_list>
 #include <optional>
+#include <type_traits>
+#include <utility>
 #include <variant>
 
 
@@ -17,10 +19,12 @@ namespace result
 
         // constructors
         explicit Result(const data_type& data);
-        Result(const Result& other);
-        Result(Result&& result) noexcept;
+        explicit Result(data_type&& data);
+        Result(const Result& other) = default;
+        Result(Result&& result) noexcept = default;
 
         // operators
+        auto operator =(const Result& other) -> Result& = default;
         auto operator =(Result&& other) noexcept -> Result& = default;
         auto operator =(OkType ok) -> Result&;
         auto operator =(ErrType err) -> Result&;
@@ -28,34 +32,58 @@ namespace result
         template <typename T, typename U>
         friend auto operator ==(const Result<T,U>& lhs, const Result<T,U>& rhs) -> bool;
 
-        // factories
+        // factories, which construct the value in place from the arguments
         template <typename ...Args>
-        static auto make_ok(Args ...args) -> Result;
+        static auto make_ok(Args&& ...args) -> Result;
 
         template <typename ...Args>
-        static auto make_err(Args ...args) -> Result;
+        static auto make_err(Args&& ...args) -> Result;
 
         // accessors
         auto get_ok() -> OkType*;
+        auto get_ok() const -> const OkType*;
 
         auto get_err() -> ErrType*;
+        auto get_err() const -> const ErrType*;
+
+        // move the value out of a result that is going away
+        // @throws std::bad_variant_access if the result holds the other kind
+        auto take_ok() && -> OkType;
+        auto take_err() && -> ErrType;
 
         auto is_ok() const -> bool;
 
         auto is_err() const -> bool;
 
         // operations
-        template <typename OkB>
-        auto map_ok(std::function<OkB(OkType)> f) -> Result<OkB, ErrType>;
+        // each takes any callable; called on an rvalue, the value is moved
+        // into the callable rather than copied
+        template <typename F>
+        auto map_ok(F&& f) const & -> Result<std::invoke_result_t<F, const OkType&>, ErrType>;
+
+        template <typename F>
+        auto map_ok(F&& f) && -> Result<std::invoke_result_t<F, OkType&&>, ErrType>;
+
+        template <typename F>
+        auto map_err(F&& f) const & -> Result<OkType, std::invoke_result_t<F, const ErrType&>>;
+
+        template <typename F>
+        auto map_err(F&& f) && -> Result<OkType, std::invoke_result_t<F, ErrType&&>>;
 
-        template <typename ErrB>
-        auto map_err(std::function<ErrB(ErrType)> f) -> Result<OkType, ErrB>;
+        template <typename F, typename G>
+        auto map_both(F&& f, G&& g) const &
+            -> Result<std::invoke_result_t<F, const OkType&>, std::invoke_result_t<G, const ErrType&>>;
 
-        template <typename OkB, typename ErrB>
-        auto map_both(std::function<OkB(OkType)> f, std::function<ErrB(ErrType)> g) -> Result<OkB, ErrB>;
+        template <typename F, typename G>
+        auto map_both(F&& f, G&& g) &&
+            -> Result<std::invoke_result_t<F, OkType&&>, std::invoke_result_t<G, ErrType&&>>;
 
-        template <typename OkB>
-        auto and_then(std::function<Result<OkB, ErrType>(OkType)> f) -> Result<OkB, ErrType>;
+        // f must return a Result with the same error type
+        template <typename F>
+        auto and_then(F&& f) const & -> std::invoke_result_t<F, const OkType&>;
+
+        template <typename F>
+        auto and_then(F&& f) && -> std::invoke_result_t<F, OkType&&>;
 
     private:
         constexpr static size_t ok_index = 0;
@@ -63,73 +91,109 @@ namespace result
         constexpr static std::in_place_index_t<0> ok_place {};
         constexpr static std::in_place_index_t<1> err_place {};
         data_type data;
+
+        template <size_t Index, typename ...Args>
+        explicit Result(std::in_place_index_t<Index> place, Args&& ...args)
+            : data {place, std::forward<Args>(args)...}
+        {}
     };
 
     template<typename OkType, typename ErrType>
     template<typename... Args>
-    auto Result<OkType, ErrType>::make_ok(Args... args) -> Result
+    auto Result<OkType, ErrType>::make_ok(Args&&... args) -> Result
     {
         // have to explicitly specify index in case OkType and ErrType are the same
-        auto data = std::variant<OkType, ErrType>(ok_place, args...);
-        return Result(data);
+        return Result(ok_place, std::forward<Args>(args)...);
     }
 
     template<typename OkType, typename ErrType>
     template<typename... Args>
-    auto Result<OkType, ErrType>::make_err(Args... args) -> Result
+    auto Result<OkType, ErrType>::make_err(Args&&... args) -> Result
     {
         // have to explicitly specify index in case OkType and ErrType are the same
-        auto data = std::variant<OkType, ErrType>(err_place, args...);
-        return Result(data);
+        return Result(err_place, std::forward<Args>(args)...);
     }
 
-    template<typename OkType, typename ErrType>
-    Result<OkType, ErrType>::Result(const Result& other)
-            : data {other.data}
-    {}
-
     template<typename OkType, typename ErrType>
     Result<OkType, ErrType>::Result(const Result::data_type& data)
             : data {data}
     {}
 
-    // move constructor
     template<typename OkType, typename ErrType>
-    Result<OkType, ErrType>::Result(Result&& result) noexcept
-            : data {std::move(result.data)}
+    Result<OkType, ErrType>::Result(Result::data_type&& data)
+            : data {std::move(data)}
     {}
 
     template<typename OkType, typename ErrType>
-    template<typename OkB>
-    auto Result<OkType, ErrType>::and_then(std::function<Result<OkB,ErrType>(OkType)> f) -> Result<OkB, ErrType>
+    template<typename F>
+    auto Result<OkType, ErrType>::and_then(F&& f) const & -> std::invoke_result_t<F, const OkType&>
     {
+        using ResultB = std::invoke_result_t<F, const OkType&>;
         auto ok = std::get_if<ok_index>(&data);
         if (ok)
-            return f(*ok);
+            return std::invoke(std::forward<F>(f), *ok);
 
-        return Result<OkB, ErrType>::make_err(*get_err());
+        return ResultB::make_err(*get_err());
     }
 
     template<typename OkType, typename ErrType>
-    template<typename OkB>
-    auto Result<OkType, ErrType>::map_ok(std::function<OkB(OkType)> f) -> Result<OkB, ErrType>
+    template<typename F>
+    auto Result<OkType, ErrType>::and_then(F&& f) && -> std::invoke_result_t<F, OkType&&>
     {
+        using ResultB = std::invoke_result_t<F, OkType&&>;
         auto ok = std::get_if<ok_index>(&data);
         if (ok)
-            return Result<OkB, ErrType>::make_ok(f(*ok));
+            return std::invoke(std::forward<F>(f), std::move(*ok));
 
-        return Result<OkB, ErrType>::make_err(*get_err());
+        return ResultB::make_err(std::move(*get_err()));
     }
 
     template<typename OkType, typename ErrType>
-    template<typename ErrB>
-    auto Result<OkType, ErrType>::map_err(std::function<ErrB(ErrType)> f) -> Result<OkType, ErrB>
+    template<typename F>
+    auto Result<OkType, ErrType>::map_ok(F&& f) const & -> Result<std::invoke_result_t<F, const OkType&>, ErrType>
     {
+        using ResultB = Result<std::invoke_result_t<F, const OkType&>, ErrType>;
+        auto ok = std::get_if<ok_index>(&data);
+        if (ok)
+            return ResultB::make_ok(std::invoke(std::forward<F>(f), *ok));
+
+        return ResultB::make_err(*get_err());
+    }
+
+    template<typename OkType, typename ErrType>
+    template<typename F>
+    auto Result<OkType, ErrType>::map_ok(F&& f) && -> Result<std::invoke_result_t<F, OkType&&>, ErrType>
+    {
+        using ResultB = Result<std::invoke_result_t<F, OkType&&>, ErrType>;
+        auto ok = std::get_if<ok_index>(&data);
+        if (ok)
+            return ResultB::make_ok(std::invoke(std::forward<F>(f), std::move(*ok)));
+
+        return ResultB::make_err(std::move(*get_err()));
+    }
+
+    template<typename OkType, typename ErrType>
+    template<typename F>
+    auto Result<OkType, ErrType>::map_err(F&& f) const & -> Result<OkType, std::invoke_result_t<F, const ErrType&>>
+    {
+        using ResultB = Result<OkType, std::invoke_result_t<F, const ErrType&>>;
         auto err = std::get_if<err_index>(&data);
         if (err)
-            return Result<OkType, ErrB>::make_err(f(*err));
+            return ResultB::make_err(std::invoke(std::forward<F>(f), *err));
 
-        return Result<OkType, ErrB>::make_ok(*get_ok());
+        return ResultB::make_ok(*get_ok());
+    }
+
+    template<typename OkType, typename ErrType>
+    template<typename F>
+    auto Result<OkType, ErrType>::map_err(F&& f) && -> Result<OkType, std::invoke_result_t<F, ErrType&&>>
+    {
+        using ResultB = Result<OkType, std::invoke_result_t<F, ErrType&&>>;
+        auto err = std::get_if<err_index>(&data);
+        if (err)
+            return ResultB::make_err(std::invoke(std::forward<F>(f), std::move(*err)));
+
+        return ResultB::make_ok(std::move(*get_ok()));
     }
 
     template<typename T, typename U>
@@ -144,12 +208,36 @@ namespace result
         return std::get_if<ok_index>(&data);
     }
 
+    template<typename OkType, typename ErrType>
+    auto Result<OkType, ErrType>::get_ok() const -> const OkType*
+    {
+        return std::get_if<ok_index>(&data);
+    }
+
     template<typename OkType, typename ErrType>
     auto Result<OkType, ErrType>::get_err() -> ErrType*
     {
         return std::get_if<err_index>(&data);
     }
 
+    template<typename OkType, typename ErrType>
+    auto Result<OkType, ErrType>::get_err() const -> const ErrType*
+    {
+        return std::get_if<err_index>(&data);
+    }
+
+    template<typename OkType, typename ErrType>
+    auto Result<OkType, ErrType>::take_ok() && -> OkType
+    {
+        return std::get<ok_index>(std::move(data));
+    }
+
+    template<typename OkType, typename ErrType>
+    auto Result<OkType, ErrType>::take_err() && -> ErrType
+    {
+        return std::get<err_index>(std::move(data));
+    }
+
     template<typename OkType, typename ErrType>
     auto Result<OkType, ErrType>::is_ok() const -> bool
     {
@@ -165,24 +253,36 @@ namespace result
     template<typename OkType, typename ErrType>
     auto Result<OkType, ErrType>::operator =(OkType ok) -> Result&
     {
-        data = ok;
+        data.template emplace<ok_index>(std::move(ok));
         return *this;
     }
 
     template<typename OkType, typename ErrType>
-    template<typename OkB, typename ErrB>
-    auto
-    Result<OkType, ErrType>::map_both(std::function<OkB(OkType)> f, std::function<ErrB(ErrType)> g) -> Result<OkB, ErrB>
+    template<typename F, typename G>
+    auto Result<OkType, ErrType>::map_both(F&& f, G&& g) const &
+        -> Result<std::invoke_result_t<F, const OkType&>, std::invoke_result_t<G, const ErrType&>>
+    {
+        using ResultB = Result<std::invoke_result_t<F, const OkType&>, std::invoke_result_t<G, const ErrType&>>;
+        if (is_ok())
+            return ResultB::make_ok(std::invoke(std::forward<F>(f), *get_ok()));
+        return ResultB::make_err(std::invoke(std::forward<G>(g), *get_err()));
+    }
+
+    template<typename OkType, typename ErrType>
+    template<typename F, typename G>
+    auto Result<OkType, ErrType>::map_both(F&& f, G&& g) &&
+        -> Result<std::invoke_result_t<F, OkType&&>, std::invoke_result_t<G, ErrType&&>>
     {
+        using ResultB = Result<std::invoke_result_t<F, OkType&&>, std::invoke_result_t<G, ErrType&&>>;
         if (is_ok())
-            return Result<OkB, ErrB>::make_ok(f(*get_ok()));
-        return Result<OkB, ErrB>::make_err(g(*get_err()));
+            return ResultB::make_ok(std::invoke(std::forward<F>(f), std::move(*get_ok())));
+        return ResultB::make_err(std::invoke(std::forward<G>(g), std::move(*get_err())));
     }
 
     template<typename OkType, typename ErrType>
     auto Result<OkType, ErrType>::operator =(ErrType err) -> Result&
     {
-        data = err;
+        data.template emplace<err_index>(std::move(err));
         return *this;
     }
 }
@@ -1,4 +1,8 @@
+#include <algorithm>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
 
 #include "lib/lang_tools/repl/REPL.hpp"
 #include "lib/result/Result.hpp"
@@ -6,25 +10,158 @@
 #include "src/lex.h"
 #include "src/parse.h"
 #include "src/eval.h"
+#include "src/cancel.h"
+#include "src/instrument.h"
+#include "src/library.h"
+#include "src/engine.h"
 #include "src/prelude.h"
+#include "src/server.h"
+#include "src/simplify.h"
 #include "src/numerals.h"
+#include "src/print.h"
 
 
 using lang_tools::REPL;
 using namespace lambda;
 
-int main()
+int main(int argc, char* argv[])
 {
+    std::vector<std::string> args {argv + 1, argv + argc};
+    auto has_flag = [&args](const std::string& flag) -> bool
+    {
+        return std::find(args.begin(), args.end(), flag) != args.end();
+    };
+    auto flag_value = [&args](const std::string& flag) -> std::optional<std::string>
+    {
+        auto search {std::find(args.begin(), args.end(), flag)};
+        if (search == args.end() || search + 1 == args.end())
+            return {};
+        return *(search + 1);
+    };
+
+    instrument::enable(has_flag("--track-allocations"));
+
+    EngineOptions options {};
+    if (has_flag("--optimal"))
+        options.strategy = Strategy::Optimal;
+    else if (has_flag("--lifted"))
+        options.strategy = Strategy::Lifted;
+    if (has_flag("--detect-loops"))
+        options.loop_window = 64;
+    Engine engine {options};
+
+    // eta-reduce and name known combinators in results, instead of only
+    // matching whole definitions
+    bool simplify_results {has_flag("--simplify")};
+
+    // write results with repeated subterms bound once by lets, for results
+    // that share too much to write out as trees
+    bool share_results {has_flag("--share")};
+
+    // the prelude is parsed lazily: only the definitions a term can reach are loaded
+    const Library prelude {get_prelude_library()};
+
+    // serve requests on a socket instead of running a session
+    std::optional<std::string> socket_path {flag_value("--serve")};
+    if (socket_path.has_value())
+    {
+        ServerOptions server_options {socket_path.value()};
+        server_options.engine = options;
+        server_options.simplify = simplify_results;
+        if (std::optional<std::string> threads {flag_value("--threads")})
+            server_options.threads = std::stoul(threads.value());
+
+        try
+        {
+            Server server {prelude, server_options};
+            server.run();
+            return 0;
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << "server stopped: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // Ctrl-C during a reduction stops it and returns to the prompt
+    CancelToken interrupt {};
+
+    // the definitions results are contracted against, added to as session
+    // definitions are made and the prelude is loaded rather than rebuilt for
+    // every result; a redefined name replaces its old entry
+    Contractions contractions {};
+    Simplifier simplifier {};
+    auto learn = [&contractions, &simplifier, simplify_results](const std::string& name, const Term& definition)
+    {
+        contractions.add(name, definition);
+        if (simplify_results)
+            simplifier.add(name, definition);
+    };
+
     // trying out just reducing for the repl than evaluating to an abstraction
     // REPL<Token, Term, Value> repl {lex, parse, evaluate};
-    REPL<Token, Term, Term> repl {lex, parse,
-                          [](Term term, Context context)
+    REPL<Token, Term, Term, Lex> repl {Lex {}, parse,
+                          [&engine, &prelude, &interrupt, &contractions, &simplifier, &learn,
+                           simplify_results, share_results]
+                          (const Term& term, const lang_tools::Session<Term>& session)
                           {
-                                auto val {contract_term(reduce(term, context), context)};
-                                val = contract_numeral(val);
-                                return result::Result<Term, lang_tools::EvalErr>::make_ok(val);
+                                using EvalResult = result::Result<Term, lang_tools::EvalErr>;
+                                std::vector<std::string> loaded {prelude.load_closure(free_variables(term))};
+                                const Context& context {session.context()};
+                                ContextDefinitions definitions {context, &prelude};
+
+                                // the input's prelude closure is learnt in name order, skipping
+                                // names already learnt or that the session defines itself
+                                std::sort(loaded.begin(), loaded.end());
+                                for (const std::string& name : loaded)
+                                {
+                                    if (contractions.contains(name) || context.count(name) > 0)
+                                        continue;
+                                    if (const Term* definition {prelude.find(name)})
+                                        learn(name, *definition);
+                                }
+
+                                interrupt.reset();
+                                InterruptScope scope {interrupt};
+                                ReduceResult reduction {engine.reduce(term, definitions, &interrupt)};
+                                if (reduction.is_err() && interrupt.is_cancelled())
+                                {
+                                    std::stringstream message {};
+                                    message << "interrupted after " << engine.stats().last_steps << " steps";
+                                    if (engine.stats().peak_nodes > 0)
+                                        message << " (peak nodes: " << engine.stats().peak_nodes << ")";
+                                    return EvalResult::make_err(message.str());
+                                }
+                                if (reduction.is_err())
+                                    return EvalResult::make_err(*reduction.get_err());
+
+                                // contraction only knows about prelude definitions loaded so far
+                                Term result {simplify_results ? tidy(*reduction.get_ok(), simplifier)
+                                                              : tidy(*reduction.get_ok(), contractions)};
+                                if (share_results)
+                                    result = share_subterms(result);
+                                return EvalResult::make_ok(std::move(result));
                           }
     };
-    repl.load_context(get_prelude());
+    repl.on_define(learn);
+    repl.add_command("memory", [](auto&, const std::string&) -> std::optional<std::string>
+    {
+        if (!instrument::enabled())
+            return {"allocation tracking is off (start with --track-allocations)"};
+
+        // report covers everything since the last report
+        std::stringstream report {};
+        report << instrument::report();
+        instrument::reset();
+        return report.str();
+    });
+    repl.add_command("stats", [&engine](auto&, const std::string&) -> std::optional<std::string>
+    {
+        std::stringstream stats {};
+        stats << as_string(engine.options().strategy) << " engine" << std::endl << engine.stats();
+        engine.reset_stats();
+        return stats.str();
+    });
     repl.run();
 }
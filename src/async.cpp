@@ -0,0 +1,55 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include "async.h"
+
+namespace lambda
+{
+    Evaluation::Evaluation(Term term, const Definitions& definitions, EngineOptions options,
+                           std::optional<Deadline> deadline)
+        : token {std::make_unique<CancelToken>(deadline)}, totals {std::make_unique<EngineStats>()}
+    {
+        CancelToken* cancel {token.get()};
+        EngineStats* stats {totals.get()};
+        result = std::async(std::launch::async, [term {std::move(term)}, &definitions, options, cancel, stats]()
+        {
+            Engine engine {options};
+            ReduceResult reduction {engine.reduce(term, definitions, cancel)};
+            *stats = engine.stats();
+            return reduction;
+        });
+    }
+
+    Evaluation::~Evaluation()
+    {
+        if (!result.valid())
+            return;
+        token->cancel();
+        result.wait();
+    }
+
+    auto Evaluation::ready() const -> bool
+    {
+        return wait_for(std::chrono::milliseconds {0});
+    }
+
+    auto Evaluation::wait_for(std::chrono::milliseconds timeout) const -> bool
+    {
+        return !result.valid() || result.wait_for(timeout) == std::future_status::ready;
+    }
+
+    auto Evaluation::get() -> ReduceResult
+    {
+        return result.get();
+    }
+
+    auto evaluate_async(Term term, const Definitions& definitions, EngineOptions options,
+                        std::optional<std::chrono::milliseconds> timeout) -> Evaluation
+    {
+        std::optional<Deadline> deadline {};
+        if (timeout.has_value())
+            deadline = std::chrono::steady_clock::now() + timeout.value();
+        return Evaluation {std::move(term), definitions, options, deadline};
+    }
+}
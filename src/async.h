@@ -0,0 +1,80 @@
+//
+// Created by colin on 10/19/26.
+//
+
+/**
+ * Reduction on a background thread. The handle can be polled for the
+ * number of steps made so far, waited on with a timeout, and cancelled;
+ * a reduction can also be given a deadline, after which it gives up by
+ * itself. Cancelled reductions finish with an error at the reducer's next
+ * safe point.
+ */
+
+#ifndef LAMBDA_ASYNC_H
+#define LAMBDA_ASYNC_H
+
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <optional>
+
+#include "cancel.h"
+#include "engine.h"
+
+namespace lambda
+{
+    class Evaluation
+    {
+    public:
+        /**
+         * Starts reducing a copy of the term. The definitions are borrowed
+         * and must outlive the evaluation.
+         */
+        Evaluation(Term term, const Definitions& definitions, EngineOptions options = {},
+                   std::optional<Deadline> deadline = {});
+
+        // cancels the reduction if it is still running and waits for it
+        ~Evaluation();
+
+        Evaluation(Evaluation&&) = default;
+        auto operator =(Evaluation&&) -> Evaluation& = delete;
+
+        auto cancel() -> void
+        {
+            token->cancel();
+        }
+
+        // steps made so far
+        auto steps() const -> std::size_t
+        {
+            return token->steps();
+        }
+
+        auto ready() const -> bool;
+
+        // true if the result is ready before the timeout
+        auto wait_for(std::chrono::milliseconds timeout) const -> bool;
+
+        // blocks until the result is ready; can only be called once
+        auto get() -> ReduceResult;
+
+        // the engine's statistics, once the result is ready
+        auto stats() const -> const EngineStats&
+        {
+            return *totals;
+        }
+
+    private:
+        // behind pointers, so that the reduction's thread can keep using
+        // them when the handle is moved
+        std::unique_ptr<CancelToken> token;
+        std::unique_ptr<EngineStats> totals;
+        std::future<ReduceResult> result;
+    };
+
+    auto evaluate_async(Term term, const Definitions& definitions, EngineOptions options = {},
+                        std::optional<std::chrono::milliseconds> timeout = {}) -> Evaluation;
+}
+
+#endif //LAMBDA_ASYNC_H
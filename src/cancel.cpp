@@ -0,0 +1,80 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include <csignal>
+
+#include "cancel.h"
+
+namespace lambda
+{
+    namespace
+    {
+        // reading the clock costs more than a check, so only look every so often
+        constexpr std::size_t clock_interval {256};
+
+        // the token of the innermost CheckScope on this thread
+        thread_local CancelToken* current {nullptr};
+
+        // the token SIGINT cancels, if any
+        std::atomic<CancelToken*> interruptible {nullptr};
+
+        auto on_interrupt(int signal) -> void
+        {
+            CancelToken* token {interruptible.load()};
+            if (token != nullptr)
+            {
+                token->cancel();
+                return;
+            }
+
+            // nothing to stop, so do what Ctrl-C would have done anyway
+            std::signal(signal, SIG_DFL);
+            std::raise(signal);
+        }
+    }
+
+    auto CancelToken::check() -> void
+    {
+        if (is_cancelled())
+            throw Interrupted {"Evaluation cancelled"};
+        if (deadline.has_value() && ++checks % clock_interval == 0
+            && std::chrono::steady_clock::now() >= deadline.value())
+            throw Interrupted {"Deadline exceeded"};
+    }
+
+    auto CancelToken::reset(std::optional<Deadline> new_deadline) -> void
+    {
+        cancelled.store(false, std::memory_order_relaxed);
+        progress.store(0, std::memory_order_relaxed);
+        deadline = new_deadline;
+        checks = 0;
+    }
+
+    CheckScope::CheckScope(CancelToken* token) : outer {current}
+    {
+        current = token;
+    }
+
+    CheckScope::~CheckScope()
+    {
+        current = outer;
+    }
+
+    auto check_current() -> void
+    {
+        if (current != nullptr)
+            current->check();
+    }
+
+    InterruptScope::InterruptScope(CancelToken& token)
+    {
+        interruptible.store(&token);
+        std::signal(SIGINT, on_interrupt);
+    }
+
+    InterruptScope::~InterruptScope()
+    {
+        interruptible.store(nullptr);
+    }
+}
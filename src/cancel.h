@@ -0,0 +1,120 @@
+//
+// Created by colin on 10/19/26.
+//
+
+/**
+ * Lets whoever started a reduction stop it, or watch how far it has got,
+ * from another thread. The reducers report to the token at safe points:
+ * every beta reduction, interaction or instantiation, and every step of
+ * the substitutions and read backs between them, which can take long
+ * enough by themselves to outlast a deadline.
+ */
+
+#ifndef LAMBDA_CANCEL_H
+#define LAMBDA_CANCEL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <string>
+
+namespace lambda
+{
+    using Deadline = std::chrono::steady_clock::time_point;
+
+    // thrown by CancelToken::check, and turned into an error by the reducers
+    struct Interrupted
+    {
+        std::string reason;
+    };
+
+    class CancelToken
+    {
+    public:
+        explicit CancelToken(std::optional<Deadline> deadline = {}) : deadline {deadline} {}
+
+        CancelToken(const CancelToken&) = delete;
+        auto operator =(const CancelToken&) -> CancelToken& = delete;
+
+        // safe to call from any thread, and from a signal handler
+        auto cancel() -> void
+        {
+            cancelled.store(true, std::memory_order_relaxed);
+        }
+
+        auto is_cancelled() const -> bool
+        {
+            return cancelled.load(std::memory_order_relaxed);
+        }
+
+        // steps made so far by the reduction using the token
+        auto steps() const -> std::size_t
+        {
+            return progress.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Throws Interrupted if the token has been cancelled or its deadline
+         * has passed. The clock is read every so many calls, however little
+         * progress they record.
+         */
+        auto check() -> void;
+
+        // records progress, then checks
+        auto check(std::size_t steps) -> void
+        {
+            progress.store(steps, std::memory_order_relaxed);
+            check();
+        }
+
+        // lets the token be used for another reduction
+        auto reset(std::optional<Deadline> new_deadline = {}) -> void;
+
+    private:
+        std::atomic<bool> cancelled {false};
+        std::atomic<std::size_t> progress {0};
+        std::optional<Deadline> deadline;
+
+        // calls to check, only ever made by the reduction's own thread
+        std::size_t checks {0};
+    };
+
+    /**
+     * Makes the token the one that check_current checks on this thread for
+     * as long as the scope is alive, so that code which is handed no token,
+     * like substitution, can still be stopped. Scopes nest.
+     */
+    class CheckScope
+    {
+    public:
+        explicit CheckScope(CancelToken* token);
+        ~CheckScope();
+
+        CheckScope(const CheckScope&) = delete;
+        auto operator =(const CheckScope&) -> CheckScope& = delete;
+
+    private:
+        CancelToken* outer;
+    };
+
+    // checks the token of the innermost scope on this thread, if there is one
+    auto check_current() -> void;
+
+    /**
+     * Cancels the token on SIGINT for as long as the scope is alive, so that
+     * Ctrl-C stops a runaway reduction instead of the whole process. Outside
+     * of any scope SIGINT has its default action. Scopes don't nest.
+     */
+    class InterruptScope
+    {
+    public:
+        explicit InterruptScope(CancelToken& token);
+        ~InterruptScope();
+
+        InterruptScope(const InterruptScope&) = delete;
+        auto operator =(const InterruptScope&) -> InterruptScope& = delete;
+    };
+}
+
+#endif //LAMBDA_CANCEL_H
@@ -0,0 +1,172 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include <sstream>
+
+#include "decode.h"
+#include "instrument.h"
+#include "numerals.h"
+
+namespace lambda
+{
+    namespace
+    {
+        // the binder names and body of \a.\b. body
+        struct TwoBinders
+        {
+            const std::string& first;
+            const std::string& second;
+            const Term& body;
+        };
+
+        auto two_binders(const Term& term) -> std::optional<TwoBinders>
+        {
+            auto outer {std::get_if<Abstraction>(&term)};
+            if (outer == nullptr)
+                return {};
+            auto inner {std::get_if<Abstraction>(&*outer->body)};
+            if (inner == nullptr || inner->name.name == outer->name.name)
+                return {};
+            return TwoBinders {outer->name.name, inner->name.name, *inner->body};
+        }
+
+        auto is_variable(const Term& term, const std::string& name) -> bool
+        {
+            auto var {std::get_if<Variable>(&term)};
+            return var != nullptr && var->name == name;
+        }
+    }
+
+    auto Decoders::add(std::string name, Decoder decoder) -> Decoders&
+    {
+        decoders.emplace_back(std::move(name), std::move(decoder));
+        return *this;
+    }
+
+    auto Decoders::decode(const Term& term) const -> std::optional<std::string>
+    {
+        for (const auto& [name, decoder] : decoders)
+        {
+            std::optional<std::string> shown {decoder(term, *this)};
+            if (shown.has_value())
+                return shown;
+        }
+        return {};
+    }
+
+    auto Decoders::show(const Term& term) const -> std::string
+    {
+        std::optional<std::string> shown {decode(term)};
+        if (shown.has_value())
+            return std::move(shown.value());
+        return as_string(term);
+    }
+
+    auto Decoders::names() const -> std::vector<std::string>
+    {
+        std::vector<std::string> names {};
+        for (const auto& [name, decoder] : decoders)
+            names.push_back(name);
+        return names;
+    }
+
+    auto decode_numeral(const Term& term, const Decoders&) -> std::optional<std::string>
+    {
+        std::optional<Natural> value {read_numeral(term)};
+        if (!value.has_value())
+            return {};
+
+        // zero is the same term as false, so only read it as a number when
+        // it uses the numeral binder names
+        if (value->is_zero() && !std::holds_alternative<Numeral>(term))
+        {
+            auto binders {two_binders(term)};
+            if (!binders.has_value() || binders->first != "s" || binders->second != "z")
+                return {};
+        }
+        return as_string(value.value());
+    }
+
+    auto decode_boolean(const Term& term, const Decoders&) -> std::optional<std::string>
+    {
+        auto binders {two_binders(term)};
+        if (!binders.has_value())
+            return {};
+        if (is_variable(binders->body, binders->first))
+            return "true";
+        if (is_variable(binders->body, binders->second))
+            return "false";
+        return {};
+    }
+
+    auto decode_pair(const Term& term, const Decoders& decoders) -> std::optional<std::string>
+    {
+        // \b. b first second
+        auto abstr {std::get_if<Abstraction>(&term)};
+        auto outer {abstr ? std::get_if<Application>(&*abstr->body) : nullptr};
+        auto inner {outer ? std::get_if<Application>(&*outer->lhs) : nullptr};
+        if (inner == nullptr || !is_variable(*inner->lhs, abstr->name.name))
+            return {};
+
+        const std::string& selector {abstr->name.name};
+        if (is_free(selector, *inner->rhs) || is_free(selector, *outer->rhs))
+            return {};
+        return "(" + decoders.show(*inner->rhs) + ", " + decoders.show(*outer->rhs) + ")";
+    }
+
+    auto decode_list(const Term& term, const Decoders& decoders) -> std::optional<std::string>
+    {
+        // \c.\n. c x (c y ... n), the right fold of the elements. The empty
+        // list is the same term as zero and false, so it is left to them
+        auto binders {two_binders(term)};
+        if (!binders.has_value())
+            return {};
+
+        std::stringstream shown {};
+        shown << "[";
+        const Term* rest {&binders->body};
+        std::size_t length {0};
+        while (!is_variable(*rest, binders->second))
+        {
+            auto outer {std::get_if<Application>(rest)};
+            auto inner {outer ? std::get_if<Application>(&*outer->lhs) : nullptr};
+            if (inner == nullptr || !is_variable(*inner->lhs, binders->first))
+                return {};
+
+            const Term& element {*inner->rhs};
+            if (is_free(binders->first, element) || is_free(binders->second, element))
+                return {};
+
+            shown << (length++ > 0 ? ", " : "") << decoders.show(element);
+            rest = &*outer->rhs;
+        }
+        if (length == 0)
+            return {};
+
+        shown << "]";
+        return shown.str();
+    }
+
+    auto standard_decoders() -> const Decoders&
+    {
+        static const Decoders decoders {Decoders {}
+            .add("numeral", decode_numeral)
+            .add("boolean", decode_boolean)
+            .add("pair", decode_pair)
+            .add("list", decode_list)};
+        return decoders;
+    }
+
+    auto decode(const Term& term, const Decoders& decoders) -> Term
+    {
+        instrument::PhaseScope scope {instrument::Phase::Contract};
+        return replace_subterms(term, [&decoders](const Term& subterm) -> std::optional<Term>
+        {
+            std::optional<std::string> shown {decoders.decode(subterm)};
+            if (shown.has_value())
+                return Variable {std::move(shown.value())};
+            return {};
+        });
+    }
+}
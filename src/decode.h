@@ -0,0 +1,62 @@
+//
+// Created by colin on 10/19/26.
+//
+
+/**
+ * Recognising Church encodings in a result so that it can be shown as the
+ * value it stands for: 3, true, (1, true), [1, 2].
+ */
+
+#ifndef LAMBDA_DECODE_H
+#define LAMBDA_DECODE_H
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "parse.h"
+
+namespace lambda
+{
+    class Decoders;
+
+    // returns how to show the term, or nothing if it isn't this decoder's encoding
+    using Decoder = std::function<std::optional<std::string>(const Term& term, const Decoders& decoders)>;
+
+    /**
+     * Decoders are tried in the order they were added and the first match
+     * wins. They get the registry so that they can decode their components.
+     */
+    class Decoders
+    {
+    public:
+        auto add(std::string name, Decoder decoder) -> Decoders&;
+
+        auto decode(const Term& term) const -> std::optional<std::string>;
+
+        // how a component of a decoded value is shown: decoded if possible
+        auto show(const Term& term) const -> std::string;
+
+        auto names() const -> std::vector<std::string>;
+
+    private:
+        std::vector<std::pair<std::string, Decoder>> decoders {};
+    };
+
+    // numerals, booleans, pairs and non-empty lists
+    auto standard_decoders() -> const Decoders&;
+
+    auto decode_numeral(const Term& term, const Decoders& decoders) -> std::optional<std::string>;
+    auto decode_boolean(const Term& term, const Decoders& decoders) -> std::optional<std::string>;
+    auto decode_pair(const Term& term, const Decoders& decoders) -> std::optional<std::string>;
+    auto decode_list(const Term& term, const Decoders& decoders) -> std::optional<std::string>;
+
+    /**
+     * Replaces every outermost subterm that some decoder recognises with a
+     * variable holding its decoded form, in a single top-down traversal.
+     */
+    auto decode(const Term& term, const Decoders& decoders = standard_decoders()) -> Term;
+}
+
+#endif //LAMBDA_DECODE_H
@@ -0,0 +1,78 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include <algorithm>
+
+#include "engine.h"
+
+namespace lambda
+{
+    auto Engine::reduce(const Term& term, const Definitions& definitions, CancelToken* cancel) -> ReduceResult
+    {
+        std::size_t steps {0};
+        ReduceResult result {run(term, definitions, cancel, steps)};
+
+        ++totals.reductions;
+        if (result.is_err())
+            ++totals.failures;
+        totals.steps += steps;
+        totals.last_steps = steps;
+        return result;
+    }
+
+    auto Engine::run(const Term& term, const Definitions& definitions, CancelToken* cancel, std::size_t& steps)
+        -> ReduceResult
+    {
+        if (settings.strategy == Strategy::Tree)
+            return lambda::reduce(term, definitions, settings.target, settings.limit, &steps, cancel,
+                                  settings.loop_window);
+
+        if (settings.strategy == Strategy::Lifted)
+        {
+            lifted::Stats stats {};
+            ReduceResult result {lifted::reduce(term, definitions, settings.limit, &stats, cancel)};
+            steps = stats.instantiations;
+            totals.peak_nodes = std::max(totals.peak_nodes, stats.heap_cells);
+            return result;
+        }
+
+        optimal::Stats stats {};
+        ReduceResult result {optimal::reduce(term, definitions, settings.limit, &stats, cancel)};
+        steps = stats.interactions;
+        totals.peak_nodes = std::max(totals.peak_nodes, stats.peak_nodes);
+        return result;
+    }
+
+    auto Engine::reduce(const Term& term, const Context& context, CancelToken* cancel) -> ReduceResult
+    {
+        return reduce(term, ContextDefinitions {context}, cancel);
+    }
+
+    auto as_string(Strategy strategy) -> std::string
+    {
+        switch (strategy)
+        {
+            case Strategy::Tree:
+                return "tree";
+
+            case Strategy::Optimal:
+                return "optimal";
+
+            case Strategy::Lifted:
+                return "lifted";
+        }
+
+        throw std::logic_error("Unknown strategy");
+    }
+
+    auto operator <<(std::ostream& out, const EngineStats& stats) -> std::ostream&
+    {
+        out << "reductions: " << stats.reductions
+            << " (" << stats.failures << " failed)" << std::endl
+            << "steps: " << stats.steps << ", last: " << stats.last_steps;
+        if (stats.peak_nodes > 0)
+            out << std::endl << "peak nodes: " << stats.peak_nodes;
+        return out;
+    }
+}
@@ -0,0 +1,90 @@
+//
+// Created by colin on 10/19/26.
+//
+
+/**
+ * The evaluator a session reduces terms with: which reduction strategy to
+ * use, how far to go before giving up, and running totals of the work done.
+ * Built once per session and reused for every input.
+ */
+
+#ifndef LAMBDA_ENGINE_H
+#define LAMBDA_ENGINE_H
+
+#include <cstddef>
+#include <iostream>
+
+#include "eval.h"
+#include "lifted.h"
+#include "optimal.h"
+
+namespace lambda
+{
+    enum class Strategy {Tree, Optimal, Lifted};
+
+    struct EngineOptions
+    {
+        Strategy strategy {Strategy::Tree};
+
+        // the optimal engine always computes the full normal form
+        NormalForm target {NormalForm::Full};
+
+        // beta reductions for the tree reducer, beta and duplication
+        // rewrites for the optimal one, instantiations for the lifted one
+        std::size_t limit {10'000'000};
+
+        // the tree reducer stops a reduction that needs itself within this
+        // many nested steps; zero turns the check off
+        std::size_t loop_window {0};
+    };
+
+    struct EngineStats
+    {
+        std::size_t reductions {0};
+        std::size_t failures {0};
+
+        // beta reductions, interactions or instantiations, summed over all reductions
+        std::size_t steps {0};
+        std::size_t last_steps {0};
+
+        // largest net built by the optimal engine, or heap by the lifted one
+        std::size_t peak_nodes {0};
+    };
+
+    class Engine
+    {
+    public:
+        explicit Engine(EngineOptions options = {}) : settings {options} {}
+
+        // a cancelled reduction counts as a failure
+        auto reduce(const Term& term, const Definitions& definitions, CancelToken* cancel = nullptr) -> ReduceResult;
+        auto reduce(const Term& term, const Context& context = {}, CancelToken* cancel = nullptr) -> ReduceResult;
+
+        auto options() const -> const EngineOptions&
+        {
+            return settings;
+        }
+
+        auto stats() const -> const EngineStats&
+        {
+            return totals;
+        }
+
+        auto reset_stats() -> void
+        {
+            totals = {};
+        }
+
+    private:
+        EngineOptions settings;
+        EngineStats totals {};
+
+        auto run(const Term& term, const Definitions& definitions, CancelToken* cancel, std::size_t& steps)
+            -> ReduceResult;
+    };
+
+    auto as_string(Strategy strategy) -> std::string;
+    auto operator <<(std::ostream& out, const EngineStats& stats) -> std::ostream&;
+}
+
+#endif //LAMBDA_ENGINE_H
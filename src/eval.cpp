@@ -2,77 +2,524 @@
 // Created by colin on 6/2/20.
 //
 
+#include <algorithm>
+#include <functional>
+#include <limits>
 #include <optional>
 #include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
+#include <vector>
 
+#include "cancel.h"
+#include "instrument.h"
+#include "letrec.h"
+#include "numerals.h"
 #include "parse.h"
+#include "simplify.h"
 #include "eval.h"
 
 using std::optional;
 
 namespace lambda
 {
+    namespace
+    {
+        struct LimitExceeded {};
+        struct Diverges {};
+    }
 
     class Reducer
     {
     public:
         /**
-         * Reduce a term using normal-order strategy.
+         * Reduce a term using normal-order strategy, stopping as soon as the
+         * term is in the target normal form.
          */
         Reducer() = delete;
-        explicit Reducer(Context context) : context {std::move(context)} {}
-        auto operator ()(const Variable& variable) -> Term;
-        auto operator ()(const Abstraction& abstr) -> Term;
-        auto operator ()(const Application& appl)  -> Term;
+        Reducer(const Definitions& definitions, NormalForm target,
+                std::size_t limit = std::numeric_limits<std::size_t>::max(), CancelToken* cancel = nullptr,
+                std::size_t loop_window = 0)
+            : definitions {definitions}, target {target}, limit {limit}, cancel {cancel}, loop_window {loop_window} {}
+        auto reduce_term(const Term& term, NormalForm form) -> Term;
 
-        auto reduce_term(const Term& term, Context local = {}) -> Term;
+        // puts back the lets whose definitions the reduction still refers
+        // to, or with inline, their definitions themselves
+        auto rebind(Term reduction, bool inline_definitions = false) const -> Term;
+
+        // beta reductions and definition unfoldings
+        auto steps() const -> std::size_t
+        {
+            return beta_steps + unfoldings;
+        }
 
     private:
-        Context context;
+        const Definitions& definitions;
+        NormalForm target;
+        std::size_t limit;
+        CancelToken* cancel;
+        std::size_t beta_steps {0};
+        std::size_t unfoldings {0};
+
+        // names bound by the abstractions we are reducing under; a let
+        // definition that uses one is copied in rather than shared
+        std::unordered_map<std::string, std::size_t> bound {};
+        std::size_t binders {0};
+
+        /**
+         * A contractum being reduced. Reducing a term is deterministic, so if
+         * reducing one needs the same term reduced again, under the same
+         * binders and to the same normal form, it never finishes. Binders
+         * only accumulate going inwards, so the same count means the same
+         * binders.
+         */
+        struct Redex
+        {
+            std::size_t frame;
+            std::size_t binders;
+            NormalForm target;
+            std::size_t hash;
+            Term term;
+        };
+
+        // the innermost loop_window contracta being reduced, as a ring
+        // indexed by frame; entries overwritten by deeper frames are stale
+        std::size_t loop_window;
+        std::vector<Redex> recent {};
+        std::size_t active {0};
+
+        // throws Diverges if the term is already being reduced nearby
+        auto enter(const Term& contractum, NormalForm form) -> void;
+
+        /**
+         * What is left to do to reduce a term. Reducing under a binder or
+         * reducing the arguments of a stuck head is queued as tasks rather
+         * than recursing, so terms nest as deeply as memory allows. Each
+         * task that finishes a term leaves it on the results.
+         */
+        struct Reduce
+        {
+            Term term;
+            NormalForm form;
+        };
+
+        // puts the binder back around the reduced body, under its original
+        // name if it was renamed and nothing in the body would be captured
+        struct Bind
+        {
+            Variable name;
+            std::string original {};
+        };
+
+        // applies the head to its reduced arguments
+        struct Apply
+        {
+            Term head;
+            std::size_t arguments;
+        };
+
+        // takes a stuck head's contracta out of the loop window
+        struct Leave
+        {
+            std::size_t entered;
+        };
+
+        using Task = std::variant<Reduce, Bind, Apply, Leave>;
+
+        auto reduce(Term term, std::vector<Task>& tasks, std::vector<Term>& results) -> void;
+
+        /**
+         * A head that can't be reduced any further, with the arguments it is
+         * applied to and the number of contracta it is still in the loop
+         * window for.
+         */
+        struct Stuck
+        {
+            Term head;
+            std::vector<term_ptr> spine;
+            std::size_t entered;
+
+            // a shared value, which is already in the form it was wanted in
+            bool normal {false};
+        };
+
+        /**
+         * Reduces a term by following its head. The arguments the head is
+         * applied to are kept on a spine rather than the stack, so a chain of
+         * beta reductions and definitions in head position runs in a loop
+         * however long it is.
+         */
+        auto reduce_head(Term head) -> Stuck;
+
+        /**
+         * A let's definition, reduced only as far as its uses have needed so
+         * far. Each let gets a name of its own that no parsed name can clash
+         * with, and the name is looked up like a definition.
+         */
+        struct Shared
+        {
+            std::string name;
+            Term value;
+            std::optional<NormalForm> reached {};
+        };
+        std::unordered_map<std::string, Shared> shared {};
+
+        // free variables of the shared definitions; binders with these names
+        // are renamed so that a value can be put in place without capture
+        std::unordered_set<std::string> shared_free {};
+
+        auto force(Shared& binding) -> const Term&;
+
+        // binds the let's name and returns its body, still to be reduced
+        auto share(const Let& let) -> Term;
     };
 
-    auto Reducer::operator()(const Variable& variable) -> Term
+    auto Reducer::reduce_head(Term head) -> Stuck
     {
-        // attempt to substitute variable
-        auto search = context.find(variable.name);
-        if (search != context.end())
-            return reduce_term(search->second);
+        // the arguments still to be taken by the head, the next one last
+        std::vector<term_ptr> spine {};
+
+        // how deep the spine was when each contractum was entered: one is
+        // reduced to weak head normal form once the head takes an argument
+        // from below that depth
+        std::vector<std::size_t> entered {};
+        auto leave = [this, &entered](std::size_t depth)
+        {
+            for (; !entered.empty() && entered.back() >= depth; entered.pop_back())
+                --active;
+        };
 
-        // otherwise variable can't reduce so return it
-        return variable;
+        // an unfolded definition counts against the limit and the loop window
+        // like a contractum, so a definition that only ever unfolds to itself
+        // still stops
+        auto unfolded = [this, &spine, &entered](const Term& definition)
+        {
+            if (++unfoldings + beta_steps > limit)
+                throw LimitExceeded {};
+            if (cancel)
+                cancel->check(steps());
+            if (loop_window > 0)
+            {
+                enter(definition, spine.empty() ? target : NormalForm::WeakHead);
+                entered.push_back(spine.size());
+            }
+        };
+
+        while (true)
+        {
+            if (auto appl = std::get_if<Application>(&head))
+            {
+                spine.push_back(appl->rhs);
+                Term lhs {*appl->lhs};
+                head = std::move(lhs);
+                continue;
+            }
+
+            if (auto let = std::get_if<Let>(&head))
+            {
+                Term body {share(*let)};
+                head = std::move(body);
+                continue;
+            }
+
+            if (auto letrec = std::get_if<Letrec>(&head))
+            {
+                Term definition {unfold(*letrec)};
+                unfolded(definition);
+                head = std::move(definition);
+                continue;
+            }
+
+            // a numeral is a normal form until it is applied
+            auto numeral {std::get_if<Numeral>(&head)};
+            if (numeral && !spine.empty())
+            {
+                Term church {unfold(*numeral)};
+                head = std::move(church);
+                continue;
+            }
+
+            if (auto variable = std::get_if<Variable>(&head))
+            {
+                auto binding {shared.find(variable->name)};
+                if (binding != shared.end())
+                {
+                    // a value in head position only needs its own head reduced
+                    NormalForm outer {target};
+                    target = spine.empty() ? outer : NormalForm::WeakHead;
+                    Term value {force(binding->second)};
+                    target = outer;
+                    if (spine.empty())
+                    {
+                        leave(0);
+                        return {value, {}, 0, true};
+                    }
+                    head = std::move(value);
+                    continue;
+                }
+
+                // attempt to substitute variable
+                const Term* definition {definitions.find(variable->name)};
+                if (definition != nullptr)
+                {
+                    unfolded(*definition);
+                    head = *definition;
+                    continue;
+                }
+            }
+
+            // if the head is an abstraction, substitute the next argument into it
+            auto abstr {std::get_if<Abstraction>(&head)};
+            if (abstr && !spine.empty())
+            {
+                leave(spine.size());
+                if (++beta_steps + unfoldings > limit)
+                    throw LimitExceeded {};
+                if (cancel)
+                    cancel->check(steps());
+
+                // TODO: abstraction->name.name is ugly
+                Term subbed {substitute({abstr->name.name, *spine.back()}, *abstr->body)};
+                spine.pop_back();
+                if (loop_window > 0)
+                {
+                    enter(subbed, spine.empty() ? target : NormalForm::WeakHead);
+                    entered.push_back(spine.size());
+                }
+                head = std::move(subbed);
+                continue;
+            }
+            break;
+        }
+
+        return {std::move(head), std::move(spine), entered.size()};
     }
 
-    auto Reducer::operator()(const Abstraction& abstr) -> Term
+    auto Reducer::reduce(Term term, std::vector<Task>& tasks, std::vector<Term>& results) -> void
     {
-        // abstraction is value, so recursively reduce inner term and return
-        return Abstraction {abstr.name, reduce_term(*abstr.body)};
+        // a numeral is a normal form until it is applied
+        if (std::holds_alternative<Numeral>(term))
+        {
+            results.push_back(std::move(term));
+            return;
+        }
+
+        if (auto abstr = std::get_if<Abstraction>(&term))
+        {
+            // abstraction is already in weak head normal form
+            if (target == NormalForm::WeakHead)
+            {
+                results.push_back(std::move(term));
+                return;
+            }
+
+            // names are resolved lexically, so a binder named like a
+            // definition that may be unfolded under it, or like a free
+            // variable of a shared value that may be put in under it, is
+            // renamed while its body is reduced
+            auto taken = [this](const std::string& name)
+            {
+                return shared_free.count(name) > 0 || definitions.find(name) != nullptr;
+            };
+            Variable name {abstr->name};
+            Term body {*abstr->body};
+            std::string original {};
+            if (taken(name.name))
+            {
+                original = name.name;
+                name = Variable {fresh_name(original, [&taken, abstr](const std::string& candidate)
+                {
+                    return taken(candidate) || is_free(candidate, *abstr->body);
+                })};
+                body = substitute({original, name}, *abstr->body);
+            }
+
+            // then reduce the inner term under the binder
+            ++bound[name.name];
+            ++binders;
+            tasks.push_back(Bind {name, std::move(original)});
+            tasks.push_back(Reduce {std::move(body), target});
+            return;
+        }
+
+        Stuck stuck {reduce_head(std::move(term))};
+        if (stuck.normal)
+        {
+            results.push_back(std::move(stuck.head));
+            return;
+        }
+
+        // the contracta stay in the loop window until the arguments are reduced
+        if (stuck.entered > 0)
+            tasks.push_back(Leave {stuck.entered});
+        if (stuck.spine.empty())
+        {
+            if (std::holds_alternative<Abstraction>(stuck.head))
+                tasks.push_back(Reduce {std::move(stuck.head), target});
+            else
+                results.push_back(std::move(stuck.head));
+            return;
+        }
+
+        // otherwise the head is stuck, so only full normal form needs the
+        // arguments reduced
+        if (target != NormalForm::Full)
+        {
+            Term reduction {std::move(stuck.head)};
+            for (auto arg {stuck.spine.rbegin()}; arg != stuck.spine.rend(); ++arg)
+                reduction = Application {make_term(std::move(reduction)), *arg};
+            results.push_back(std::move(reduction));
+            return;
+        }
+
+        // the first argument is last on the spine, so it is reduced first
+        tasks.push_back(Apply {std::move(stuck.head), stuck.spine.size()});
+        for (const term_ptr& arg : stuck.spine)
+            tasks.push_back(Reduce {*arg, target});
+    }
+
+    auto Reducer::share(const Let& let) -> Term
+    {
+        // a definition that uses variables bound around it is only fixed
+        // once they are substituted, so until then it is copied in
+        std::unordered_set<std::string> uses {free_variables(*let.definition)};
+        for (const std::string& name : uses)
+        {
+            if (bound[name] > 0)
+                return substitute({let.name.name, *let.definition}, *let.body);
+        }
+
+        std::string name {let.name.name + "`" + std::to_string(shared.size())};
+        shared.emplace(name, Shared {let.name.name, *let.definition});
+        shared_free.insert(uses.begin(), uses.end());
+        return substitute({let.name.name, Variable {name}}, *let.body);
+    }
+
+    auto Reducer::force(Shared& binding) -> const Term&
+    {
+        // reduced at most once to each normal form, picking up from the last
+        if (!binding.reached.has_value() || binding.reached.value() < target)
+        {
+            NormalForm form {target};
+            Term value {reduce_term(binding.value, form)};
+            binding.value = std::move(value);
+            binding.reached = form;
+        }
+        return binding.value;
     }
 
-    auto Reducer::operator()(const Application& appl) -> Term
+    auto Reducer::rebind(Term reduction, bool inline_definitions) const -> Term
     {
-        // reduce left side first
-        Term lhs {reduce_term(*appl.lhs)};
+        if (shared.empty())
+            return reduction;
 
-        // if new lhs is abstraction, substitute rhs into it
-        Abstraction* lhs_as_abstr {std::get_if<Abstraction>(&lhs)};
-        if (lhs_as_abstr)
+        // the lets still referred to, each after the lets its definition uses
+        std::vector<const std::string*> order {};
+        std::unordered_set<std::string> seen {};
+        std::function<void(const Term&)> collect = [&](const Term& term)
         {
-            // TODO: abstraction->name.name is ugly
-            auto name {lhs_as_abstr->name.name};
-            auto body {*(lhs_as_abstr->body)};
-            Term subbed {substitute({name, *appl.rhs}, body)};
-            return reduce_term(subbed, context);
+            for (const std::string& name : free_variables(term))
+            {
+                auto binding {shared.find(name)};
+                if (binding != shared.end() && seen.insert(name).second)
+                {
+                    collect(binding->second.value);
+                    order.push_back(&binding->first);
+                }
+            }
+        };
+        collect(reduction);
+
+        for (auto it {order.rbegin()}; it != order.rend(); ++it)
+        {
+            const Shared& binding {shared.at(**it)};
+            if (inline_definitions)
+            {
+                reduction = substitute({**it, binding.value}, reduction);
+                continue;
+            }
+
+            std::string name {fresh_name(binding.name, [&reduction](const std::string& candidate)
+            {
+                return is_free(candidate, reduction);
+            })};
+            Term body {substitute({**it, Variable {name}}, reduction)};
+            reduction = Let {std::move(name), make_term(binding.value), make_term(std::move(body))};
+        }
+        return reduction;
+    }
+
+    auto Reducer::enter(const Term& contractum, NormalForm form) -> void
+    {
+        std::size_t hash {alpha_hash(contractum)};
+        for (std::size_t back {1}; back <= std::min(active, loop_window); ++back)
+        {
+            const Redex& seen {recent[(active - back) % loop_window]};
+            if (seen.frame == active - back && seen.hash == hash && seen.binders == binders
+                && seen.target == form && alpha_equal(seen.term, contractum))
+                throw Diverges {};
         }
-        // otherwise reduce rhs and return application
-        return Application {lhs, reduce_term(*appl.rhs)};
+
+        Redex entry {active, binders, form, hash, contractum};
+        std::size_t slot {active % loop_window};
+        if (slot == recent.size())
+            recent.push_back(std::move(entry));
+        else
+            recent[slot] = std::move(entry);
+        ++active;
     }
 
-    auto Reducer::reduce_term(const Term& term, Context local) -> Term
+    auto Reducer::reduce_term(const Term& term, NormalForm form) -> Term
     {
-        Context global {context};
-        local.merge(global);
-        Reducer reducer {local};
-        return {std::visit(reducer, term)};
+        NormalForm outer {target};
+        std::vector<Task> tasks {};
+        tasks.push_back(Reduce {term, form});
+        std::vector<Term> results {};
+        while (!tasks.empty())
+        {
+            Task task {std::move(tasks.back())};
+            tasks.pop_back();
+            if (auto next = std::get_if<Reduce>(&task))
+            {
+                target = next->form;
+                reduce(std::move(next->term), tasks, results);
+                continue;
+            }
+
+            // putting a large normal form back together takes long enough to check on
+            if (cancel)
+                cancel->check();
+            if (auto bind = std::get_if<Bind>(&task))
+            {
+                --binders;
+                --bound[bind->name.name];
+                Term body {std::move(results.back())};
+                Variable name {bind->name};
+                if (!bind->original.empty() && shared_free.count(bind->original) == 0
+                    && !is_free(bind->original, body))
+                {
+                    body = substitute({name.name, Variable {bind->original}}, body);
+                    name = Variable {bind->original};
+                }
+                results.back() = Abstraction {std::move(name), make_term(std::move(body))};
+            }
+            else if (auto apply = std::get_if<Apply>(&task))
+            {
+                Term reduction {std::move(apply->head)};
+                auto args {results.end() - static_cast<std::ptrdiff_t>(apply->arguments)};
+                for (auto arg {args}; arg != results.end(); ++arg)
+                    reduction = Application {make_term(std::move(reduction)), make_term(std::move(*arg))};
+                results.erase(args, results.end());
+                results.push_back(std::move(reduction));
+            }
+            else
+            {
+                active -= std::get<Leave>(task).entered;
+            }
+        }
+        target = outer;
+        return std::move(results.back());
     }
 
     /**
@@ -81,41 +528,87 @@ namespace lambda
      */
     auto contract_term(const Term& term, const Context& context) -> Term
     {
-        for (auto [name, val] : context)
+        return Contractions {context}(term);
+    }
+
+    auto ContextDefinitions::find(const std::string& name) const -> const Term*
+    {
+        auto search {context.find(name)};
+        if (search != context.end())
+            return &search->second;
+        if (fallback != nullptr)
+            return fallback->find(name);
+        return nullptr;
+    }
+
+    auto reduce(const Term& term, const Context& context, NormalForm target) -> Term
+    {
+        return reduce(term, ContextDefinitions {context}, target);
+    }
+
+    auto reduce(const Term& term, const Definitions& definitions, NormalForm target) -> Term
+    {
+        instrument::PhaseScope scope {instrument::Phase::Reduce};
+        Hoisted hoisted {hoist_letrecs(term, definitions)};
+        ContextDefinitions scope_definitions {hoisted.definitions, &definitions};
+        Reducer reducer {scope_definitions, target};
+        return reducer.rebind(reducer.reduce_term(hoisted.term, target));
+    }
+
+    auto reduce(const Term& term, const Definitions& definitions, NormalForm target,
+                std::size_t limit, std::size_t* steps, CancelToken* cancel, std::size_t loop_window) -> ReduceResult
+    {
+        instrument::PhaseScope scope {instrument::Phase::Reduce};
+        Hoisted hoisted {hoist_letrecs(term, definitions)};
+        ContextDefinitions scope_definitions {hoisted.definitions, &definitions};
+        Reducer reducer {scope_definitions, target, limit, cancel, loop_window};
+        CheckScope checked {cancel};
+        try
+        {
+            Term reduction {reducer.rebind(reducer.reduce_term(hoisted.term, target))};
+            if (steps)
+                *steps = reducer.steps();
+            return ReduceResult::make_ok(std::move(reduction));
+        }
+        catch (LimitExceeded&)
         {
-            if (term == val) return Variable {name};
+            if (steps)
+                *steps = reducer.steps();
+            return ReduceResult::make_err("Reduction limit exceeded");
         }
-        const Abstraction* term_as_abstr {std::get_if<Abstraction>(&term)};
-        if (term_as_abstr != nullptr)
+        catch (Interrupted& interrupted)
         {
-            const Abstraction& abstr {*term_as_abstr};
-            return Abstraction {abstr.name, contract_term(*abstr.body, context)};
+            if (steps)
+                *steps = reducer.steps();
+            return ReduceResult::make_err(interrupted.reason);
         }
-        auto term_as_appl {std::get_if<Application>(&term)};
-        if (term_as_appl != nullptr)
+        catch (Diverges&)
         {
-            const Application& appl {*term_as_appl};
-            return Application {contract_term(*appl.lhs, context), contract_term(*appl.rhs, context)};
+            if (steps)
+                *steps = reducer.steps();
+            return ReduceResult::make_err("Term diverges: a redex needs itself reduced");
         }
-        return term;
     }
 
-    auto reduce(const Term& term, const Context& context) -> Term
+    auto evaluate(const Term& term, const Context& context, NormalForm target) -> EvalResult
     {
-        Reducer reducer {context};
-        Term reduction {reducer.reduce_term(term)};
-        return reducer.reduce_term(term);
+        return evaluate(term, ContextDefinitions {context}, target);
     }
 
-    auto evaluate(const Term& term, const Context& context) -> EvalResult
+    auto evaluate(const Term& term, const Definitions& definitions, NormalForm target) -> EvalResult
     {
-        Reducer reducer {context};
-        Term reduction {reducer.reduce_term(term, context)};
+        instrument::PhaseScope scope {instrument::Phase::Reduce};
+        Hoisted hoisted {hoist_letrecs(term, definitions)};
+        ContextDefinitions scope_definitions {hoisted.definitions, &definitions};
+        Reducer reducer {scope_definitions, target};
+        Term reduction {reducer.rebind(reducer.reduce_term(hoisted.term, target), true)};
+        if (auto numeral = std::get_if<Numeral>(&reduction))
+            reduction = unfold(*numeral);
 
         // only abstractions are values
         Abstraction* result_as_abstr {std::get_if<Abstraction>(&reduction)};
         if (result_as_abstr)
-            return EvalResult::make_ok(*result_as_abstr);
+            return EvalResult::make_ok(std::move(*result_as_abstr));
 
         // otherwise raise error
         std::stringstream err_msg {};
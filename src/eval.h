@@ -20,9 +20,68 @@ namespace lambda
 
     using EvalResult = result::Result<Value, lang_tools::EvalErr>;
 
-    auto reduce(const Term& term, const Context& context = {}) -> Term;
+    using ReduceResult = result::Result<Term, lang_tools::EvalErr>;
+
+    /**
+     * Where evaluation looks up names that are free in the term.
+     */
+    class Definitions
+    {
+    public:
+        virtual ~Definitions() = default;
+
+        // nullptr if the name is not defined
+        virtual auto find(const std::string& name) const -> const Term* = 0;
+    };
+
+    /**
+     * Definitions from a context, falling back to another set of definitions
+     * for names the context doesn't have.
+     */
+    class ContextDefinitions : public Definitions
+    {
+    public:
+        explicit ContextDefinitions(const Context& context, const Definitions* fallback = nullptr)
+            : context {context}, fallback {fallback} {}
+
+        auto find(const std::string& name) const -> const Term* override;
+
+    private:
+        const Context& context;
+        const Definitions* fallback;
+    };
+
+    /**
+     * How far reduction goes:
+     *   WeakHead   stops at an abstraction or an application with a stuck head
+     *   Head       also reduces under abstractions, but not in arguments
+     *   Full       the full normal form
+     */
+    enum class NormalForm {WeakHead, Head, Full};
+
+    auto reduce(const Term& term, const Context& context = {},
+                NormalForm target = NormalForm::Full) -> Term;
+    auto reduce(const Term& term, const Definitions& definitions,
+                NormalForm target = NormalForm::Full) -> Term;
+
+    class CancelToken;
+
+    // gives up after `limit` steps, each a beta reduction or a definition
+    // unfolded, or when cancel is cancelled; steps receives the number made.
+    // With a non-zero loop_window it also gives up when a contractum recurs
+    // within that many nested reductions of itself, which can only mean the
+    // reduction never ends
+    auto reduce(const Term& term, const Definitions& definitions, NormalForm target,
+                std::size_t limit, std::size_t* steps = nullptr, CancelToken* cancel = nullptr,
+                std::size_t loop_window = 0) -> ReduceResult;
     auto contract_term(const Term& term, const Context& context) -> Term;
-    auto evaluate(const Term& term, const Context& context) -> EvalResult;
+
+    // evaluation only has to produce an abstraction, so by default it
+    // leaves the abstraction's body unreduced
+    auto evaluate(const Term& term, const Context& context,
+                  NormalForm target = NormalForm::WeakHead) -> EvalResult;
+    auto evaluate(const Term& term, const Definitions& definitions,
+                  NormalForm target = NormalForm::WeakHead) -> EvalResult;
 };
 
 
@@ -0,0 +1,102 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "fixed_term.h"
+
+namespace lambda::fixed
+{
+    namespace
+    {
+        class Converter
+        {
+        public:
+            Converter(const Node* nodes, std::size_t root) : nodes {nodes}
+            {
+                for_each_free(root, [this](std::string_view name)
+                {
+                    free_names.emplace_back(name);
+                });
+            }
+
+            auto operator ()(std::size_t node) -> Term
+            {
+                const Node& n {nodes[node]};
+                switch (n.kind)
+                {
+                    case Kind::Variable:
+                        if (n.bound)
+                            return Variable {scope[scope.size() - 1 - n.index]};
+                        return Variable {std::string {n.name}};
+
+                    case Kind::Application:
+                        return Application {(*this)(n.lhs), (*this)(n.rhs)};
+
+                    case Kind::Abstraction:
+                    {
+                        // a binder that reuses an enclosing name, or the name of a
+                        // free variable in its body, would capture references to it
+                        std::string name {fresh_name(std::string {n.name}, [this, &n](const std::string& candidate)
+                        {
+                            return std::find(scope.begin(), scope.end(), candidate) != scope.end()
+                                   || free_in(candidate, n.lhs);
+                        })};
+
+                        scope.push_back(name);
+                        Term body {(*this)(n.lhs)};
+                        scope.pop_back();
+                        return Abstraction {Variable {std::move(name)}, std::move(body)};
+                    }
+                }
+                throw std::logic_error("Unknown node kind");
+            }
+
+        private:
+            const Node* nodes;
+            std::vector<std::string> scope {};
+
+            // names of the free variables anywhere in the term
+            std::vector<std::string> free_names {};
+
+            template <typename F>
+            auto for_each_free(std::size_t node, F&& f) const -> void
+            {
+                std::vector<std::size_t> pending {node};
+                while (!pending.empty())
+                {
+                    const Node& n {nodes[pending.back()]};
+                    pending.pop_back();
+                    if (n.kind == Kind::Variable && !n.bound)
+                        f(n.name);
+                    else if (n.kind == Kind::Application)
+                        pending.insert(pending.end(), {n.rhs, n.lhs});
+                    else if (n.kind == Kind::Abstraction)
+                        pending.push_back(n.lhs);
+                }
+            }
+
+            // only searches the body when the name is free somewhere in the term
+            auto free_in(const std::string& name, std::size_t body) const -> bool
+            {
+                if (std::find(free_names.begin(), free_names.end(), name) == free_names.end())
+                    return false;
+
+                bool found {false};
+                for_each_free(body, [&name, &found](std::string_view free)
+                {
+                    found = found || free == name;
+                });
+                return found;
+            }
+        };
+    }
+
+    auto to_term(const Node* nodes, std::size_t root) -> Term
+    {
+        return Converter {nodes, root}(root);
+    }
+}
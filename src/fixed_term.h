@@ -0,0 +1,410 @@
+//
+// Created by colin on 10/19/26.
+//
+
+/**
+ * Terms that can be built and reduced at compile time. Nodes live in a
+ * fixed-size array and variables are de Bruijn indices, so everything here
+ * is constexpr; binder names are kept only so that the runtime Term they
+ * convert to reads the same as the source.
+ *
+ * Used for combinators that are baked into the program and for checking
+ * identities with static_assert.
+ */
+
+#ifndef LAMBDA_FIXED_TERM_H
+#define LAMBDA_FIXED_TERM_H
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+
+#include "parse.h"
+
+namespace lambda::fixed
+{
+    enum class Kind : unsigned char {Variable, Application, Abstraction};
+
+    struct Node
+    {
+        Kind kind {Kind::Variable};
+
+        // binder name of an abstraction, or the name of a free variable
+        std::string_view name {};
+
+        // de Bruijn index of a bound variable
+        bool bound {false};
+        std::size_t index {0};
+
+        // function and argument of an application; lhs is an abstraction's body
+        std::size_t lhs {0};
+        std::size_t rhs {0};
+    };
+
+    // builds the runtime term rooted at nodes[root]
+    auto to_term(const Node* nodes, std::size_t root) -> Term;
+
+    template <std::size_t Capacity>
+    class FixedTerm
+    {
+    public:
+        constexpr FixedTerm() = default;
+
+        constexpr auto root() const -> std::size_t
+        {
+            return top;
+        }
+
+        constexpr auto size() const -> std::size_t
+        {
+            return count;
+        }
+
+        constexpr auto operator [](std::size_t i) const -> const Node&
+        {
+            return nodes[i];
+        }
+
+        constexpr auto add(const Node& node) -> std::size_t
+        {
+            if (count == Capacity)
+                throw std::length_error("Fixed term capacity exceeded");
+            nodes[count] = node;
+            return count++;
+        }
+
+        constexpr auto set_root(std::size_t node) -> void
+        {
+            top = node;
+        }
+
+        auto to_term() const -> Term
+        {
+            return fixed::to_term(nodes.data(), top);
+        }
+
+    private:
+        std::array<Node, Capacity> nodes {};
+        std::size_t count {0};
+        std::size_t top {0};
+    };
+
+    namespace detail
+    {
+        // copies a subterm, adding `shift` to the indices of variables bound above `cutoff`
+        template <std::size_t From, std::size_t To>
+        constexpr auto copy(const FixedTerm<From>& src, std::size_t node, FixedTerm<To>& out,
+                            std::size_t cutoff = 0, std::size_t shift = 0) -> std::size_t
+        {
+            Node n {src[node]};
+            switch (n.kind)
+            {
+                case Kind::Variable:
+                    if (n.bound && n.index >= cutoff)
+                        n.index += shift;
+                    return out.add(n);
+
+                case Kind::Application:
+                    n.lhs = copy(src, n.lhs, out, cutoff, shift);
+                    n.rhs = copy(src, n.rhs, out, cutoff, shift);
+                    return out.add(n);
+
+                case Kind::Abstraction:
+                    n.lhs = copy(src, n.lhs, out, cutoff + 1, shift);
+                    return out.add(n);
+            }
+            throw std::logic_error("Unknown node kind");
+        }
+
+        // copies `body` with the variable bound `depth` binders above it replaced by `arg`
+        template <std::size_t From, std::size_t To>
+        constexpr auto substitute(const FixedTerm<From>& src, std::size_t body, std::size_t depth,
+                                  std::size_t arg, FixedTerm<To>& out) -> std::size_t
+        {
+            Node n {src[body]};
+            switch (n.kind)
+            {
+                case Kind::Variable:
+                    if (n.bound && n.index == depth)
+                        return copy(src, arg, out, 0, depth);
+                    if (n.bound && n.index > depth)
+                        --n.index;
+                    return out.add(n);
+
+                case Kind::Application:
+                    n.lhs = substitute(src, n.lhs, depth, arg, out);
+                    n.rhs = substitute(src, n.rhs, depth, arg, out);
+                    return out.add(n);
+
+                case Kind::Abstraction:
+                    n.lhs = substitute(src, n.lhs, depth + 1, arg, out);
+                    return out.add(n);
+            }
+            throw std::logic_error("Unknown node kind");
+        }
+
+        // copies a subterm, contracting its leftmost outermost redex if it has not been done yet
+        template <std::size_t From, std::size_t To>
+        constexpr auto step(const FixedTerm<From>& src, std::size_t node, FixedTerm<To>& out,
+                            bool& reduced) -> std::size_t
+        {
+            if (reduced)
+                return copy(src, node, out);
+
+            Node n {src[node]};
+            switch (n.kind)
+            {
+                case Kind::Variable:
+                    return out.add(n);
+
+                case Kind::Application:
+                    if (src[n.lhs].kind == Kind::Abstraction)
+                    {
+                        reduced = true;
+                        return substitute(src, src[n.lhs].lhs, 0, n.rhs, out);
+                    }
+                    n.lhs = step(src, n.lhs, out, reduced);
+                    n.rhs = step(src, n.rhs, out, reduced);
+                    return out.add(n);
+
+                case Kind::Abstraction:
+                    n.lhs = step(src, n.lhs, out, reduced);
+                    return out.add(n);
+            }
+            throw std::logic_error("Unknown node kind");
+        }
+
+        template <std::size_t L, std::size_t R>
+        constexpr auto equal(const FixedTerm<L>& lhs, std::size_t l, const FixedTerm<R>& rhs, std::size_t r) -> bool
+        {
+            const Node& a {lhs[l]};
+            const Node& b {rhs[r]};
+            if (a.kind != b.kind)
+                return false;
+
+            switch (a.kind)
+            {
+                case Kind::Variable:
+                    if (a.bound != b.bound)
+                        return false;
+                    return a.bound ? a.index == b.index : a.name == b.name;
+
+                case Kind::Application:
+                    return equal(lhs, a.lhs, rhs, b.lhs) && equal(lhs, a.rhs, rhs, b.rhs);
+
+                case Kind::Abstraction:
+                    return equal(lhs, a.lhs, rhs, b.lhs);
+            }
+            throw std::logic_error("Unknown node kind");
+        }
+
+        // adds \s.\z. s (s (... z)), returning its root
+        template <std::size_t Capacity>
+        constexpr auto add_numeral(FixedTerm<Capacity>& out, std::size_t value) -> std::size_t
+        {
+            std::size_t body {out.add({Kind::Variable, "z", true, 0})};
+            for (std::size_t i {0}; i < value; ++i)
+            {
+                std::size_t s {out.add({Kind::Variable, "s", true, 1})};
+                body = out.add({Kind::Application, {}, false, 0, s, body});
+            }
+            std::size_t z_abstr {out.add({Kind::Abstraction, "z", false, 0, body})};
+            return out.add({Kind::Abstraction, "s", false, 0, z_abstr});
+        }
+
+        template <std::size_t Capacity>
+        class Parser
+        {
+        public:
+            constexpr explicit Parser(std::string_view text) : text {text} {}
+
+            constexpr auto parse() -> FixedTerm<Capacity>
+            {
+                out.set_root(parse_term());
+                skip_spaces();
+                if (pos != text.size())
+                    throw std::invalid_argument("Characters remaining after parsing");
+                return out;
+            }
+
+        private:
+            std::string_view text;
+            std::size_t pos {0};
+            FixedTerm<Capacity> out {};
+
+            // names of the enclosing binders, innermost last
+            std::array<std::string_view, Capacity> scope {};
+            std::size_t depth {0};
+
+            static constexpr auto is_alpha(char c) -> bool
+            {
+                return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+            }
+
+            static constexpr auto is_digit(char c) -> bool
+            {
+                return c >= '0' && c <= '9';
+            }
+
+            constexpr auto skip_spaces() -> void
+            {
+                while (pos < text.size() && text[pos] == ' ')
+                    ++pos;
+            }
+
+            constexpr auto peek() -> char
+            {
+                skip_spaces();
+                return pos < text.size() ? text[pos] : '\0';
+            }
+
+            constexpr auto expect(char c) -> void
+            {
+                if (peek() != c)
+                    throw std::invalid_argument("Unexpected character");
+                ++pos;
+            }
+
+            constexpr auto parse_name() -> std::string_view
+            {
+                if (!is_alpha(peek()))
+                    throw std::invalid_argument("Expected a name");
+                std::size_t start {pos};
+                while (pos < text.size() && is_alpha(text[pos]))
+                    ++pos;
+                return text.substr(start, pos - start);
+            }
+
+            constexpr auto parse_numeral() -> std::size_t
+            {
+                std::size_t value {0};
+                while (pos < text.size() && is_digit(text[pos]))
+                    value = value * 10 + static_cast<std::size_t>(text[pos++] - '0');
+
+                return add_numeral(out, value);
+            }
+
+            constexpr auto parse_variable() -> std::size_t
+            {
+                std::string_view name {parse_name()};
+                for (std::size_t i {depth}; i > 0; --i)
+                {
+                    if (scope[i - 1] == name)
+                        return out.add({Kind::Variable, name, true, depth - i});
+                }
+                return out.add({Kind::Variable, name});
+            }
+
+            constexpr auto parse_atom() -> std::size_t
+            {
+                char c {peek()};
+                if (c == '(')
+                {
+                    ++pos;
+                    std::size_t term {parse_term()};
+                    expect(')');
+                    return term;
+                }
+                if (is_digit(c))
+                    return parse_numeral();
+                return parse_variable();
+            }
+
+            constexpr auto parse_application() -> std::size_t
+            {
+                std::size_t term {parse_atom()};
+                while (peek() != '\0' && peek() != ')')
+                {
+                    std::size_t arg {parse_atom()};
+                    term = out.add({Kind::Application, {}, false, 0, term, arg});
+                }
+                return term;
+            }
+
+            constexpr auto parse_term() -> std::size_t
+            {
+                if (peek() != '\\')
+                    return parse_application();
+
+                ++pos;
+                std::string_view name {parse_name()};
+                expect('.');
+
+                scope[depth++] = name;
+                std::size_t body {parse_term()};
+                --depth;
+                return out.add({Kind::Abstraction, name, false, 0, body});
+            }
+        };
+    }
+
+    /**
+     * Parses the REPL's term syntax, including numerals. Errors are thrown,
+     * so a bad term in a constant expression fails to compile.
+     */
+    template <std::size_t Capacity>
+    constexpr auto parse(std::string_view text) -> FixedTerm<Capacity>
+    {
+        return detail::Parser<Capacity> {text}.parse();
+    }
+
+    template <std::size_t Capacity>
+    constexpr auto numeral(std::size_t value) -> FixedTerm<Capacity>
+    {
+        FixedTerm<Capacity> out {};
+        out.set_root(detail::add_numeral(out, value));
+        return out;
+    }
+
+    template <std::size_t L, std::size_t R>
+    constexpr auto apply(const FixedTerm<L>& lhs, const FixedTerm<R>& rhs) -> FixedTerm<L + R + 1>
+    {
+        FixedTerm<L + R + 1> out {};
+        std::size_t function {detail::copy(lhs, lhs.root(), out)};
+        std::size_t argument {detail::copy(rhs, rhs.root(), out)};
+        out.set_root(out.add({Kind::Application, {}, false, 0, function, argument}));
+        return out;
+    }
+
+    template <std::size_t L, std::size_t R, typename ...Rest>
+    constexpr auto apply(const FixedTerm<L>& lhs, const FixedTerm<R>& rhs, const Rest& ...rest)
+    {
+        return apply(apply(lhs, rhs), rest...);
+    }
+
+    /**
+     * Reduces to full normal form in normal order. Capacity bounds the size
+     * of every intermediate term (it defaults to the input's capacity) and
+     * fuel bounds the number of beta steps; running out of either throws.
+     */
+    template <std::size_t Capacity = 0, std::size_t N>
+    constexpr auto normalize(const FixedTerm<N>& term, std::size_t fuel = 10'000)
+    {
+        constexpr std::size_t size {Capacity == 0 ? N : Capacity};
+
+        FixedTerm<size> current {};
+        current.set_root(detail::copy(term, term.root(), current));
+        while (true)
+        {
+            FixedTerm<size> next {};
+            bool reduced {false};
+            next.set_root(detail::step(current, current.root(), next, reduced));
+            if (!reduced)
+                return current;
+
+            if (fuel-- == 0)
+                throw std::length_error("Fixed term did not reach a normal form");
+            current = next;
+        }
+    }
+
+    // alpha equivalence
+    template <std::size_t L, std::size_t R>
+    constexpr auto operator ==(const FixedTerm<L>& lhs, const FixedTerm<R>& rhs) -> bool
+    {
+        return detail::equal(lhs, lhs.root(), rhs, rhs.root());
+    }
+}
+
+#endif //LAMBDA_FIXED_TERM_H
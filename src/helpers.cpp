@@ -8,7 +8,7 @@ namespace lambda
 {
     auto app(Term lhs, Term rhs) -> Term
     {
-        return Application{lhs, rhs};
+        return Application{std::move(lhs), std::move(rhs)};
     }
 
     auto var(std::string name) -> Term
@@ -18,6 +18,6 @@ namespace lambda
 
     auto lam(std::string name, Term body) -> Term
     {
-        return Abstraction{std::move(name), body};
+        return Abstraction{std::move(name), std::move(body)};
     }
 }
\ No newline at end of file
@@ -0,0 +1,165 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <stdexcept>
+
+#include "instrument.h"
+
+namespace lambda::instrument
+{
+    namespace
+    {
+        struct Counters
+        {
+            std::atomic<std::size_t> allocations {0};
+            std::atomic<std::size_t> bytes {0};
+        };
+
+        std::atomic<bool> tracking {false};
+        std::array<Counters, phase_count> counters {};
+        // signed, since a node allocated before tracking was enabled can be
+        // released while it is on
+        std::atomic<std::ptrdiff_t> live_nodes {0};
+        std::atomic<std::ptrdiff_t> peak_nodes {0};
+
+        thread_local Phase phase {Phase::Other};
+
+        auto index(Phase p) -> std::size_t
+        {
+            return static_cast<std::size_t>(p);
+        }
+
+        auto count(std::size_t bytes) -> void
+        {
+            Counters& c {counters[index(phase)]};
+            c.allocations.fetch_add(1, std::memory_order_relaxed);
+            c.bytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+    }
+
+    auto Report::operator [](Phase p) const -> const PhaseStats&
+    {
+        return phases[index(p)];
+    }
+
+    auto enable(bool on) -> void
+    {
+        tracking.store(on, std::memory_order_relaxed);
+    }
+
+    auto enabled() -> bool
+    {
+        return tracking.load(std::memory_order_relaxed);
+    }
+
+    auto reset() -> void
+    {
+        for (Counters& c : counters)
+        {
+            c.allocations.store(0, std::memory_order_relaxed);
+            c.bytes.store(0, std::memory_order_relaxed);
+        }
+        peak_nodes.store(live_nodes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    auto report() -> Report
+    {
+        Report r {};
+        for (std::size_t i {0}; i < phase_count; ++i)
+        {
+            r.phases[i].allocations = counters[i].allocations.load(std::memory_order_relaxed);
+            r.phases[i].bytes = counters[i].bytes.load(std::memory_order_relaxed);
+        }
+        r.live_nodes = static_cast<std::size_t>(std::max<std::ptrdiff_t>(live_nodes.load(std::memory_order_relaxed), 0));
+        r.peak_nodes = static_cast<std::size_t>(std::max<std::ptrdiff_t>(peak_nodes.load(std::memory_order_relaxed), 0));
+        return r;
+    }
+
+    auto current_phase() -> Phase
+    {
+        return phase;
+    }
+
+    auto as_string(Phase p) -> std::string
+    {
+        switch (p)
+        {
+            case Phase::Other:
+                return "other";
+
+            case Phase::Lex:
+                return "lex";
+
+            case Phase::Parse:
+                return "parse";
+
+            case Phase::Reduce:
+                return "reduce";
+
+            case Phase::Substitute:
+                return "substitute";
+
+            case Phase::Contract:
+                return "contract";
+
+            case Phase::Print:
+                return "print";
+        }
+
+        throw std::logic_error("Unknown phase");
+    }
+
+    auto operator <<(std::ostream& out, const Report& report) -> std::ostream&
+    {
+        for (std::size_t i {0}; i < phase_count; ++i)
+        {
+            out << std::left << std::setw(12) << as_string(static_cast<Phase>(i))
+                << std::right << std::setw(10) << report.phases[i].allocations << " allocs"
+                << std::setw(12) << report.phases[i].bytes << " bytes"
+                << std::endl;
+        }
+        out << "live nodes: " << report.live_nodes
+            << ", peak: " << report.peak_nodes;
+        return out;
+    }
+
+    auto record_node(std::size_t bytes) -> void
+    {
+        if (!enabled())
+            return;
+
+        std::ptrdiff_t live {live_nodes.fetch_add(1, std::memory_order_relaxed) + 1};
+        std::ptrdiff_t peak {peak_nodes.load(std::memory_order_relaxed)};
+        while (live > peak && !peak_nodes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        {}
+
+        count(bytes);
+    }
+
+    auto release_node(std::size_t) -> void
+    {
+        if (enabled())
+            live_nodes.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    auto record_bytes(std::size_t bytes) -> void
+    {
+        if (enabled())
+            count(bytes);
+    }
+
+    PhaseScope::PhaseScope(Phase p)
+        : previous {phase}
+    {
+        phase = p;
+    }
+
+    PhaseScope::~PhaseScope()
+    {
+        phase = previous;
+    }
+}
@@ -0,0 +1,111 @@
+//
+// Created by colin on 10/19/26.
+//
+
+/**
+ * Allocation accounting for term nodes and tokens, broken down by the phase
+ * of the pipeline that was running when the allocation happened.
+ */
+
+#ifndef LAMBDA_INSTRUMENT_H
+#define LAMBDA_INSTRUMENT_H
+
+#include <array>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace lambda::instrument
+{
+    enum class Phase {Other, Lex, Parse, Reduce, Substitute, Contract, Print};
+
+    constexpr std::size_t phase_count {7};
+
+    struct PhaseStats
+    {
+        std::size_t allocations {0};
+        std::size_t bytes {0};
+    };
+
+    struct Report
+    {
+        std::array<PhaseStats, phase_count> phases {};
+        std::size_t live_nodes {0};
+        std::size_t peak_nodes {0};
+
+        auto operator [](Phase phase) const -> const PhaseStats&;
+    };
+
+    // nothing is counted while tracking is off, so the live node count only
+    // covers nodes allocated and released while it is on
+    auto enable(bool on = true) -> void;
+    auto enabled() -> bool;
+
+    // clears the per-phase counters and restarts peak tracking from the
+    // current number of live nodes
+    auto reset() -> void;
+    auto report() -> Report;
+
+    auto current_phase() -> Phase;
+    auto as_string(Phase phase) -> std::string;
+    auto operator <<(std::ostream& out, const Report& report) -> std::ostream&;
+
+    // accounting hooks
+    auto record_node(std::size_t bytes) -> void;
+    auto release_node(std::size_t bytes) -> void;
+    auto record_bytes(std::size_t bytes) -> void;
+
+    /**
+     * Attributes allocations made on this thread to a phase for as long as
+     * the scope is alive. Scopes nest, so a numeral built while parsing is
+     * charged to parsing.
+     */
+    class PhaseScope
+    {
+    public:
+        explicit PhaseScope(Phase phase);
+        ~PhaseScope();
+
+        PhaseScope(const PhaseScope&) = delete;
+        auto operator =(const PhaseScope&) -> PhaseScope& = delete;
+
+    private:
+        Phase previous;
+    };
+
+    /**
+     * Allocator used for term nodes. Every allocation it makes is one node
+     * (the term together with its shared_ptr control block).
+     */
+    template <typename T>
+    struct Allocator
+    {
+        using value_type = T;
+
+        Allocator() = default;
+
+        template <typename U>
+        Allocator(const Allocator<U>&) noexcept {}
+
+        auto allocate(std::size_t n) -> T*
+        {
+            record_node(n * sizeof(T));
+            return std::allocator<T> {}.allocate(n);
+        }
+
+        auto deallocate(T* ptr, std::size_t n) noexcept -> void
+        {
+            release_node(n * sizeof(T));
+            std::allocator<T> {}.deallocate(ptr, n);
+        }
+
+        template <typename U>
+        auto operator ==(const Allocator<U>&) const noexcept -> bool
+        {
+            return true;
+        }
+    };
+}
+
+#endif //LAMBDA_INSTRUMENT_H
@@ -0,0 +1,204 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "letrec.h"
+
+namespace lambda
+{
+    namespace
+    {
+        auto has_letrec(const Term& term) -> bool
+        {
+            std::vector<const Term*> pending {&term};
+            while (!pending.empty())
+            {
+                const Term& next {*pending.back()};
+                pending.pop_back();
+                if (std::holds_alternative<Letrec>(next))
+                    return true;
+                if (auto abstr = std::get_if<Abstraction>(&next))
+                {
+                    pending.push_back(&*abstr->body);
+                }
+                else if (auto appl = std::get_if<Application>(&next))
+                {
+                    pending.push_back(&*appl->rhs);
+                    pending.push_back(&*appl->lhs);
+                }
+                else if (auto let = std::get_if<Let>(&next))
+                {
+                    pending.push_back(&*let->body);
+                    pending.push_back(&*let->definition);
+                }
+            }
+            return false;
+        }
+
+        // abstraction and let binders, which a hoisted name must not be captured by
+        auto collect_binders(const Term& term, std::unordered_set<std::string>& names) -> void
+        {
+            std::vector<const Term*> pending {&term};
+            while (!pending.empty())
+            {
+                const Term& next {*pending.back()};
+                pending.pop_back();
+                if (auto abstr = std::get_if<Abstraction>(&next))
+                {
+                    names.insert(abstr->name.name);
+                    pending.push_back(&*abstr->body);
+                }
+                else if (auto appl = std::get_if<Application>(&next))
+                {
+                    pending.push_back(&*appl->rhs);
+                    pending.push_back(&*appl->lhs);
+                }
+                else if (auto let = std::get_if<Let>(&next))
+                {
+                    names.insert(let->name.name);
+                    pending.push_back(&*let->body);
+                    pending.push_back(&*let->definition);
+                }
+                else if (auto letrec = std::get_if<Letrec>(&next))
+                {
+                    pending.push_back(&*letrec->body);
+                    pending.push_back(&*letrec->definition);
+                }
+            }
+        }
+
+        class Hoister
+        {
+        public:
+            Hoister(const Term& term, const Definitions& definitions, bool lift_enclosing)
+                : definitions {definitions}, lift_enclosing {lift_enclosing}, taken {free_variables(term)}
+            {
+                collect_binders(term, taken);
+            }
+
+            auto operator ()(const Term& term) -> Term
+            {
+                if (auto abstr = std::get_if<Abstraction>(&term))
+                {
+                    ++enclosing[abstr->name.name];
+                    Term body {(*this)(*abstr->body)};
+                    --enclosing[abstr->name.name];
+                    return Abstraction {abstr->name, std::move(body)};
+                }
+
+                if (auto appl = std::get_if<Application>(&term))
+                    return Application {(*this)(*appl->lhs), (*this)(*appl->rhs)};
+
+                if (auto let = std::get_if<Let>(&term))
+                {
+                    Term definition {(*this)(*let->definition)};
+                    ++enclosing[let->name.name];
+                    Term body {(*this)(*let->body)};
+                    --enclosing[let->name.name];
+                    return Let {let->name, make_term(std::move(definition)), make_term(std::move(body))};
+                }
+
+                if (auto letrec = std::get_if<Letrec>(&term))
+                    return hoist(*letrec);
+
+                return term;
+            }
+
+            Context hoisted {};
+
+        private:
+            const Definitions& definitions;
+            bool lift_enclosing;
+
+            // names the hoisted ones must not clash with
+            std::unordered_set<std::string> taken;
+
+            // variables bound around the subterm being hoisted from
+            std::unordered_map<std::string, std::size_t> enclosing {};
+
+            auto hoist(const Letrec& letrec) -> Term
+            {
+                const std::string& name {letrec.name.name};
+                std::unordered_set<std::string> uses {free_variables(*letrec.definition)};
+                uses.erase(name);
+                std::vector<std::string> captured {};
+                for (const std::string& use : uses)
+                {
+                    if (enclosing[use] > 0)
+                        captured.push_back(use);
+                }
+                std::sort(captured.begin(), captured.end());
+
+                if (!captured.empty() && !lift_enclosing)
+                {
+                    ++enclosing[name];
+                    Term definition {(*this)(*letrec.definition)};
+                    Term body {(*this)(*letrec.body)};
+                    --enclosing[name];
+                    return Letrec {letrec.name, make_term(std::move(definition)), make_term(std::move(body))};
+                }
+
+                // each use becomes the hoisted name applied to the captured variables
+                std::string global {fresh(name)};
+                Term use {Variable {global}};
+                for (const std::string& variable : captured)
+                    use = Application {std::move(use), Variable {variable}};
+
+                Term definition {*letrec.definition};
+                Term body {*letrec.body};
+                if (global != name || !captured.empty())
+                {
+                    definition = substitute({name, use}, definition);
+                    body = substitute({name, use}, body);
+                }
+                for (auto variable {captured.rbegin()}; variable != captured.rend(); ++variable)
+                    definition = Abstraction {*variable, std::move(definition)};
+
+                // nothing bound around the letrec is visible in its definition
+                std::unordered_map<std::string, std::size_t> outside {};
+                std::swap(outside, enclosing);
+                Term hoisted_definition {(*this)(definition)};
+                std::swap(outside, enclosing);
+
+                hoisted.emplace(global, std::move(hoisted_definition));
+                return (*this)(body);
+            }
+
+            auto fresh(const std::string& name) -> std::string
+            {
+                std::string candidate {fresh_name(name, [this](const std::string& candidate)
+                {
+                    return taken.count(candidate) > 0 || definitions.find(candidate) != nullptr;
+                })};
+                taken.insert(candidate);
+                return candidate;
+            }
+        };
+    }
+
+    auto hoist_letrecs(const Term& term, const Definitions& definitions, bool lift_enclosing) -> Hoisted
+    {
+        if (!has_letrec(term))
+            return {term, {}};
+
+        Hoister hoister {term, definitions, lift_enclosing};
+        Term hoisted {hoister(term)};
+        return {std::move(hoisted), std::move(hoister.hoisted)};
+    }
+
+    auto unfold(const Letrec& letrec) -> Term
+    {
+        const std::string& name {letrec.name.name};
+        Term self {Letrec {letrec.name, letrec.definition, make_term(Variable {name})}};
+
+        auto body_var {std::get_if<Variable>(&*letrec.body)};
+        const Term& unfolded {body_var && body_var->name == name ? *letrec.definition : *letrec.body};
+        return substitute({name, std::move(self)}, unfolded);
+    }
+}
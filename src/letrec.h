@@ -0,0 +1,47 @@
+//
+// Created by colin on 10/19/26.
+//
+
+/**
+ * Recursive bindings. Before reducing, each letrec whose definition uses
+ * nothing bound around it (only its own name and global definitions) is
+ * moved out of the term into definitions of its own, under a name that
+ * clashes with nothing else. A reducer then follows the recursion by
+ * looking the name up, the same way it follows a recursive global
+ * definition, instead of copying the definition at every unfolding.
+ *
+ * A letrec that does use variables bound around it is either left in the
+ * term, for the tree reducer to unfold, or lambda lifted: the hoisted
+ * definition takes those variables as extra parameters, and each use of
+ * the name becomes the hoisted name applied to them.
+ */
+
+#ifndef LAMBDA_LETREC_H
+#define LAMBDA_LETREC_H
+
+#include "eval.h"
+
+namespace lambda
+{
+    struct Hoisted
+    {
+        Term term;
+
+        // the hoisted definitions, which may refer to each other and to the
+        // definitions the term was hoisted against
+        Context definitions;
+
+    };
+
+    // with lift_enclosing, no letrec is left in the term
+    auto hoist_letrecs(const Term& term, const Definitions& definitions, bool lift_enclosing = false) -> Hoisted;
+
+    /**
+     * The letrec's body with its name bound to the letrec again, or the
+     * definition if the body is just the name. Only the tree reducer needs
+     * this, for the letrecs hoisting leaves in the term.
+     */
+    auto unfold(const Letrec& letrec) -> Term;
+}
+
+#endif //LAMBDA_LETREC_H
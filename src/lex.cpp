@@ -10,20 +10,44 @@
 
 #include "lang_tools/utils/utils.h"
 
+#include "instrument.h"
 #include "lex.h"
 
 using std::optional;
 using std::string;
-using std::stringstream;
 using lang_tools::is_whitespace;
 using lang_tools::lowercase;
 
 namespace lambda
 {
-    auto lex(std::istream& in) -> LexResult
+    namespace
+    {
+        auto set_token(Token& token, TokenType type) -> std::optional<lang_tools::LexErr>
+        {
+            token.type = type;
+            return {};
+        }
+
+        // replaces the token's text with the run of characters matching the
+        // predicate; a reused buffer costs nothing, so only the allocations
+        // made when the text outgrows it are recorded
+        template <typename Predicate>
+        auto read_while(std::istream& in, std::string& value, Predicate matches) -> void
+        {
+            value.clear();
+            while (matches(in.peek()))
+            {
+                std::size_t capacity {value.capacity()};
+                value.push_back(static_cast<char>(in.get()));
+                if (value.capacity() != capacity)
+                    instrument::record_bytes(value.capacity() + 1);
+            }
+        }
+    }
+
+    auto lex(std::istream& in, Token& token) -> std::optional<lang_tools::LexErr>
     {
         char c;
-        stringstream buffer {};
 
         // skip to next non-whitespace character
         while (in.good() && is_whitespace(in.peek()))
@@ -31,6 +55,9 @@ namespace lambda
             in.get();
         }
 
+        std::streamoff offset {in.tellg()};
+        token.column = offset < 0 ? 0 : static_cast<std::size_t>(offset) + 1;
+
         // check for single-character tokens
         optional<TokenType> ttype;
         switch (in.peek())
@@ -47,42 +74,44 @@ namespace lambda
             case ')':
                 ttype = TokenType::RightParen;
                 break;
+            case '=':
+                ttype = TokenType::Equals;
+                break;
         }
 
         // if matched any tokens, return
         if (ttype.has_value())
         {
             in.get(c);
-            return LexResult::make_ok(Token{ttype.value(), string{c}});
+            token.value.assign(1, c);
+            return set_token(token, ttype.value());
         }
 
         // otherwise, try to read as name
         if (std::isalpha(in.peek()))
         {
             // read in until next non-alpha char
-            while (std::isalpha(in.peek()))
-            {
-                in.get(c);
-                buffer << c;
-            }
-
-            return LexResult::make_ok(Token{TokenType::Name, buffer.str()});
+            read_while(in, token.value, [](int next) { return std::isalpha(next); });
+
+            // keywords can't be used as names
+            if (token.value == "let")
+                return set_token(token, TokenType::Let);
+            if (token.value == "letrec")
+                return set_token(token, TokenType::Letrec);
+            if (token.value == "in")
+                return set_token(token, TokenType::In);
+            return set_token(token, TokenType::Name);
         }
 
         if (std::isdigit(in.peek()))
         {
-            while (std::isdigit(in.peek()))
-            {
-                in.get(c);
-                buffer << c;
-            }
-
-            return LexResult::make_ok(Token{TokenType::Numeral, buffer.str()});
+            read_while(in, token.value, [](int next) { return std::isdigit(next); });
+            return set_token(token, TokenType::Numeral);
         }
 
         // if no matches, return failure
         in.get(c);
-        return LexResult::make_err("Unable to match character: " + string {c});
+        return "Unable to match character: " + string {c} + " at column " + std::to_string(token.column);
     }
 
     auto as_string(TokenType token) -> std::string
@@ -106,6 +135,18 @@ namespace lambda
 
             case TokenType::Numeral:
                 return "NUMERAL";
+
+            case TokenType::Let:
+                return "LET";
+
+            case TokenType::Letrec:
+                return "LETREC";
+
+            case TokenType::In:
+                return "IN";
+
+            case TokenType::Equals:
+                return "EQUALS";
         }
 
         throw std::logic_error("Unknown token type");
@@ -118,12 +159,13 @@ namespace lambda
      */
     auto read(std::istream& in)  -> std::vector<Token>
     {
+        instrument::PhaseScope scope {instrument::Phase::Lex};
         TokenStream stream {in};
         std::vector<Token> tokens {};
-        for (auto token : stream)
+        for (auto token {stream.begin()}; token != stream.end(); ++token)
         {
-            if (token.is_ok())
-                tokens.push_back(*token.get_ok());
+            if (!token.error().has_value())
+                tokens.push_back(std::move(*token));
         }
         return tokens;
     }
@@ -139,34 +181,35 @@ namespace lambda
         : source {source}
     {}
 
-    auto TokenStream::begin() -> lang_tools::token_iterator<Token>
+    auto TokenStream::begin() -> lang_tools::token_iterator<Token, Lex>
     {
-        return lang_tools::token_iterator<Token>(lex, source);
+        return lang_tools::token_iterator<Token, Lex>(lexer, source);
     }
 
-    auto TokenStream::end() -> lang_tools::token_iterator<Token>
+    auto TokenStream::end() -> lang_tools::token_iterator<Token, Lex>
     {
-        return lang_tools::token_iterator<Token>();
+        return lang_tools::token_iterator<Token, Lex>();
     }
 
     auto lex_all(std::istream& in) -> result::Result<std::queue<Token>, std::queue<lang_tools::LexErr>>
     {
+        instrument::PhaseScope scope {instrument::Phase::Lex};
         std::queue<Token> tokens {};
         std::queue<lang_tools::LexErr> failures {};
-        for (LexResult lex_result : TokenStream(in))
+        TokenStream stream {in};
+        for (auto token {stream.begin()}; token != stream.end(); ++token)
         {
-            Token* as_token {lex_result.get_ok()};
-            if (as_token)
-                tokens.push(*as_token);
+            if (token.error().has_value())
+                failures.push(token.error().value());
             else
-                failures.push(*lex_result.get_err());
+                tokens.push(std::move(*token));
         }
 
         // if no failures, return tokens
         if (failures.empty())
-            return result::Result<std::queue<Token>, std::queue<lang_tools::LexErr>>::make_ok(tokens);
+            return result::Result<std::queue<Token>, std::queue<lang_tools::LexErr>>::make_ok(std::move(tokens));
 
         // otherwise return failures
-        return result::Result<std::queue<Token>, std::queue<lang_tools::LexErr>>::make_err(failures);
+        return result::Result<std::queue<Token>, std::queue<lang_tools::LexErr>>::make_err(std::move(failures));
     }
 }
@@ -6,26 +6,42 @@
 #define LAMBDA_LEX_H
 
 #include <iostream>
+#include <optional>
+#include <queue>
 #include <vector>
 
 #include "lang_tools/lexer/lexer.hpp"
+#include "result/Result.hpp"
 
 namespace lambda
 {
-    enum class TokenType {Lambda, Name, Dot, LeftParen, RightParen, Numeral};
+    enum class TokenType {Lambda, Name, Dot, LeftParen, RightParen, Numeral, Let, Letrec, In, Equals};
     struct Token
     {
         TokenType type;
         std::string value {};
-    };
 
-    using LexResult = lang_tools::LexResult<Token>;
+        // where the token starts in its line, counting from 1
+        std::size_t column {0};
+    };
 
     auto read(std::istream& in)  -> std::vector<Token>;
     auto read(std::string in)    -> std::vector<Token>;
 
     auto as_string(TokenType token) -> std::string;
-    auto lex(std::istream& in) -> lang_tools::LexResult<Token>;
+
+    // reads the next token into the one given, reusing its storage; the
+    // caller sets the instrumentation phase once for all the tokens it reads
+    auto lex(std::istream& in, Token& token) -> std::optional<lang_tools::LexErr>;
+
+    // lex as a type, so that token iterators call it directly
+    struct Lex
+    {
+        auto operator ()(std::istream& in, Token& token) const -> std::optional<lang_tools::LexErr>
+        {
+            return lex(in, token);
+        }
+    };
 
     auto lex_all(std::istream& in) -> result::Result<std::queue<Token>, std::queue<lang_tools::LexErr>>;
 
@@ -34,10 +50,11 @@ namespace lambda
     public:
         explicit TokenStream(std::istream& source);
 
-        auto begin() -> lang_tools::token_iterator<Token>;
-        auto end()   -> lang_tools::token_iterator<Token>;
+        auto begin() -> lang_tools::token_iterator<Token, Lex>;
+        auto end()   -> lang_tools::token_iterator<Token, Lex>;
 
     private:
+        static constexpr Lex lexer {};
         std::istream& source;
     };
 }
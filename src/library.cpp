@@ -0,0 +1,202 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+#include "library.h"
+
+namespace lambda
+{
+    namespace
+    {
+        auto is_space(char c) -> bool
+        {
+            return c == ' ' || c == '\t';
+        }
+
+        /**
+         * Splits `name = term` without lexing the term.
+         */
+        auto definition_name(std::string_view text) -> std::optional<std::string_view>
+        {
+            std::size_t name_end {0};
+            while (name_end < text.size() && !is_space(text[name_end]))
+                ++name_end;
+
+            std::size_t equals {name_end};
+            while (equals < text.size() && is_space(text[equals]))
+                ++equals;
+
+            if (name_end == 0 || equals == name_end || equals >= text.size() || text[equals] != '=')
+                return {};
+            return text.substr(0, name_end);
+        }
+    }
+
+    Library::Library(std::string text)
+        : source {std::make_unique<const std::string>(std::move(text))}
+    {
+        index(*source);
+    }
+
+    Library::Library(std::unique_ptr<const MappedFile> mapped)
+        : source {std::make_unique<const std::string>()}, file {std::move(mapped)}
+    {
+        index(file->contents());
+    }
+
+    auto Library::index(std::string_view text) -> void
+    {
+        for (SourceLine line : split_lines(text))
+        {
+            std::optional<std::string_view> name {definition_name(line.text)};
+            if (!name.has_value())
+            {
+                header_errors.push_back({line.line, "Expected a definition of the form name = term"});
+                continue;
+            }
+
+            auto entry {std::make_unique<Entry>()};
+            entry->line = line.line;
+            entry->text = line.text;
+            auto [previous, inserted] {entries.emplace(std::string {name.value()}, std::move(entry))};
+            if (!inserted)
+            {
+                std::stringstream err_msg {};
+                err_msg << "Duplicate definition of " << name.value()
+                        << " (first defined on line " << previous->second->line << ")";
+                header_errors.push_back({line.line, err_msg.str()});
+            }
+        }
+    }
+
+    auto Library::from_file(const std::filesystem::path& path) -> Library
+    {
+        auto mapped {std::make_unique<const MappedFile>(path)};
+        if (!mapped->is_open())
+        {
+            Library empty {""};
+            empty.header_errors.push_back({0, "Unable to open " + path.string()});
+            return empty;
+        }
+
+        return Library {std::move(mapped)};
+    }
+
+    auto Library::parse(const Entry& entry) const -> void
+    {
+        std::call_once(entry.parse_once, [&entry]()
+        {
+            auto result {parse_line(std::string {entry.text})};
+            auto definition {result.get_ok()};
+            if (definition != nullptr)
+                entry.term = std::move(definition->second);
+            else
+                entry.error = *result.get_err();
+            entry.parsed.store(true, std::memory_order_release);
+        });
+    }
+
+    auto Library::find(const std::string& name) const -> const Term*
+    {
+        auto search {entries.find(name)};
+        if (search == entries.end())
+            return nullptr;
+
+        const Entry& entry {*search->second};
+        parse(entry);
+        return entry.term.has_value() ? &entry.term.value() : nullptr;
+    }
+
+    auto Library::contains(const std::string& name) const -> bool
+    {
+        return entries.find(name) != entries.end();
+    }
+
+    auto Library::size() const -> std::size_t
+    {
+        return entries.size();
+    }
+
+    auto Library::dependencies(const std::string& name) const -> const std::vector<std::string>&
+    {
+        static const std::vector<std::string> none {};
+        auto search {entries.find(name)};
+        if (search == entries.end())
+            return none;
+
+        const Entry& entry {*search->second};
+        std::call_once(entry.scan_once, [this, &entry, &name]()
+        {
+            // names are runs of letters, as in the lexer; skip the defined name itself
+            std::string_view text {entry.text.substr(name.size())};
+            std::unordered_set<std::string> seen {};
+            std::size_t i {0};
+            while (i < text.size())
+            {
+                if (!std::isalpha(static_cast<unsigned char>(text[i])))
+                {
+                    ++i;
+                    continue;
+                }
+                std::size_t start {i};
+                while (i < text.size() && std::isalpha(static_cast<unsigned char>(text[i])))
+                    ++i;
+
+                std::string word {text.substr(start, i - start)};
+                if (contains(word) && seen.insert(word).second)
+                    entry.dependencies.push_back(std::move(word));
+            }
+        });
+        return entry.dependencies;
+    }
+
+    auto Library::load_closure(const std::unordered_set<std::string>& names) const -> std::vector<std::string>
+    {
+        std::unordered_set<std::string> visited {};
+        std::vector<std::string> closure {};
+        std::vector<std::string> pending {names.begin(), names.end()};
+        while (!pending.empty())
+        {
+            std::string name {std::move(pending.back())};
+            pending.pop_back();
+            if (!contains(name) || !visited.insert(name).second)
+                continue;
+
+            find(name);
+            for (const std::string& dependency : dependencies(name))
+                pending.push_back(dependency);
+            closure.push_back(std::move(name));
+        }
+        return closure;
+    }
+
+    auto Library::loaded() const -> Context
+    {
+        Context context {};
+        for (const auto& [name, entry] : entries)
+        {
+            if (entry->parsed.load(std::memory_order_acquire) && entry->term.has_value())
+                context.emplace(name, entry->term.value());
+        }
+        return context;
+    }
+
+    auto Library::errors() const -> std::vector<LoadError>
+    {
+        std::vector<LoadError> all {header_errors};
+        for (const auto& [name, entry] : entries)
+        {
+            if (entry->parsed.load(std::memory_order_acquire) && !entry->term.has_value())
+                all.push_back({entry->line, entry->error});
+        }
+        std::sort(all.begin(), all.end(), [](const LoadError& lhs, const LoadError& rhs)
+        {
+            return lhs.line < rhs.line;
+        });
+        return all;
+    }
+}
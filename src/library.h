@@ -0,0 +1,93 @@
+//
+// Created by colin on 10/19/26.
+//
+
+/**
+ * A definition file loaded lazily: at startup only the name of each
+ * definition is read, and its term is parsed the first time something
+ * looks the name up.
+ */
+
+#ifndef LAMBDA_LIBRARY_H
+#define LAMBDA_LIBRARY_H
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "eval.h"
+#include "loader.h"
+
+namespace lambda
+{
+    class Library : public Definitions
+    {
+    public:
+        explicit Library(std::string source);
+
+        // the file stays mapped for as long as the library is alive
+        static auto from_file(const std::filesystem::path& path) -> Library;
+
+        /**
+         * Parses the definition on first use. Safe to call from several
+         * threads. Definitions that fail to parse are reported by errors()
+         * and look like undefined names.
+         */
+        auto find(const std::string& name) const -> const Term* override;
+
+        auto contains(const std::string& name) const -> bool;
+        auto size() const -> std::size_t;
+
+        /**
+         * Names in the library that the definition refers to, found with a
+         * lexical scan (so a bound variable that shares a library name is
+         * included). Computed on first request and cached.
+         */
+        auto dependencies(const std::string& name) const -> const std::vector<std::string>&;
+
+        // parses the given names and everything they depend on, returning
+        // the names of the closure that the library defines
+        auto load_closure(const std::unordered_set<std::string>& names) const -> std::vector<std::string>;
+
+        // the definitions parsed so far
+        auto loaded() const -> Context;
+
+        // malformed lines and duplicates found at startup, plus parse errors so far
+        auto errors() const -> std::vector<LoadError>;
+
+    private:
+        struct Entry
+        {
+            std::size_t line;
+            std::string_view text;
+
+            mutable std::once_flag parse_once {};
+            mutable std::atomic<bool> parsed {false};
+            mutable std::optional<Term> term {};
+            mutable std::string error {};
+
+            mutable std::once_flag scan_once {};
+            mutable std::vector<std::string> dependencies {};
+        };
+
+        // entries point into the source or the mapped file, so neither may move
+        std::unique_ptr<const std::string> source;
+        std::unique_ptr<const MappedFile> file {};
+        std::unordered_map<std::string, std::unique_ptr<Entry>> entries {};
+        std::vector<LoadError> header_errors {};
+
+        explicit Library(std::unique_ptr<const MappedFile> file);
+
+        auto index(std::string_view text) -> void;
+        auto parse(const Entry& entry) const -> void;
+    };
+}
+
+#endif //LAMBDA_LIBRARY_H
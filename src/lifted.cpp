@@ -0,0 +1,569 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include <algorithm>
+#include <deque>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "cancel.h"
+#include "instrument.h"
+#include "letrec.h"
+#include "lifted.h"
+
+namespace lambda::lifted
+{
+    namespace
+    {
+        struct LimitExceeded {};
+
+        using Env = std::unordered_map<std::string, std::size_t>;
+    }
+
+    class Program::Compiler
+    {
+    public:
+        Compiler(Program& program, const Definitions& definitions)
+            : program {program}, definitions {definitions} {}
+
+        // adds a supercombinator whose body is compiled by run(), returning its index
+        auto lift(std::string name, std::vector<std::string> params, const Term& body) -> std::size_t
+        {
+            std::size_t index {program.combinators.size()};
+            program.combinators.push_back({std::move(name), std::move(params)});
+            pending.push_back({index, &body});
+            return index;
+        }
+
+        // compiles the bodies of every supercombinator lifted so far, and of
+        // those lifted along the way
+        auto run() -> void
+        {
+            while (!pending.empty())
+            {
+                Pending next {pending.back()};
+                pending.pop_back();
+
+                // later parameters shadow earlier ones with the same name
+                const std::vector<std::string>& params {program.combinators[next.index].params};
+                Env env {};
+                for (std::size_t i {0}; i < params.size(); ++i)
+                    env[params[i]] = i;
+
+                current = program.combinators[next.index].name;
+                Template compiled {};
+                compile(*next.body, env, compiled);
+                program.combinators[next.index].body = std::move(compiled);
+            }
+        }
+
+    private:
+        Program& program;
+        const Definitions& definitions;
+
+        // supercombinators whose bodies are still to be compiled
+        struct Pending
+        {
+            std::size_t index;
+            const Term* body;
+        };
+        std::vector<Pending> pending {};
+
+        // terms made while compiling (the redexes lets become), kept for
+        // as long as a pending body may point into them
+        std::deque<Term> made {};
+
+        // supercombinator whose body is being compiled, for naming lifted ones
+        std::string current {};
+        std::size_t lifted_count {0};
+
+        // position of each free variable name in program.names
+        std::unordered_map<std::string, std::size_t> name_index {};
+
+        auto add(Template& out, Template::Node node) -> std::size_t
+        {
+            out.nodes.push_back(node);
+            return out.nodes.size() - 1;
+        }
+
+        auto global(const std::string& name, const Term& definition) -> std::size_t
+        {
+            auto search {program.globals.find(name)};
+            if (search != program.globals.end())
+                return search->second;
+
+            // leading abstractions become the parameters
+            std::vector<std::string> params {};
+            const Term* body {&definition};
+            while (auto abstr = std::get_if<Abstraction>(body))
+            {
+                params.push_back(abstr->name.name);
+                body = &*abstr->body;
+            }
+
+            // the body is compiled later, so it can already refer to the name
+            std::size_t index {lift(name, std::move(params), *body)};
+            program.globals.emplace(name, index);
+            return index;
+        }
+
+        auto free_name(const std::string& name) -> std::size_t
+        {
+            auto [search, inserted] {name_index.emplace(name, program.names.size())};
+            if (inserted)
+                program.names.push_back(name);
+            return search->second;
+        }
+
+        /**
+         * Compiles the body children first, without recursion: each term is
+         * visited once to schedule its subterms and once more, for an
+         * application, to join the nodes they compiled to.
+         */
+        auto compile(const Term& term, const Env& env, Template& out) -> std::size_t
+        {
+            struct Frame
+            {
+                const Term* term;
+                bool expanded;
+            };
+            std::vector<Frame> frames {{&term, false}};
+            std::vector<std::size_t> compiled {};
+
+            while (!frames.empty())
+            {
+                Frame frame {frames.back()};
+                frames.pop_back();
+                const Term& next {*frame.term};
+
+                if (auto appl = std::get_if<Application>(&next))
+                {
+                    if (frame.expanded)
+                    {
+                        std::size_t rhs {compiled.back()};
+                        compiled.pop_back();
+                        compiled.back() = add(out, {Template::Kind::App, compiled.back(), rhs});
+                    }
+                    else
+                    {
+                        frames.push_back({frame.term, true});
+                        frames.push_back({&*appl->rhs, false});
+                        frames.push_back({&*appl->lhs, false});
+                    }
+                    continue;
+                }
+
+                if (auto numeral = std::get_if<Numeral>(&next))
+                {
+                    program.values.push_back(numeral->value);
+                    compiled.push_back(add(out, {Template::Kind::Num, program.values.size() - 1}));
+                    continue;
+                }
+
+                // instantiation shares the argument of a redex already
+                if (auto let = std::get_if<Let>(&next))
+                {
+                    Application redex {make_term(Abstraction {let->name, let->body}), let->definition};
+                    frames.push_back({&made.emplace_back(std::move(redex)), false});
+                    continue;
+                }
+
+                if (std::holds_alternative<Letrec>(next))
+                    throw std::logic_error("letrec should have been hoisted");
+
+                compiled.push_back(leaf(next, env, out));
+            }
+            return compiled.back();
+        }
+
+        // a variable, or a run of abstractions lifted into a supercombinator
+        auto leaf(const Term& term, const Env& env, Template& out) -> std::size_t
+        {
+            if (auto var = std::get_if<Variable>(&term))
+            {
+                auto local {env.find(var->name)};
+                if (local != env.end())
+                    return add(out, {Template::Kind::Arg, local->second});
+
+                const Term* definition {definitions.find(var->name)};
+                if (definition != nullptr)
+                    return add(out, {Template::Kind::Global, global(var->name, *definition)});
+                return add(out, {Template::Kind::Free, free_name(var->name)});
+            }
+
+            // lift the whole run of abstractions, passing in the enclosing
+            // scope's variables that it uses
+            std::vector<std::string> captured {};
+            for (const std::string& name : free_variables(term))
+            {
+                if (env.count(name) > 0)
+                    captured.push_back(name);
+            }
+            std::sort(captured.begin(), captured.end());
+
+            std::vector<std::string> params {captured};
+            const Term* body {&term};
+            while (auto abstr = std::get_if<Abstraction>(body))
+            {
+                params.push_back(abstr->name.name);
+                body = &*abstr->body;
+            }
+
+            std::size_t index {lift(current + "$" + std::to_string(++lifted_count), std::move(params), *body)};
+            std::size_t node {add(out, {Template::Kind::Global, index})};
+            for (const std::string& name : captured)
+            {
+                std::size_t arg {add(out, {Template::Kind::Arg, env.at(name)})};
+                node = add(out, {Template::Kind::App, node, arg});
+            }
+            return node;
+        }
+    };
+
+    Program::Program(const Term& term, const Definitions& definitions)
+    {
+        Compiler compiler {*this, definitions};
+        main = compiler.lift("main", {}, term);
+        compiler.run();
+    }
+
+    auto Program::find(const std::string& name) const -> const Supercombinator*
+    {
+        auto search {globals.find(name)};
+        if (search == globals.end())
+            return nullptr;
+        return &combinators[search->second];
+    }
+
+    namespace
+    {
+        struct Cell
+        {
+            enum class Kind : std::uint8_t {App, Comb, Free, Ind, Num};
+
+            Kind kind;
+
+            // App: function, Comb: supercombinator, Free: name, Ind: target,
+            // Num: value
+            std::size_t a;
+
+            // App: argument
+            std::size_t b {0};
+        };
+
+        class Machine
+        {
+        public:
+            Machine(const Program& program, std::size_t limit, CancelToken* cancel)
+                : program {program}, names {program.free_names()}, values {program.numerals()}, limit {limit},
+              cancel {cancel}
+            {
+                // one cell per supercombinator, shared by every reference, so
+                // a definition without parameters is only evaluated once
+                for (std::size_t i {0}; i < program.supercombinators().size(); ++i)
+                    combs.push_back(alloc({Cell::Kind::Comb, i}));
+                for (std::size_t i {0}; i < names.size(); ++i)
+                    frees.push_back(alloc({Cell::Kind::Free, i}));
+                taken.insert(names.begin(), names.end());
+            }
+
+            auto run() -> Term
+            {
+                return read(combs[program.entry()]);
+            }
+
+            auto stats() const -> Stats
+            {
+                return {instantiations, heap.size()};
+            }
+
+        private:
+            const Program& program;
+            std::vector<Cell> heap {};
+            std::vector<std::size_t> combs {};
+            std::vector<std::size_t> frees {};
+
+            // free variable names, followed by those made up for read back
+            std::vector<std::string> names;
+
+            // names a read back binder must not use
+            std::unordered_multiset<std::string> taken {};
+
+            // numeral values, followed by those of numerals unfolded so far
+            std::vector<Natural> values;
+
+            std::size_t limit;
+            CancelToken* cancel;
+            std::size_t instantiations {0};
+
+            auto alloc(Cell cell) -> std::size_t
+            {
+                heap.push_back(cell);
+                return heap.size() - 1;
+            }
+
+            auto instantiate(const Template& body, const std::vector<std::size_t>& args) -> std::size_t
+            {
+                std::vector<std::size_t> cells(body.nodes.size());
+                for (std::size_t i {0}; i < body.nodes.size(); ++i)
+                {
+                    const Template::Node& node {body.nodes[i]};
+                    switch (node.kind)
+                    {
+                        case Template::Kind::Arg:
+                            cells[i] = args[node.a];
+                            break;
+
+                        case Template::Kind::Global:
+                            cells[i] = combs[node.a];
+                            break;
+
+                        case Template::Kind::Free:
+                            cells[i] = frees[node.a];
+                            break;
+
+                        case Template::Kind::App:
+                            cells[i] = alloc({Cell::Kind::App, cells[node.a], cells[node.b]});
+                            break;
+
+                        case Template::Kind::Num:
+                            cells[i] = alloc({Cell::Kind::Num, node.a});
+                            break;
+                    }
+                }
+                return cells.back();
+            }
+
+            // reduces the cell to weak head normal form by unwinding its spine
+            auto whnf(std::size_t cell) -> void
+            {
+                std::vector<std::size_t> spine {cell};
+                while (true)
+                {
+                    Cell top {heap[spine.back()]};
+                    switch (top.kind)
+                    {
+                        case Cell::Kind::Ind:
+                            spine.back() = top.a;
+                            break;
+
+                        case Cell::Kind::App:
+                            spine.push_back(top.a);
+                            break;
+
+                        case Cell::Kind::Free:
+                            return;
+
+                        case Cell::Kind::Comb:
+                        {
+                            const Supercombinator& sc {program.supercombinators()[top.a]};
+                            std::size_t arity {sc.arity()};
+                            if (spine.size() - 1 < arity)
+                                return;
+
+                            if (++instantiations > limit)
+                                throw LimitExceeded {};
+                            if (cancel)
+                                cancel->check(instantiations);
+
+                            // the application cells below the head hold the arguments in order
+                            std::vector<std::size_t> args(arity);
+                            for (std::size_t i {0}; i < arity; ++i)
+                                args[i] = heap[spine[spine.size() - 2 - i]].b;
+
+                            std::size_t root {spine[spine.size() - 1 - arity]};
+                            std::size_t result {instantiate(sc.body, args)};
+
+                            // a definition that is just itself never reaches a head
+                            if (result == root)
+                                throw LimitExceeded {};
+
+                            heap[root] = {Cell::Kind::Ind, result};
+                            spine.resize(spine.size() - arity);
+                            break;
+                        }
+
+                        // n s z is s (m s z), with m one less, or z for zero
+                        case Cell::Kind::Num:
+                        {
+                            if (spine.size() - 1 < 2)
+                                return;
+
+                            if (++instantiations > limit)
+                                throw LimitExceeded {};
+                            if (cancel)
+                                cancel->check(instantiations);
+
+                            std::size_t s {heap[spine[spine.size() - 2]].b};
+                            std::size_t z {heap[spine[spine.size() - 3]].b};
+                            std::size_t root {spine[spine.size() - 3]};
+                            std::size_t result {z};
+                            if (!values[top.a].is_zero())
+                            {
+                                Natural rest {values[top.a]};
+                                --rest;
+                                values.push_back(std::move(rest));
+                                std::size_t smaller {alloc({Cell::Kind::Num, values.size() - 1})};
+                                smaller = alloc({Cell::Kind::App, alloc({Cell::Kind::App, smaller, s}), z});
+                                result = alloc({Cell::Kind::App, s, smaller});
+                            }
+                            heap[root] = {Cell::Kind::Ind, result};
+                            spine.resize(spine.size() - 2);
+                            break;
+                        }
+                    }
+                }
+            }
+
+            auto fresh(const std::string& name) -> std::size_t
+            {
+                std::string unique {fresh_name(name, [this](const std::string& candidate)
+                {
+                    return taken.count(candidate) > 0;
+                })};
+                names.push_back(unique);
+                taken.insert(unique);
+                return alloc({Cell::Kind::Free, names.size() - 1});
+            }
+
+            /**
+             * Reads back the normal form of the cell without recursion. A
+             * task either reads a cell, applies a free variable to the last
+             * terms read, or wraps the last term read in binders.
+             */
+            auto read(std::size_t cell) -> Term
+            {
+                struct Task
+                {
+                    enum class Kind {Read, Apply, Bind} kind;
+
+                    // Read: the cell, Apply: the free variable's name
+                    std::size_t cell;
+
+                    // Apply: how many arguments, innermost first on the terms
+                    std::size_t count {0};
+
+                    // Bind: the fresh variables standing for the parameters
+                    std::vector<std::size_t> binders {};
+                };
+                std::vector<Task> tasks {};
+                tasks.push_back({Task::Kind::Read, cell});
+                std::vector<Term> terms {};
+
+                while (!tasks.empty())
+                {
+                    Task task {std::move(tasks.back())};
+                    tasks.pop_back();
+
+                    if (task.kind == Task::Kind::Apply)
+                    {
+                        Term term {Variable {names[task.cell]}};
+                        for (std::size_t i {terms.size() - task.count}; i < terms.size(); ++i)
+                            term = Application {std::move(term), std::move(terms[i])};
+                        terms.erase(terms.end() - static_cast<std::ptrdiff_t>(task.count), terms.end());
+                        terms.push_back(std::move(term));
+                        continue;
+                    }
+
+                    if (task.kind == Task::Kind::Bind)
+                    {
+                        Term term {std::move(terms.back())};
+                        for (auto binder {task.binders.rbegin()}; binder != task.binders.rend(); ++binder)
+                        {
+                            const std::string& name {names[heap[*binder].a]};
+                            term = Abstraction {Variable {name}, std::move(term)};
+                            taken.erase(taken.find(name));
+                        }
+                        terms.back() = std::move(term);
+                        continue;
+                    }
+
+                    whnf(task.cell);
+
+                    // a large normal form takes long enough to read back to check on
+                    if (cancel)
+                        cancel->check();
+
+                    std::vector<std::size_t> args {};
+                    std::size_t head {task.cell};
+                    while (heap[head].kind == Cell::Kind::App || heap[head].kind == Cell::Kind::Ind)
+                    {
+                        if (heap[head].kind == Cell::Kind::App)
+                            args.push_back(heap[head].b);
+                        head = heap[head].a;
+                    }
+
+                    // the innermost argument is read first
+                    if (heap[head].kind == Cell::Kind::Free)
+                    {
+                        tasks.push_back({Task::Kind::Apply, heap[head].a, args.size()});
+                        for (std::size_t arg : args)
+                            tasks.push_back({Task::Kind::Read, arg});
+                        continue;
+                    }
+
+                    // a numeral on its own is already a normal form
+                    bool numeral {heap[head].kind == Cell::Kind::Num};
+                    if (numeral && args.empty())
+                    {
+                        terms.push_back(Numeral {values[heap[head].a]});
+                        continue;
+                    }
+
+                    // a partial application: supply the missing arguments as
+                    // fresh variables and read back the body under binders
+                    static const std::vector<std::string> numeral_params {"s", "z"};
+                    const std::vector<std::string>& params {
+                        numeral ? numeral_params : program.supercombinators()[heap[head].a].params};
+                    std::vector<std::size_t> binders {};
+                    std::size_t applied {task.cell};
+                    for (std::size_t i {args.size()}; i < params.size(); ++i)
+                    {
+                        binders.push_back(fresh(params[i]));
+                        applied = alloc({Cell::Kind::App, applied, binders.back()});
+                    }
+                    tasks.push_back({Task::Kind::Bind, 0, 0, std::move(binders)});
+                    tasks.push_back({Task::Kind::Read, applied});
+                }
+                return std::move(terms.back());
+            }
+        };
+    }
+
+    auto reduce(const Term& term, const Definitions& definitions, std::size_t limit, Stats* stats,
+                CancelToken* cancel) -> ReduceResult
+    {
+        instrument::PhaseScope scope {instrument::Phase::Reduce};
+        Hoisted hoisted {hoist_letrecs(term, definitions, true)};
+        ContextDefinitions scope_definitions {hoisted.definitions, &definitions};
+
+        Program program {hoisted.term, scope_definitions};
+        Machine machine {program, limit, cancel};
+        CheckScope checked {cancel};
+        try
+        {
+            Term normal {machine.run()};
+            if (stats)
+                *stats = machine.stats();
+            return ReduceResult::make_ok(std::move(normal));
+        }
+        catch (LimitExceeded&)
+        {
+            if (stats)
+                *stats = machine.stats();
+            return ReduceResult::make_err("Instantiation limit exceeded");
+        }
+        catch (Interrupted& interrupted)
+        {
+            if (stats)
+                *stats = machine.stats();
+            return ReduceResult::make_err(interrupted.reason);
+        }
+    }
+
+    auto reduce(const Term& term, const Context& context, std::size_t limit, Stats* stats) -> ReduceResult
+    {
+        return lifted::reduce(term, ContextDefinitions {context}, limit, stats);
+    }
+}
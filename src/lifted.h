@@ -0,0 +1,132 @@
+//
+// Created by colin on 10/19/26.
+//
+
+/**
+ * Evaluator that lambda-lifts a term and the definitions it uses into
+ * supercombinators, then reduces by template instantiation: applying a
+ * supercombinator to all of its arguments builds a fresh copy of its body
+ * from a precompiled template, and the application is overwritten with the
+ * result so that it is only ever reduced once.
+ *
+ * Numeral nodes stay numerals: applied to s and z, a numeral becomes
+ * s applied to the numeral one less, so a large one is never built in
+ * unary.
+ *
+ * Normal forms are read back by applying partial applications to fresh
+ * variables, which is how reduction gets under binders.
+ */
+
+#ifndef LAMBDA_LIFTED_H
+#define LAMBDA_LIFTED_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "eval.h"
+#include "natural.h"
+#include "parse.h"
+
+namespace lambda::lifted
+{
+    struct Stats
+    {
+        std::size_t instantiations {0};
+        std::size_t heap_cells {0};
+    };
+
+    // upper bound on instantiations before giving up
+    constexpr std::size_t default_limit {10'000'000};
+
+    /**
+     * A supercombinator body. Nodes are stored children first, so the last
+     * one is the root.
+     */
+    struct Template
+    {
+        enum class Kind : std::uint8_t {Arg, Global, Free, App, Num};
+
+        struct Node
+        {
+            Kind kind;
+
+            // Arg: parameter, Global: supercombinator, Free: name, App: function node,
+            // Num: numeral
+            std::size_t a;
+
+            // App: argument node
+            std::size_t b {0};
+        };
+
+        std::vector<Node> nodes {};
+    };
+
+    struct Supercombinator
+    {
+        std::string name;
+
+        // variables lifted from the enclosing scope come first
+        std::vector<std::string> params;
+        Template body {};
+
+        auto arity() const -> std::size_t
+        {
+            return params.size();
+        }
+    };
+
+    /**
+     * A term compiled together with every definition it reaches. Each
+     * definition is compiled once, however often it is referenced.
+     */
+    class Program
+    {
+    public:
+        Program(const Term& term, const Definitions& definitions);
+
+        auto supercombinators() const -> const std::vector<Supercombinator>&
+        {
+            return combinators;
+        }
+
+        // the supercombinator compiled from a definition, or nullptr
+        auto find(const std::string& name) const -> const Supercombinator*;
+
+        // the term itself, as a supercombinator with no parameters
+        auto entry() const -> std::size_t
+        {
+            return main;
+        }
+
+        auto free_names() const -> const std::vector<std::string>&
+        {
+            return names;
+        }
+
+        // values of the numerals in templates
+        auto numerals() const -> const std::vector<Natural>&
+        {
+            return values;
+        }
+
+    private:
+        class Compiler;
+
+        std::vector<Supercombinator> combinators {};
+        std::unordered_map<std::string, std::size_t> globals {};
+        std::vector<std::string> names {};
+        std::vector<Natural> values {};
+        std::size_t main {0};
+    };
+
+    auto reduce(const Term& term, const Definitions& definitions,
+                std::size_t limit = default_limit, Stats* stats = nullptr,
+                CancelToken* cancel = nullptr) -> ReduceResult;
+    auto reduce(const Term& term, const Context& context = {},
+                std::size_t limit = default_limit, Stats* stats = nullptr) -> ReduceResult;
+}
+
+#endif //LAMBDA_LIFTED_H
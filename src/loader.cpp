@@ -0,0 +1,171 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include <algorithm>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "loader.h"
+
+namespace lambda
+{
+    namespace
+    {
+        // below this many definitions per thread, threads cost more than they save
+        constexpr std::size_t min_lines_per_thread {256};
+
+        using LineResult = lang_tools::ParseResult<std::pair<std::string, Term>>;
+
+        auto is_blank(char c) -> bool
+        {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        auto parse_range(const std::vector<SourceLine>& lines, std::vector<std::optional<LineResult>>& results,
+                         std::size_t begin, std::size_t end) -> void
+        {
+            for (std::size_t i {begin}; i < end; ++i)
+                results[i].emplace(parse_line(std::string {lines[i].text}));
+        }
+    }
+
+    MappedFile::MappedFile(const std::filesystem::path& path)
+    {
+        int fd {::open(path.c_str(), O_RDONLY)};
+        if (fd < 0)
+            return;
+
+        struct stat info {};
+        if (::fstat(fd, &info) == 0)
+        {
+            size = static_cast<std::size_t>(info.st_size);
+            opened = true;
+            if (size > 0)
+            {
+                void* mapped {::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)};
+                if (mapped == MAP_FAILED)
+                    opened = false;
+                else
+                    data = static_cast<const char*>(mapped);
+            }
+        }
+        ::close(fd);
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (data != nullptr)
+            ::munmap(const_cast<char*>(data), size);
+    }
+
+    auto MappedFile::contents() const -> std::string_view
+    {
+        return data == nullptr ? std::string_view {} : std::string_view {data, size};
+    }
+
+    auto split_lines(std::string_view source) -> std::vector<SourceLine>
+    {
+        std::vector<SourceLine> lines {};
+        std::size_t line {0};
+        while (!source.empty())
+        {
+            ++line;
+            std::size_t end {source.find('\n')};
+            std::string_view text {source.substr(0, end)};
+            source.remove_prefix(end == std::string_view::npos ? source.size() : end + 1);
+
+            while (!text.empty() && is_blank(text.back()))
+                text.remove_suffix(1);
+            if (std::all_of(text.begin(), text.end(), is_blank))
+                continue;
+
+            lines.push_back({line, text});
+        }
+        return lines;
+    }
+
+    auto load_definitions(std::string_view source, std::size_t threads) -> LoadResult
+    {
+        std::vector<SourceLine> lines {split_lines(source)};
+        std::vector<std::optional<LineResult>> results(lines.size());
+
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = std::clamp<std::size_t>(lines.size() / min_lines_per_thread, 1, threads);
+
+        if (threads == 1)
+        {
+            parse_range(lines, results, 0, lines.size());
+        }
+        else
+        {
+            // contiguous chunks, so each thread writes its own slice of results
+            std::vector<std::thread> workers {};
+            std::size_t chunk {(lines.size() + threads - 1) / threads};
+            for (std::size_t begin {0}; begin < lines.size(); begin += chunk)
+            {
+                std::size_t end {std::min(begin + chunk, lines.size())};
+                workers.emplace_back(parse_range, std::cref(lines), std::ref(results), begin, end);
+            }
+            for (std::thread& worker : workers)
+                worker.join();
+        }
+
+        // merge in file order so errors and duplicates are reported in order
+        LoadResult loaded {};
+        std::unordered_map<std::string, std::size_t> defined_on {};
+        for (std::size_t i {0}; i < lines.size(); ++i)
+        {
+            LineResult& result {*results[i]};
+            std::pair<std::string, Term>* definition {result.get_ok()};
+            if (definition == nullptr)
+            {
+                loaded.errors.push_back({lines[i].line, *result.get_err()});
+                continue;
+            }
+
+            auto [previous, inserted] {defined_on.emplace(definition->first, lines[i].line)};
+            if (!inserted)
+            {
+                std::stringstream err_msg {};
+                err_msg << "Duplicate definition of " << definition->first
+                        << " (first defined on line " << previous->second << ")";
+                loaded.errors.push_back({lines[i].line, err_msg.str()});
+                continue;
+            }
+            loaded.context.insert(std::move(*definition));
+        }
+        return loaded;
+    }
+
+    auto load_file(const std::filesystem::path& path, std::size_t threads) -> LoadResult
+    {
+        MappedFile file {path};
+        if (!file.is_open())
+        {
+            LoadResult failed {};
+            failed.errors.push_back({0, "Unable to open " + path.string()});
+            return failed;
+        }
+        return load_definitions(file.contents(), threads);
+    }
+
+    auto as_string(const std::vector<LoadError>& errors) -> std::string
+    {
+        std::stringstream str {};
+        for (const LoadError& error : errors)
+        {
+            if (error.line > 0)
+                str << "line " << error.line << ": ";
+            str << error.message << std::endl;
+        }
+        return str.str();
+    }
+}
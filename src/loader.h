@@ -0,0 +1,90 @@
+//
+// Created by colin on 10/19/26.
+//
+
+/**
+ * Loading definition files: one `name = term` definition per line. Blank
+ * lines are skipped. Loading does not stop at the first bad line; every
+ * error is reported with its line number, along with the definitions that
+ * did parse.
+ */
+
+#ifndef LAMBDA_LOADER_H
+#define LAMBDA_LOADER_H
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "eval.h"
+
+namespace lambda
+{
+    struct LoadError
+    {
+        // 1-based, or 0 for errors about the file as a whole
+        std::size_t line;
+        std::string message;
+    };
+
+    struct LoadResult
+    {
+        Context context {};
+        std::vector<LoadError> errors {};
+    };
+
+    /**
+     * A definition split out of a source file, not yet parsed.
+     */
+    struct SourceLine
+    {
+        std::size_t line;
+        std::string_view text;
+    };
+
+    /**
+     * Read-only mapping of a whole file, unmapped when destroyed.
+     */
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::filesystem::path& path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        auto operator =(const MappedFile&) -> MappedFile& = delete;
+
+        auto is_open() const -> bool
+        {
+            return opened;
+        }
+
+        auto contents() const -> std::string_view;
+
+    private:
+        const char* data {nullptr};
+        std::size_t size {0};
+        bool opened {false};
+    };
+
+    // blank lines are dropped and trailing whitespace (including \r) trimmed
+    auto split_lines(std::string_view source) -> std::vector<SourceLine>;
+
+    /**
+     * Parses every definition in the source, spreading the work over up to
+     * `threads` threads (0 picks one per core). Small inputs are parsed on
+     * the calling thread. Redefining a name is reported as an error and the
+     * first definition is kept.
+     */
+    auto load_definitions(std::string_view source, std::size_t threads = 0) -> LoadResult;
+
+    // memory-maps the file and loads it with load_definitions
+    auto load_file(const std::filesystem::path& path, std::size_t threads = 0) -> LoadResult;
+
+    // one error per line, as "line N: message"
+    auto as_string(const std::vector<LoadError>& errors) -> std::string;
+}
+
+#endif //LAMBDA_LOADER_H
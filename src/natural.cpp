@@ -0,0 +1,161 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include <algorithm>
+#include <functional>
+
+#include "natural.h"
+
+namespace lambda
+{
+    namespace
+    {
+        constexpr std::uint64_t limb_base {std::uint64_t {1} << 32u};
+
+        // the largest power of ten in a limb, for converting to decimal
+        constexpr std::uint32_t decimal_chunk {1'000'000'000};
+        constexpr std::size_t decimal_chunk_digits {9};
+    }
+
+    Natural::Natural(std::uint64_t value)
+    {
+        while (value > 0)
+        {
+            limbs.push_back(static_cast<std::uint32_t>(value % limb_base));
+            value /= limb_base;
+        }
+    }
+
+    auto Natural::parse(std::string_view digits) -> std::optional<Natural>
+    {
+        if (digits.empty())
+            return {};
+
+        Natural result {};
+        for (char digit : digits)
+        {
+            if (digit < '0' || digit > '9')
+                return {};
+
+            // result = result * 10 + digit
+            std::uint64_t carry {static_cast<std::uint64_t>(digit - '0')};
+            for (std::uint32_t& limb : result.limbs)
+            {
+                std::uint64_t value {std::uint64_t {limb} * 10 + carry};
+                limb = static_cast<std::uint32_t>(value % limb_base);
+                carry = value / limb_base;
+            }
+            if (carry > 0)
+                result.limbs.push_back(static_cast<std::uint32_t>(carry));
+        }
+        return result;
+    }
+
+    auto Natural::to_uint64() const -> std::optional<std::uint64_t>
+    {
+        if (limbs.size() > 2)
+            return {};
+
+        std::uint64_t value {0};
+        for (auto limb {limbs.rbegin()}; limb != limbs.rend(); ++limb)
+            value = value * limb_base + *limb;
+        return value;
+    }
+
+    auto Natural::operator ++() -> Natural&
+    {
+        for (std::uint32_t& limb : limbs)
+        {
+            if (++limb != 0)
+                return *this;
+        }
+        limbs.push_back(1);
+        return *this;
+    }
+
+    auto Natural::operator --() -> Natural&
+    {
+        for (std::uint32_t& limb : limbs)
+        {
+            if (limb-- != 0)
+                break;
+        }
+        if (!limbs.empty() && limbs.back() == 0)
+            limbs.pop_back();
+        return *this;
+    }
+
+    auto Natural::operator +=(const Natural& other) -> Natural&
+    {
+        if (limbs.size() < other.limbs.size())
+            limbs.resize(other.limbs.size(), 0);
+
+        std::uint64_t carry {0};
+        for (std::size_t i {0}; i < limbs.size(); ++i)
+        {
+            std::uint64_t value {std::uint64_t {limbs[i]} + carry};
+            if (i < other.limbs.size())
+                value += other.limbs[i];
+            limbs[i] = static_cast<std::uint32_t>(value % limb_base);
+            carry = value / limb_base;
+        }
+        if (carry > 0)
+            limbs.push_back(static_cast<std::uint32_t>(carry));
+        return *this;
+    }
+
+    auto Natural::operator <(const Natural& other) const -> bool
+    {
+        if (limbs.size() != other.limbs.size())
+            return limbs.size() < other.limbs.size();
+        return std::lexicographical_compare(limbs.rbegin(), limbs.rend(), other.limbs.rbegin(), other.limbs.rend());
+    }
+
+    auto Natural::hash() const -> std::size_t
+    {
+        std::size_t seed {limbs.size()};
+        for (std::uint32_t limb : limbs)
+            seed ^= std::hash<std::uint32_t> {}(limb) + 0x9e3779b9 + (seed << 6u) + (seed >> 2u);
+        return seed;
+    }
+
+    auto Natural::divide(std::uint32_t divisor) -> std::uint32_t
+    {
+        std::uint64_t remainder {0};
+        for (auto limb {limbs.rbegin()}; limb != limbs.rend(); ++limb)
+        {
+            std::uint64_t value {remainder * limb_base + *limb};
+            *limb = static_cast<std::uint32_t>(value / divisor);
+            remainder = value % divisor;
+        }
+        while (!limbs.empty() && limbs.back() == 0)
+            limbs.pop_back();
+        return static_cast<std::uint32_t>(remainder);
+    }
+
+    auto as_string(const Natural& value) -> std::string
+    {
+        if (value.is_zero())
+            return "0";
+
+        // nine digits at a time, least significant first
+        std::vector<std::uint32_t> chunks {};
+        for (Natural rest {value}; !rest.is_zero(); )
+            chunks.push_back(rest.divide(decimal_chunk));
+
+        std::string digits {std::to_string(chunks.back())};
+        for (auto chunk {std::next(chunks.rbegin())}; chunk != chunks.rend(); ++chunk)
+        {
+            std::string part {std::to_string(*chunk)};
+            digits.append(decimal_chunk_digits - part.size(), '0');
+            digits += part;
+        }
+        return digits;
+    }
+
+    auto operator <<(std::ostream& out, const Natural& value) -> std::ostream&
+    {
+        return out << as_string(value);
+    }
+}
@@ -0,0 +1,76 @@
+//
+// Created by colin on 10/19/26.
+//
+
+/**
+ * Arbitrary precision natural numbers, used for numeral literals and for
+ * counting the successors of decoded numerals. Only the operations those
+ * need are provided.
+ */
+
+#ifndef LAMBDA_NATURAL_H
+#define LAMBDA_NATURAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lambda
+{
+    class Natural
+    {
+    public:
+        Natural() = default;
+        Natural(std::uint64_t value);
+
+        // nothing unless the text is all decimal digits
+        static auto parse(std::string_view digits) -> std::optional<Natural>;
+
+        auto is_zero() const -> bool
+        {
+            return limbs.empty();
+        }
+
+        // nothing if the value doesn't fit
+        auto to_uint64() const -> std::optional<std::uint64_t>;
+
+        auto operator ++() -> Natural&;
+
+        // the value must not be zero
+        auto operator --() -> Natural&;
+
+        auto operator +=(const Natural& other) -> Natural&;
+
+        auto operator ==(const Natural& other) const -> bool
+        {
+            return limbs == other.limbs;
+        }
+
+        auto operator !=(const Natural& other) const -> bool
+        {
+            return !(*this == other);
+        }
+
+        auto operator <(const Natural& other) const -> bool;
+
+        auto hash() const -> std::size_t;
+
+    private:
+        // base 2^32 digits, least significant first, with no leading zeros
+        std::vector<std::uint32_t> limbs {};
+
+        // divides in place, returning the remainder
+        auto divide(std::uint32_t divisor) -> std::uint32_t;
+
+        friend auto as_string(const Natural& value) -> std::string;
+    };
+
+    auto as_string(const Natural& value) -> std::string;
+    auto operator <<(std::ostream& out, const Natural& value) -> std::ostream&;
+}
+
+#endif //LAMBDA_NATURAL_H
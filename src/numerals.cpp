@@ -2,106 +2,197 @@
 // Created by colin on 6/6/20.
 //
 
+#include <deque>
+#include <limits>
+#include <map>
+#include <mutex>
 #include <sstream>
+#include <stdexcept>
 
 #include "numerals.h"
-#include "helpers.h"
+#include "fixed_term.h"
 
 
 namespace lambda
 {
-    const static Term zero {lam("s", lam("z", var("z")))};
-    const static Term succ {lam("n", lam("s", lam("z", app(var("s"), app(app(var("n"), var("s")), var("z"))))))};
+    // built at compile time, so there is no static initialisation to do
+    constexpr auto zero {fixed::parse<4>("\\s.\\z. z")};
+    constexpr auto succ {fixed::parse<12>("\\n.\\s.\\z. s (n s z)")};
 
-    auto parse_numeral(const std::string& str) -> ParseResult
+    static_assert(fixed::normalize(fixed::apply(succ, zero)) == fixed::numeral<8>(1));
+    static_assert(fixed::normalize(fixed::apply(succ, fixed::apply(succ, zero))) == fixed::numeral<8>(2));
+
+    namespace
     {
-        try
+        // spines remembered between calls to to_numeral; ones larger than
+        // any literal are built from the cache but not kept, so one huge
+        // result doesn't stay in memory for the rest of the session
+        constexpr std::size_t spine_cache_size {64};
+
+        /**
+         * Bodies s (s (... z)) of recently built numerals. Every numeral's
+         * spine contains the spines of all smaller ones, so a new numeral
+         * only has to be built from the largest cached one below it, and
+         * shares its nodes with it.
+         */
+        class SpineCache
         {
-            int val {std::stoi(str)};
-            if (val < 0)
+        public:
+            auto spine(uint val) -> term_ptr
             {
-                std::stringstream err_msg {};
-                err_msg << "Invalid numeral: " << val << " is less than zero.";
-                return ParseResult::make_err(err_msg.str());
+                uint count;
+                term_ptr body;
+                {
+                    std::lock_guard<std::mutex> lock {mutex};
+                    auto below {std::prev(spines.upper_bound(val))};
+                    count = below->first;
+                    body = below->second;
+                }
+                if (count == val)
+                    return body;
+
+                for (; count < val; ++count)
+                    body = make_term(Application {s, body});
+                if (val <= max_church_literal)
+                    remember(val, body);
+                return body;
             }
-            return ParseResult::make_ok(to_numeral(static_cast<uint>(val)));
-        }
-        catch (...)
+
+        private:
+            std::mutex mutex {};
+            const term_ptr s {make_term(Variable {"s"})};
+
+            // zero is never evicted, so there is always a spine to start from
+            std::map<uint, term_ptr> spines {{0, make_term(Variable {"z"})}};
+            std::deque<uint> order {};
+
+            auto remember(uint val, term_ptr body) -> void
+            {
+                std::lock_guard<std::mutex> lock {mutex};
+                if (!spines.emplace(val, std::move(body)).second)
+                    return;
+                order.push_back(val);
+                if (order.size() > spine_cache_size)
+                {
+                    spines.erase(order.front());
+                    order.pop_front();
+                }
+            }
+        };
+
+        auto spine_cache() -> SpineCache&
         {
-            return ParseResult::make_err("Unable to parse " + str + " as numeral");
+            static SpineCache cache {};
+            return cache;
         }
     }
 
+    auto parse_numeral(const std::string& str) -> ParseResult
+    {
+        std::optional<Natural> value {Natural::parse(str)};
+        if (!value.has_value())
+            return ParseResult::make_err("Unable to parse " + str + " as numeral");
+
+        if (!(Natural {max_church_literal} < value.value()))
+            return ParseResult::make_ok(to_numeral(static_cast<uint>(value->to_uint64().value())));
+        return ParseResult::make_ok(Numeral {std::move(value.value())});
+    }
+
     auto contract_numeral(const Term& term) -> Term
     {
-        std::optional<int> maybe_num {from_numeral(term)};
+        instrument::PhaseScope scope {instrument::Phase::Contract};
+        std::optional<Natural> maybe_num {read_numeral(term)};
         if (maybe_num.has_value())
-            return Variable {std::to_string(maybe_num.value())};
+            return Variable {as_string(maybe_num.value())};
         return term;
     }
 
-    auto from_numeral(const Term& term) -> std::optional<int>
+    namespace
     {
-        // goal is to check if matches \s.\z.s s s z for some number of s
+        auto is_variable(const Term& term, const std::string& name) -> bool
+        {
+            auto var {std::get_if<Variable>(&term)};
+            return var != nullptr && var->name == name;
+        }
+    }
+
+    auto read_numeral(const Term& term) -> std::optional<Natural>
+    {
+        if (auto numeral = std::get_if<Numeral>(&term))
+            return numeral->value;
 
-        // first check if outermost term is abstraction
+        // goal is to check if matches \s.\z.s s s z for some number of s
         const Abstraction* s_abstr {std::get_if<Abstraction>(&term)};
-        if (s_abstr)
+        if (s_abstr == nullptr)
+            return {};
+        const Abstraction* z_abstr {std::get_if<Abstraction>(&*s_abstr->body)};
+        if (z_abstr == nullptr)
+            return {};
+        const std::string& s_name {s_abstr->name.name};
+        const std::string& z_name {z_abstr->name.name};
+
+        std::uint64_t count {0};
+        const Term* body {&*z_abstr->body};
+        while (true)
         {
-            std::string s_name {s_abstr->name.name};
+            if (is_variable(*body, z_name))
+                return Natural {count};
 
-            // then check if next outermost term is abstraction
-            const Abstraction* z_abstr {std::get_if<Abstraction>(&(*s_abstr->body))};
-            if (z_abstr)
-            {
-                std::string z_name {z_abstr->name.name};
+            const Application* body_as_app {std::get_if<Application>(body)};
+            if (body_as_app == nullptr)
+                return {};
 
-                // then check if body is just the z variable (case of zero)
-                const Variable* body_as_var {std::get_if<Variable>(&(*z_abstr->body))};
-                if (body_as_var)
-                {
-                    if (body_as_var->name == z_name)
-                        return 0;
-                    else
-                        return {};
-                }
-
-                // or if it is an application of the s-bound variable some number of times to z
-                const Application* body_as_app {std::get_if<Application>(&(*z_abstr->body))};
-                int count {0};
-                while (body_as_app)
-                {
-                    ++count;
-
-                    // if lhs is not s variable, return nothing
-                    const Variable* lhs_as_var {std::get_if<Variable>(&(*body_as_app->lhs))};
-                    if (!lhs_as_var || lhs_as_var->name != s_name)
-                        return {};
-
-                    // check if rhs is just z variable
-                    const Variable* rhs_as_var {std::get_if<Variable>(&(*body_as_app->rhs))};
-                    if (rhs_as_var)
-                    {
-                        if (rhs_as_var->name == z_name)
-                            return count;
-                    }
-
-                    // continue loop is rhs is application
-                    body_as_app = std::get_if<Application>(&(*body_as_app->rhs));
-                }
+            // another s applied to the rest of the spine
+            if (is_variable(*body_as_app->lhs, s_name))
+            {
+                ++count;
+                body = &*body_as_app->rhs;
+                continue;
             }
+
+            // or a numeral applied to s and z, which makes up the rest
+            const Application* inner {std::get_if<Application>(&*body_as_app->lhs)};
+            if (inner == nullptr || !is_variable(*inner->rhs, s_name) || !is_variable(*body_as_app->rhs, z_name))
+                return {};
+            std::optional<Natural> rest {read_numeral(*inner->lhs)};
+            if (rest.has_value())
+                rest.value() += Natural {count};
+            return rest;
         }
-        return {};
+    }
+
+    auto from_numeral(const Term& term) -> std::optional<int>
+    {
+        std::optional<Natural> value {read_numeral(term)};
+        if (!value.has_value())
+            return {};
+        std::optional<std::uint64_t> small {value->to_uint64()};
+        if (!small.has_value() || small.value() > static_cast<std::uint64_t>(std::numeric_limits<int>::max()))
+            return {};
+        return static_cast<int>(small.value());
     }
 
     auto to_numeral(uint val) -> Term
     {
-        Term body {var("z")};
-        while (val > 0)
-        {
-            body = app(var("s"), body);
-            --val;
-        }
-        return lam("s", lam("z", body));
+        return Abstraction {"s", make_term(Abstraction {"z", spine_cache().spine(val)})};
+    }
+
+    auto unfold(const Numeral& numeral) -> Term
+    {
+        Natural rest {numeral.value};
+        --rest;
+        if (rest < Natural {max_church_literal})
+            return to_numeral(static_cast<uint>(numeral.value.to_uint64().value()));
+
+        Term smaller {Application {Application {Numeral {std::move(rest)}, Variable {"s"}}, Variable {"z"}}};
+        return Abstraction {"s", Abstraction {"z", Application {Variable {"s"}, std::move(smaller)}}};
+    }
+
+    auto expand(const Numeral& numeral) -> Term
+    {
+        std::optional<std::uint64_t> value {numeral.value.to_uint64()};
+        if (!value.has_value() || value.value() > max_expanded_numeral)
+            throw std::length_error("Numeral " + as_string(numeral.value) + " is too large to expand");
+        return to_numeral(static_cast<uint>(value.value()));
     }
-}
\ No newline at end of file
+}
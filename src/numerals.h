@@ -3,12 +3,19 @@
 //
 
 /**
- * Representing natural numbers as Church numerals
+ * Representing natural numbers as Church numerals.
+ *
+ * Small literals are built as Church numerals straight away. Larger ones
+ * are kept as Numeral nodes holding the value, which are unfolded one
+ * successor at a time when reduction applies them, so a numeral that is
+ * only passed around or tested never gets built in unary.
  */
 
 #ifndef LAMBDA_NUMERALS_H
 #define LAMBDA_NUMERALS_H
 
+#include <cstdint>
+#include <optional>
 #include <string>
 
 #include "parse.h"
@@ -17,13 +24,34 @@
 
 namespace lambda
 {
+    // literals above this become Numeral nodes
+    constexpr uint max_church_literal {1u << 16u};
+
+    // Numeral nodes above this are too large to build in unary; the optimal
+    // engine, the only one that has to, takes hundreds of bytes a successor
+    constexpr std::uint64_t max_expanded_numeral {1u << 20u};
+
     auto parse_numeral(const std::string& str) -> ParseResult;
 
     auto contract_numeral(const Term& term) -> Term;
 
+    /**
+     * The value of a Church numeral or Numeral node. A spine ending in a
+     * numeral applied to s and z, as reducing to head normal form leaves,
+     * counts that numeral's value without walking it.
+     */
+    auto read_numeral(const Term& term) -> std::optional<Natural>;
+
+    // nothing if the term isn't a numeral or its value doesn't fit in an int
     auto from_numeral(const Term& term) -> std::optional<int>;
 
     auto to_numeral(uint val) -> Term;
+
+    // \s.\z. s (m s z) for m one less, or the Church numeral once it is small
+    auto unfold(const Numeral& numeral) -> Term;
+
+    // the Church numeral; throws std::length_error above max_expanded_numeral
+    auto expand(const Numeral& numeral) -> Term;
 }
 
 #endif //LAMBDA_NUMERALS_H
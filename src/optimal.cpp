@@ -0,0 +1,1080 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <initializer_list>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "cancel.h"
+#include "instrument.h"
+#include "letrec.h"
+#include "numerals.h"
+#include "optimal.h"
+
+//      Net encoding
+//      ------------
+//  Every node has a principal port (slot 0) and up to two auxiliary ports.
+//
+//      Con         lambda: 0 = the lambda, 1 = its variable, 2 = its body
+//                  application: 0 = function, 1 = argument, 2 = result
+//      Dup         0 = shared value, 1 and 2 = the two copies
+//      Croissant   0 = towards the value, 1 = a variable occurrence
+//      Bracket     0 = towards the value, 1 = into an argument
+//      Era         0 = discarded wire
+//      Free        0 = a variable that is not bound anywhere in the net
+//      Root        0 = the normal form being read back
+//
+//  All nodes but erasers, free variables and the root have a level. A term
+//  at level n has its arguments at level n + 1; a variable used inside an
+//  argument reaches it through a bracket on the way in, and every occurrence
+//  is brought back to its own level by a croissant. These are Lamping's
+//  control nodes, and the levels are what tell the copies made by one
+//  duplicator from the copies made by another.
+//
+//  Two nodes interact when their principal ports are connected. Nodes of
+//  the same kind and level annihilate (for Con this is beta reduction).
+//  Otherwise they commute past each other, and the node with the higher
+//  level has it raised by a bracket or lowered by a croissant on the way.
+//  Erasers consume whatever they meet.
+
+namespace lambda::optimal
+{
+    namespace
+    {
+        using Port = std::uint32_t;
+
+        enum class Kind : std::uint8_t {Root, Con, Dup, Croissant, Bracket, Era, Free};
+
+        struct Node
+        {
+            Kind kind;
+            std::uint32_t level;
+            std::uint32_t name;
+            std::array<Port, 3> ports;
+        };
+
+        struct LimitExceeded {};
+
+        // the head of the term is a cycle of wires that no rewrite will break
+        struct NoHead {};
+
+        // the net left the shapes the oracle keeps it in, so it can't be read back
+        struct Unsound
+        {
+            const char* reason;
+        };
+
+        auto port(std::uint32_t node, std::uint32_t slot) -> Port
+        {
+            return (node << 2u) | slot;
+        }
+
+        auto node_of(Port p) -> std::uint32_t
+        {
+            return p >> 2u;
+        }
+
+        auto slot_of(Port p) -> std::uint32_t
+        {
+            return p & 3u;
+        }
+
+        auto proper(Kind kind) -> bool
+        {
+            return kind == Kind::Con || kind == Kind::Dup;
+        }
+
+        auto arity(Kind kind) -> std::uint32_t
+        {
+            switch (kind)
+            {
+                case Kind::Con:
+                case Kind::Dup:
+                    return 2;
+
+                case Kind::Croissant:
+                case Kind::Bracket:
+                    return 1;
+
+                default:
+                    return 0;
+            }
+        }
+
+        /**
+         * Where read-back paths are, in Lamping's context semantics. Each
+         * level holds a stack of the copies by which a path entered
+         * duplicators of that level, so that leaving a shared value goes back
+         * out through the same copy. Passing a croissant towards the value
+         * opens a new level, and passing a bracket pairs two levels into one.
+         *
+         * A context is a list of the levels with a copy open in them, the
+         * highest first, in an arena that only grows; the rest are empty.
+         * Changing a level rebuilds only the levels above it and shares the
+         * rest, so paths that branch at an application share their context
+         * instead of copying it, and the levels a path opens and closes as
+         * it goes in and out of arguments cost nothing while they are empty.
+         */
+        class ReadContexts
+        {
+        public:
+            // the highest level with a copy open in it, or 0 if there is none
+            using Context = std::size_t;
+
+            auto enter_copy(Context& context, std::uint32_t level, std::uint32_t slot) -> void
+            {
+                std::size_t below {stack(context, level)};
+                splice(context, level, 1, {push(slot, below)});
+            }
+
+            auto leave_copy(Context& context, std::uint32_t level) -> std::uint32_t
+            {
+                std::size_t top {stack(context, level)};
+                if (top == 0 || entries[top].slot == 0)
+                    throw Unsound {"a shared value was left without having been entered"};
+                std::uint32_t slot {entries[top].slot};
+                splice(context, level, 1, {entries[top].below});
+                return slot;
+            }
+
+            auto open_level(Context& context, std::uint32_t level) -> void
+            {
+                splice(context, level, 0, {0});
+            }
+
+            auto close_level(Context& context, std::uint32_t level) -> void
+            {
+                splice(context, level, 1, {});
+            }
+
+            auto pair_levels(Context& context, std::uint32_t level) -> void
+            {
+                std::size_t lower {stack(context, level)};
+                std::size_t upper {stack(context, level + 1)};
+                std::size_t paired {0};
+                if (lower != 0 || upper != 0)
+                    paired = push(0, lower, upper);
+                splice(context, level, 2, {paired});
+            }
+
+            auto split_level(Context& context, std::uint32_t level) -> void
+            {
+                std::size_t paired {stack(context, level)};
+                if (paired != 0 && entries[paired].slot != 0)
+                    throw Unsound {"a level was split while a copy was open in it"};
+                Entry entry {entries[paired]};
+                splice(context, level, 1, {entry.below, entry.second});
+            }
+
+        private:
+            struct Entry
+            {
+                // the copy entered, or 0 for a pair of levels held in below and second
+                std::uint32_t slot;
+                std::size_t below;
+                std::size_t second;
+            };
+
+            struct Level
+            {
+                std::uint32_t level;
+                std::size_t stack;
+                std::size_t below;
+            };
+
+            // index 0 is the empty stack, and the end of every list of levels
+            std::vector<Entry> entries {{0, 0, 0}};
+            std::vector<Level> levels {{0, 0, 0}};
+
+            // the levels spliced over, kept to reuse the allocation
+            std::vector<Level> above {};
+
+            auto push(std::uint32_t slot, std::size_t below, std::size_t second = 0) -> std::size_t
+            {
+                entries.push_back({slot, below, second});
+                return entries.size() - 1;
+            }
+
+            auto stack(Context context, std::uint32_t level) const -> std::size_t
+            {
+                while (context != 0 && levels[context].level > level)
+                    context = levels[context].below;
+                return context != 0 && levels[context].level == level ? levels[context].stack : 0;
+            }
+
+            // replaces the count levels from level up with the stacks given,
+            // lowest first, moving the levels above them up or down to suit
+            auto splice(Context& context, std::uint32_t level, std::uint32_t count,
+                        std::initializer_list<std::size_t> stacks) -> void
+            {
+                above.clear();
+                Context rest {context};
+                for (; rest != 0 && levels[rest].level >= level + count; rest = levels[rest].below)
+                    above.push_back(levels[rest]);
+                while (rest != 0 && levels[rest].level >= level)
+                    rest = levels[rest].below;
+
+                std::uint32_t next {level};
+                for (std::size_t stack : stacks)
+                {
+                    if (stack != 0)
+                        rest = link(next, stack, rest);
+                    ++next;
+                }
+                for (auto moved {above.rbegin()}; moved != above.rend(); ++moved)
+                    rest = link(moved->level - count + static_cast<std::uint32_t>(stacks.size()), moved->stack, rest);
+                context = rest;
+            }
+
+            auto link(std::uint32_t level, std::size_t stack, std::size_t below) -> std::size_t
+            {
+                levels.push_back({level, stack, below});
+                return levels.size() - 1;
+            }
+        };
+
+        class Net
+        {
+        public:
+            Net(std::size_t limit, CancelToken* cancel) : limit {limit}, cancel {cancel} {}
+
+            auto compile(const Term& term, const Definitions& definitions) -> void;
+            auto read_back() -> Term;
+            auto stats() const -> Stats;
+
+        private:
+            std::vector<Node> nodes {};
+            std::vector<std::uint32_t> free_list {};
+            std::size_t live {0};
+            std::size_t peak {0};
+
+            std::vector<std::string> names {};
+
+            std::size_t limit;
+            CancelToken* cancel;
+            std::size_t interactions {0};
+            std::size_t bookkeeping {0};
+
+            // settle's walk, kept to reuse its allocation
+            std::vector<Port> path {};
+
+            // read-back state
+            std::unordered_map<std::string, std::size_t> in_scope {};
+            std::unordered_set<std::string> free_names {};
+
+            // a walk that only passes into copies and through control nodes
+            // ends at the same variable whatever its context, so the lambda
+            // is remembered for each port on it. Otherwise an occurrence under
+            // n arguments walks back through the brackets and duplicators of
+            // all n, as every other one does. Such a walk crosses no active
+            // pair, and a rewrite only changes the wires of the pair it
+            // rewrites, so only the walks from or to a node that goes are
+            // forgotten.
+            std::unordered_map<Port, std::uint32_t> variables {};
+            std::unordered_map<std::uint32_t, std::vector<Port>> walked_to {};
+
+            auto make(Kind kind, std::uint32_t level = 0, std::uint32_t name = 0) -> std::uint32_t;
+            auto release(std::uint32_t n) -> void;
+            auto enter(Port p) const -> Port;
+            auto link(Port a, Port b) -> void;
+            auto intern(const std::string& name) -> std::uint32_t;
+
+            auto active(std::uint32_t a, std::uint32_t b) const -> bool;
+            auto rewrite(std::uint32_t a, std::uint32_t b) -> void;
+            auto annihilate(std::uint32_t a, std::uint32_t b) -> void;
+            auto commute(std::uint32_t a, std::uint32_t b) -> void;
+
+            auto settle(Port from) -> void;
+            auto known_variable(Port from) const -> std::optional<std::uint32_t>;
+            auto remember_variable(const std::vector<Port>& walked, std::uint32_t lambda) -> void;
+            auto fresh_name(const std::string& base) -> std::string;
+
+            friend class Compiler;
+        };
+
+        /**
+         * Translates a term into the net, without recursion. Each subterm
+         * reports the port through which it uses each of its free variables:
+         * where an application's function and argument both use a variable
+         * the two are joined by a duplicator, and a binder connects its
+         * variable to whatever its body reports. Context definitions are
+         * treated as binders that enclose the whole term, with their values
+         * at level 1 as if they were arguments.
+         */
+        class Compiler
+        {
+        public:
+            Compiler(Net& net, const Definitions& definitions) : net {net}, definitions {definitions} {}
+
+            auto operator ()(const Term& term) -> void;
+
+        private:
+            using Uses = std::unordered_map<std::string, Port>;
+
+            struct Frame
+            {
+                const Term* term;
+                std::uint32_t level;
+                Port consumer;
+
+                // set once the subterms have been scheduled, with the node made for the term
+                bool expanded;
+                std::uint32_t node;
+            };
+
+            Net& net;
+            const Definitions& definitions;
+
+            std::vector<Frame> frames {};
+            std::vector<Uses> compiled {};
+
+            // numerals built in full, which must outlive the frames that point into them
+            std::deque<Term> expanded {};
+
+            auto compile(const Term& term, std::uint32_t level, Port consumer) -> Uses;
+            auto start(const Frame& frame) -> void;
+            auto finish(const Frame& frame) -> void;
+
+            auto bind(Uses& uses, const std::string& name, Port variable) -> void;
+            auto join(Uses& uses, Uses&& argument, std::uint32_t level) -> void;
+            auto join(Uses& uses, const std::string& name, Port use, std::uint32_t level) -> void;
+            auto share(std::vector<Port>&& uses, Port source) -> void;
+        };
+
+        auto Compiler::compile(const Term& term, std::uint32_t level, Port consumer) -> Uses
+        {
+            frames.push_back({&term, level, consumer, false, 0});
+            while (!frames.empty())
+            {
+                Frame frame {frames.back()};
+                frames.pop_back();
+                if (frame.expanded)
+                    finish(frame);
+                else
+                    start(frame);
+            }
+
+            Uses uses {std::move(compiled.back())};
+            compiled.pop_back();
+            return uses;
+        }
+
+        auto Compiler::start(const Frame& frame) -> void
+        {
+            const Term& term {*frame.term};
+
+            // the net has no numeral nodes, so they are built in full
+            if (auto numeral = std::get_if<Numeral>(&term))
+            {
+                expanded.push_back(expand(*numeral));
+                frames.push_back({&expanded.back(), frame.level, frame.consumer, false, 0});
+                return;
+            }
+
+            if (auto variable = std::get_if<Variable>(&term))
+            {
+                std::uint32_t croissant {net.make(Kind::Croissant, frame.level)};
+                net.link(port(croissant, 1), frame.consumer);
+                compiled.push_back({{variable->name, port(croissant, 0)}});
+                return;
+            }
+
+            if (auto abstr = std::get_if<Abstraction>(&term))
+            {
+                std::uint32_t lambda {net.make(Kind::Con, frame.level, net.intern(abstr->name.name))};
+                net.link(port(lambda, 0), frame.consumer);
+                frames.push_back({frame.term, frame.level, frame.consumer, true, lambda});
+                frames.push_back({abstr->body.get(), frame.level, port(lambda, 2), false, 0});
+                return;
+            }
+
+            // compiled as (\x. body) definition, since the net shares the argument of a redex already
+            if (auto let = std::get_if<Let>(&term))
+            {
+                std::uint32_t application {net.make(Kind::Con, frame.level)};
+                std::uint32_t lambda {net.make(Kind::Con, frame.level, net.intern(let->name.name))};
+                net.link(port(application, 2), frame.consumer);
+                net.link(port(lambda, 0), port(application, 0));
+                frames.push_back({frame.term, frame.level, frame.consumer, true, application});
+                if (!std::holds_alternative<Variable>(*let->definition))
+                    frames.push_back({let->definition.get(), frame.level + 1, port(application, 1), false, 0});
+                frames.push_back({let->body.get(), frame.level, port(lambda, 2), false, 0});
+                return;
+            }
+
+            if (std::holds_alternative<Letrec>(term))
+                throw std::logic_error("letrec should have been hoisted");
+
+            const Application& appl {std::get<Application>(term)};
+            std::uint32_t application {net.make(Kind::Con, frame.level)};
+            net.link(port(application, 2), frame.consumer);
+            frames.push_back({frame.term, frame.level, frame.consumer, true, application});
+            if (!std::holds_alternative<Variable>(*appl.rhs))
+                frames.push_back({appl.rhs.get(), frame.level + 1, port(application, 1), false, 0});
+            frames.push_back({appl.lhs.get(), frame.level, port(application, 0), false, 0});
+        }
+
+        auto Compiler::finish(const Frame& frame) -> void
+        {
+            if (auto abstr = std::get_if<Abstraction>(frame.term))
+            {
+                bind(compiled.back(), abstr->name.name, port(frame.node, 1));
+                return;
+            }
+
+            auto let {std::get_if<Let>(frame.term)};
+            const Term& argument {let ? *let->definition : *std::get<Application>(*frame.term).rhs};
+            auto variable {std::get_if<Variable>(&argument)};
+
+            Uses boxed {};
+            if (variable == nullptr)
+            {
+                boxed = std::move(compiled.back());
+                compiled.pop_back();
+            }
+            Uses& function {compiled.back()};
+
+            if (let != nullptr)
+            {
+                std::uint32_t lambda {node_of(net.enter(port(frame.node, 0)))};
+                bind(function, let->name.name, port(lambda, 1));
+            }
+            if (variable != nullptr)
+                join(function, variable->name, port(frame.node, 1), frame.level);
+            else
+                join(function, std::move(boxed), frame.level);
+        }
+
+        auto Compiler::bind(Uses& uses, const std::string& name, Port variable) -> void
+        {
+            auto search {uses.find(name)};
+            if (search == uses.end())
+            {
+                net.link(variable, port(net.make(Kind::Era), 0));
+                return;
+            }
+            net.link(variable, search->second);
+            uses.erase(search);
+        }
+
+        auto Compiler::join(Uses& uses, Uses&& argument, std::uint32_t level) -> void
+        {
+            // each variable leaves the argument through a bracket
+            for (auto& [name, use] : argument)
+            {
+                std::uint32_t bracket {net.make(Kind::Bracket, level)};
+                net.link(port(bracket, 1), use);
+                join(uses, name, port(bracket, 0), level);
+            }
+        }
+
+        auto Compiler::join(Uses& uses, const std::string& name, Port use, std::uint32_t level) -> void
+        {
+            // shared with the function if it uses the variable too
+            auto search {uses.find(name)};
+            if (search == uses.end())
+            {
+                uses.emplace(name, use);
+                return;
+            }
+            std::uint32_t dup {net.make(Kind::Dup, level)};
+            net.link(port(dup, 1), search->second);
+            net.link(port(dup, 2), use);
+            search->second = port(dup, 0);
+        }
+
+        auto Compiler::share(std::vector<Port>&& uses, Port source) -> void
+        {
+            // a balanced tree of duplicators, so no use is more than log n copies away
+            while (uses.size() > 1)
+            {
+                std::vector<Port> joined {};
+                for (std::size_t i {0}; i + 1 < uses.size(); i += 2)
+                {
+                    std::uint32_t dup {net.make(Kind::Dup, 0)};
+                    net.link(port(dup, 1), uses[i]);
+                    net.link(port(dup, 2), uses[i + 1]);
+                    joined.push_back(port(dup, 0));
+                }
+                if (uses.size() % 2 == 1)
+                    joined.push_back(uses.back());
+                uses = std::move(joined);
+            }
+            net.link(source, uses.front());
+        }
+
+        auto Compiler::operator ()(const Term& term) -> void
+        {
+            // node 0 is the root, so the whole term hangs off port(0, 0)
+            std::uint32_t root {net.make(Kind::Root)};
+
+            std::unordered_map<std::string, std::vector<Port>> global_uses {};
+            std::vector<std::string> pending {};
+            auto use = [&](const std::string& name, Port from)
+            {
+                if (definitions.find(name) == nullptr)
+                {
+                    std::uint32_t free {net.make(Kind::Free, 0, net.intern(name))};
+                    net.free_names.insert(name);
+                    net.link(port(free, 0), from);
+                    return;
+                }
+                auto [uses, inserted] {global_uses.try_emplace(name)};
+                if (inserted)
+                    pending.push_back(name);
+                uses->second.push_back(from);
+            };
+
+            for (auto& [name, from] : compile(term, 0, port(root, 0)))
+                use(name, from);
+
+            // compile each referenced definition once, as the argument of a
+            // redex around the term, so that the term's binders are not visible inside it
+            std::unordered_map<std::string, Port> values {};
+            while (!pending.empty())
+            {
+                std::string name {std::move(pending.back())};
+                pending.pop_back();
+
+                // the holder only exists to capture the definition's output
+                std::uint32_t holder {net.make(Kind::Root)};
+                for (auto& [used, from] : compile(*definitions.find(name), 1, port(holder, 0)))
+                {
+                    if (definitions.find(used) == nullptr)
+                    {
+                        use(used, from);
+                        continue;
+                    }
+                    std::uint32_t bracket {net.make(Kind::Bracket, 0)};
+                    net.link(port(bracket, 1), from);
+                    use(used, port(bracket, 0));
+                }
+                values.emplace(name, net.enter(port(holder, 0)));
+                net.release(holder);
+            }
+
+            // only now are all uses known, including those from other definitions
+            for (auto& [name, uses] : global_uses)
+                share(std::move(uses), values.at(name));
+        }
+
+        auto Net::make(Kind kind, std::uint32_t level, std::uint32_t name) -> std::uint32_t
+        {
+            std::uint32_t n;
+            if (free_list.empty())
+            {
+                n = static_cast<std::uint32_t>(nodes.size());
+                nodes.emplace_back();
+            }
+            else
+            {
+                n = free_list.back();
+                free_list.pop_back();
+            }
+
+            Node& node {nodes[n]};
+            node.kind = kind;
+            node.level = level;
+            node.name = name;
+            node.ports = {port(n, 0), port(n, 1), port(n, 2)};
+
+            peak = std::max(peak, ++live);
+            return n;
+        }
+
+        auto Net::release(std::uint32_t n) -> void
+        {
+            free_list.push_back(n);
+            --live;
+
+            if (variables.empty())
+                return;
+            for (std::uint32_t slot {0}; slot < 3; ++slot)
+                variables.erase(port(n, slot));
+            auto reaching {walked_to.find(n)};
+            if (reaching != walked_to.end())
+            {
+                for (Port from : reaching->second)
+                {
+                    auto known {variables.find(from)};
+                    if (known != variables.end() && known->second == n)
+                        variables.erase(known);
+                }
+                walked_to.erase(reaching);
+            }
+        }
+
+        auto Net::enter(Port p) const -> Port
+        {
+            return nodes[node_of(p)].ports[slot_of(p)];
+        }
+
+        auto Net::link(Port a, Port b) -> void
+        {
+            nodes[node_of(a)].ports[slot_of(a)] = b;
+            nodes[node_of(b)].ports[slot_of(b)] = a;
+        }
+
+        auto Net::intern(const std::string& name) -> std::uint32_t
+        {
+            names.push_back(name);
+            return static_cast<std::uint32_t>(names.size() - 1);
+        }
+
+        auto Net::active(std::uint32_t a, std::uint32_t b) const -> bool
+        {
+            Kind ka {nodes[a].kind};
+            Kind kb {nodes[b].kind};
+            if (ka == Kind::Root || kb == Kind::Root)
+                return false;
+
+            // an application of a free variable is stuck
+            if ((ka == Kind::Con && kb == Kind::Free) || (ka == Kind::Free && kb == Kind::Con))
+                return false;
+
+            return !(ka == Kind::Free && kb == Kind::Free);
+        }
+
+        auto Net::rewrite(std::uint32_t a, std::uint32_t b) -> void
+        {
+            // only rewrites of lambdas, applications and duplicators count
+            // against the limit: the rest is bookkeeping, which cannot go on
+            // forever by itself but can be cancelled
+            if (proper(nodes[a].kind) && proper(nodes[b].kind))
+            {
+                if (++interactions > limit)
+                    throw LimitExceeded {};
+            }
+            else
+            {
+                ++bookkeeping;
+            }
+            if (cancel)
+                cancel->check(interactions + bookkeeping);
+
+            // order the pair so that erasers and free variables come first
+            if (nodes[b].kind == Kind::Era || (nodes[b].kind == Kind::Free && nodes[a].kind != Kind::Era))
+                std::swap(a, b);
+
+            Kind ka {nodes[a].kind};
+            if (ka == Kind::Era || ka == Kind::Free)
+            {
+                // erase the other node, or pass the free variable through it
+                std::uint32_t name {nodes[a].name};
+                for (std::uint32_t slot {1}; slot <= arity(nodes[b].kind); ++slot)
+                {
+                    std::uint32_t copy {make(ka, 0, name)};
+                    link(port(copy, 0), enter(port(b, slot)));
+                }
+                release(a);
+                release(b);
+                return;
+            }
+
+            if (ka == nodes[b].kind && nodes[a].level == nodes[b].level)
+                annihilate(a, b);
+            else
+                commute(a, b);
+        }
+
+        auto Net::annihilate(std::uint32_t a, std::uint32_t b) -> void
+        {
+            // the far end of a wire, following it through a and b if it is looped between them
+            auto outside = [this, a, b](Port p) -> std::optional<Port>
+            {
+                for (std::size_t hops {0}; hops < 4; ++hops)
+                {
+                    if (node_of(p) != a && node_of(p) != b)
+                        return p;
+                    p = enter(port(node_of(p) == a ? b : a, slot_of(p)));
+                }
+                return {};
+            };
+
+            for (std::uint32_t slot {1}; slot <= arity(nodes[a].kind); ++slot)
+            {
+                std::optional<Port> lhs {outside(enter(port(a, slot)))};
+                std::optional<Port> rhs {outside(enter(port(b, slot)))};
+                if (lhs.has_value() && rhs.has_value())
+                    link(lhs.value(), rhs.value());
+            }
+            release(a);
+            release(b);
+        }
+
+        auto Net::commute(std::uint32_t a, std::uint32_t b) -> void
+        {
+            if (nodes[a].level > nodes[b].level)
+                std::swap(a, b);
+
+            // copies, since making nodes may reallocate the node vector
+            const Node lower {nodes[a]};
+            const Node upper {nodes[b]};
+            if (lower.level == upper.level)
+                throw Unsound {"two different nodes met at the same level"};
+            if (lower.kind == Kind::Con && upper.kind == Kind::Con)
+                throw Unsound {"a function met an application at a different level"};
+
+            std::uint32_t level {upper.level};
+            if (lower.kind == Kind::Bracket)
+                ++level;
+            else if (lower.kind == Kind::Croissant)
+                --level;
+
+            // each node is copied once for every auxiliary port of the other
+            std::array<std::uint32_t, 2> upper_copies {};
+            std::array<std::uint32_t, 2> lower_copies {};
+            for (std::uint32_t i {0}; i < arity(lower.kind); ++i)
+                upper_copies[i] = make(upper.kind, level, upper.name);
+            for (std::uint32_t j {0}; j < arity(upper.kind); ++j)
+                lower_copies[j] = make(lower.kind, lower.level, lower.name);
+
+            // the copies take over the wires of the auxiliary ports, including any looped between a and b
+            auto outside = [&](Port p) -> Port
+            {
+                if (node_of(p) == a)
+                    return port(upper_copies[slot_of(p) - 1], 0);
+                if (node_of(p) == b)
+                    return port(lower_copies[slot_of(p) - 1], 0);
+                return p;
+            };
+            std::array<Port, 2> lower_wires {};
+            std::array<Port, 2> upper_wires {};
+            for (std::uint32_t i {0}; i < arity(lower.kind); ++i)
+                lower_wires[i] = outside(enter(port(a, i + 1)));
+            for (std::uint32_t j {0}; j < arity(upper.kind); ++j)
+                upper_wires[j] = outside(enter(port(b, j + 1)));
+
+            for (std::uint32_t i {0}; i < arity(lower.kind); ++i)
+                link(port(upper_copies[i], 0), lower_wires[i]);
+            for (std::uint32_t j {0}; j < arity(upper.kind); ++j)
+                link(port(lower_copies[j], 0), upper_wires[j]);
+            for (std::uint32_t i {0}; i < arity(lower.kind); ++i)
+            {
+                for (std::uint32_t j {0}; j < arity(upper.kind); ++j)
+                    link(port(lower_copies[j], i + 1), port(upper_copies[i], j + 1));
+            }
+            release(a);
+            release(b);
+        }
+
+        /**
+         * Reduces the wire consumed by `from` to head form: follows the head
+         * path from results to functions, from copies to the shared value and
+         * through control nodes towards the value, rewriting the first active
+         * pair on it, until the path ends at a lambda, a variable or a
+         * principal port facing `from`. After a rewrite the walk resumes from
+         * the node before the pair, since nothing before it has changed.
+         */
+        auto Net::settle(Port from) -> void
+        {
+            path.clear();
+            while (true)
+            {
+                // the rest of the path is known to end at a variable, so has no active pair
+                if (!path.empty() && known_variable(path.back()).has_value())
+                    return;
+
+                Port current {enter(path.empty() ? from : path.back())};
+                std::uint32_t n {node_of(current)};
+                if (slot_of(current) == 0)
+                {
+                    if (path.empty() || !active(node_of(path.back()), n))
+                        return;
+                    rewrite(node_of(path.back()), n);
+                    path.pop_back();
+                    continue;
+                }
+
+                // a lambda's variable
+                if (nodes[n].kind == Kind::Con && slot_of(current) == 1)
+                    return;
+
+                // longer than the net, so the walk is going round a cycle
+                if (path.size() > live)
+                    throw NoHead {};
+                path.push_back(port(n, 0));
+            }
+        }
+
+        auto Net::known_variable(Port from) const -> std::optional<std::uint32_t>
+        {
+            auto known {variables.find(from)};
+            if (known == variables.end())
+                return {};
+            return known->second;
+        }
+
+        auto Net::remember_variable(const std::vector<Port>& walked, std::uint32_t lambda) -> void
+        {
+            std::vector<Port>& reaching {walked_to[lambda]};
+            for (Port from : walked)
+            {
+                if (variables.emplace(from, lambda).second)
+                    reaching.push_back(from);
+            }
+        }
+
+        auto Net::read_back() -> Term
+        {
+            struct Task
+            {
+                enum class Kind {Read, Apply, Abstract} kind;
+                Port from;
+                ReadContexts::Context context;
+
+                // for Abstract, the lambda whose body has been read
+                std::uint32_t lambda;
+            };
+
+            std::vector<Task> tasks {};
+            std::vector<Term> terms {};
+            ReadContexts contexts {};
+
+            // names given to each lambda along the path, innermost last
+            std::unordered_map<std::uint32_t, std::vector<std::string>> binders {};
+            auto read_variable = [&](std::uint32_t lambda)
+            {
+                auto search {binders.find(lambda)};
+                if (search == binders.end() || search->second.empty())
+                    throw Unsound {"a variable was read outside its lambda"};
+                terms.emplace_back(Variable {search->second.back()});
+            };
+
+            // the ports walked since the walk last depended on its context
+            std::vector<Port> walked {};
+
+            tasks.push_back({Task::Kind::Read, port(0, 0), {}, 0});
+            while (!tasks.empty())
+            {
+                Task task {std::move(tasks.back())};
+                tasks.pop_back();
+
+                if (task.kind == Task::Kind::Apply)
+                {
+                    Term rhs {std::move(terms.back())};
+                    terms.pop_back();
+                    terms.back() = Application {std::move(terms.back()), std::move(rhs)};
+                    continue;
+                }
+
+                if (task.kind == Task::Kind::Abstract)
+                {
+                    std::vector<std::string>& names {binders[task.lambda]};
+                    std::string name {std::move(names.back())};
+                    names.pop_back();
+                    --in_scope[name];
+                    terms.back() = Abstraction {std::move(name), std::move(terms.back())};
+                    continue;
+                }
+
+                // walk the path from the consumer to the head of the term it consumes
+                Port from {task.from};
+                ReadContexts::Context context {task.context};
+
+                // settling leaves the whole head path stable, so it only needs
+                // doing again after the walk turns off it, out of a shared value
+                // or back through a control node
+                bool settled {false};
+                bool done {false};
+                walked.clear();
+                while (!done)
+                {
+                    if (std::optional<std::uint32_t> lambda {known_variable(from)})
+                    {
+                        read_variable(lambda.value());
+                        remember_variable(walked, lambda.value());
+                        break;
+                    }
+
+                    if (!settled)
+                    {
+                        std::size_t before {interactions + bookkeeping};
+                        settle(from);
+                        if (interactions + bookkeeping != before)
+                            walked.clear();
+                    }
+                    settled = true;
+                    walked.push_back(from);
+
+                    Port current {enter(from)};
+                    std::uint32_t n {node_of(current)};
+                    std::uint32_t slot {slot_of(current)};
+                    if (slot_of(from) == 0 && slot == 0 && active(node_of(from), n))
+                        throw Unsound {"read back found a redex on the head path"};
+
+                    const Node& node {nodes[n]};
+                    switch (node.kind)
+                    {
+                        case Kind::Con:
+                            if (slot == 0)
+                            {
+                                std::string name {fresh_name(names[node.name])};
+                                ++in_scope[name];
+                                binders[n].push_back(std::move(name));
+                                tasks.push_back({Task::Kind::Abstract, 0, {}, n});
+                                tasks.push_back({Task::Kind::Read, port(n, 2), context, 0});
+                                done = true;
+                            }
+                            else if (slot == 1)
+                            {
+                                read_variable(n);
+                                remember_variable(walked, n);
+                                done = true;
+                            }
+                            else
+                            {
+                                // the function is read first, and its value ends up below the argument's
+                                tasks.push_back({Task::Kind::Apply, 0, {}, 0});
+                                tasks.push_back({Task::Kind::Read, port(n, 1), context, 0});
+                                from = port(n, 0);
+                                walked.clear();
+                            }
+                            break;
+
+                        case Kind::Dup:
+                            if (slot == 0)
+                            {
+                                from = port(n, contexts.leave_copy(context, node.level));
+                                settled = false;
+                                walked.clear();
+                            }
+                            else
+                            {
+                                contexts.enter_copy(context, node.level, slot);
+                                from = port(n, 0);
+                            }
+                            break;
+
+                        case Kind::Croissant:
+                            if (slot == 0)
+                                contexts.close_level(context, node.level);
+                            else
+                                contexts.open_level(context, node.level);
+                            from = port(n, 1 - slot);
+                            settled = settled && slot == 1;
+                            break;
+
+                        case Kind::Bracket:
+                            if (slot == 0)
+                            {
+                                contexts.split_level(context, node.level);
+                                walked.clear();
+                            }
+                            else
+                                contexts.pair_levels(context, node.level);
+                            from = port(n, 1 - slot);
+                            settled = settled && slot == 1;
+                            break;
+
+                        case Kind::Free:
+                            terms.emplace_back(Variable {names[node.name]});
+                            done = true;
+                            break;
+
+                        case Kind::Era:
+                        case Kind::Root:
+                            throw Unsound {"read back reached a disconnected wire"};
+                    }
+
+                    if (cancel)
+                        cancel->check(interactions + bookkeeping);
+                }
+            }
+
+            return std::move(terms.back());
+        }
+
+        auto Net::fresh_name(const std::string& base) -> std::string
+        {
+            return lambda::fresh_name(base, [this](const std::string& name)
+            {
+                return in_scope[name] > 0 || free_names.count(name) > 0;
+            });
+        }
+
+        auto Net::compile(const Term& term, const Definitions& definitions) -> void
+        {
+            Compiler compiler {*this, definitions};
+            compiler(term);
+        }
+
+        auto Net::stats() const -> Stats
+        {
+            return {interactions, bookkeeping, peak};
+        }
+    }
+
+    auto reduce(const Term& term, const Context& context, std::size_t limit, Stats* stats) -> ReduceResult
+    {
+        return optimal::reduce(term, ContextDefinitions {context}, limit, stats);
+    }
+
+    auto reduce(const Term& term, const Definitions& definitions, std::size_t limit, Stats* stats,
+                CancelToken* cancel) -> ReduceResult
+    {
+        instrument::PhaseScope scope {instrument::Phase::Reduce};
+        Hoisted hoisted {hoist_letrecs(term, definitions, true)};
+        ContextDefinitions scope_definitions {hoisted.definitions, &definitions};
+
+        Net net {limit, cancel};
+        try
+        {
+            net.compile(hoisted.term, scope_definitions);
+            Term normal {net.read_back()};
+            if (stats)
+                *stats = net.stats();
+            return ReduceResult::make_ok(std::move(normal));
+        }
+        catch (LimitExceeded&)
+        {
+            if (stats)
+                *stats = net.stats();
+            return ReduceResult::make_err("Interaction limit exceeded");
+        }
+        catch (NoHead&)
+        {
+            if (stats)
+                *stats = net.stats();
+            return ReduceResult::make_err("Term has no normal form: its head depends on itself");
+        }
+        catch (Unsound& unsound)
+        {
+            if (stats)
+                *stats = net.stats();
+            return ReduceResult::make_err(std::string {"Optimal reduction failed: "} + unsound.reason);
+        }
+        catch (Interrupted& interrupted)
+        {
+            if (stats)
+                *stats = net.stats();
+            return ReduceResult::make_err(interrupted.reason);
+        }
+        catch (std::length_error& e)
+        {
+            return ReduceResult::make_err(e.what());
+        }
+    }
+
+    auto evaluate(const Term& term, const Context& context) -> EvalResult
+    {
+        ReduceResult reduction {optimal::reduce(term, context)};
+        Term* normal {reduction.get_ok()};
+        if (normal == nullptr)
+            return EvalResult::make_err(*reduction.get_err());
+
+        // only abstractions are values
+        Abstraction* result_as_abstr {std::get_if<Abstraction>(normal)};
+        if (result_as_abstr)
+            return EvalResult::make_ok(std::move(*result_as_abstr));
+
+        return EvalResult::make_err("Could not reduce term to value");
+    }
+}
@@ -0,0 +1,55 @@
+//
+// Created by colin on 10/19/26.
+//
+
+/**
+ * Experimental evaluator based on Lamping's abstract algorithm: terms are
+ * compiled to an interaction net of lambda/application nodes, duplicators
+ * and erasers, reduced by local graph rewrites and read back into a Term.
+ *
+ * Duplication is incremental, so work under binders is shared between
+ * copies instead of being repeated. Brackets and croissants keep track of
+ * which duplicator made which copy, so that copies of copies pair up
+ * correctly and the result is read back by following paths through the net.
+ */
+
+#ifndef LAMBDA_OPTIMAL_H
+#define LAMBDA_OPTIMAL_H
+
+#include <cstddef>
+
+#include "eval.h"
+#include "parse.h"
+
+namespace lambda::optimal
+{
+    struct Stats
+    {
+        // beta reductions and duplications
+        std::size_t interactions {0};
+
+        // rewrites of brackets, croissants and erasers
+        std::size_t bookkeeping {0};
+
+        std::size_t peak_nodes {0};
+    };
+
+    using ReduceResult = result::Result<Term, lang_tools::EvalErr>;
+
+    // upper bound on interactions before giving up
+    constexpr std::size_t default_limit {50'000'000};
+
+    /**
+     * Computes the normal form of a term. Names found in the context are
+     * compiled once each and shared between all of their occurrences.
+     */
+    auto reduce(const Term& term, const Context& context = {},
+                std::size_t limit = default_limit, Stats* stats = nullptr) -> ReduceResult;
+    auto reduce(const Term& term, const Definitions& definitions,
+                std::size_t limit = default_limit, Stats* stats = nullptr,
+                CancelToken* cancel = nullptr) -> ReduceResult;
+
+    auto evaluate(const Term& term, const Context& context) -> EvalResult;
+}
+
+#endif //LAMBDA_OPTIMAL_H
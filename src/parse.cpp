@@ -1,21 +1,36 @@
 //
 // Created by colin on 6/2/20.
 //
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <optional>
 #include <sstream>
+#include <string>
+#include <unordered_map>
 #include <utility>
 #include <variant>
+#include <vector>
 
 #include "lang_tools/parse/parse.hpp"
 #include "result/Result.hpp"
+#include "cancel.h"
+#include "loader.h"
 #include "parse.h"
 #include "numerals.h"
+#include "print.h"
 
 
 //      Grammar
 //      -------
 //    Term ->	Abst
+//          |	Let
 //          |	Appl
+//          |	Appl Abst
+//          |	Appl Let
 //    Abst ->	\ Name . Term
+//     Let ->	let Name = Term in Term
+//          |	letrec Name = Term in Term
 //    Appl ->	Atom
 //          |	Appl Atom
 //    Atom ->	( Term )
@@ -24,257 +39,746 @@
 //          |   Numeral
 // Numeral ->   [0-9]+
 //
+// The parser keeps the parens and binders it is inside of on a stack of
+// its own rather than recursing, so nesting depth is limited only by
+// memory. The body of a binder or let runs as far right as it can, so it
+// is closed by the paren that encloses it, the in that ends an enclosing
+// let's definition, or the end of the input.
+//
 
 namespace lambda
 {
-    auto parse_term(std::queue<Token>& tokens) -> ParseResult;
-
-    auto unexpected_token(TokenType expected, TokenType got) -> ParseResult
+    namespace
     {
-        return ParseResult::make_err(
-                "expected " + as_string(expected) + ", got " + as_string(got));
-    }
+        // a paren, binder or let the parser has opened but not yet closed
+        struct Frame
+        {
+            enum class Kind {Top, Paren, Binder, Definition, LetBody};
 
-    auto parse_name(std::queue<Token>& tokens) -> ParseResult
-    {
-        Token tok {tokens.front()};
-        tokens.pop();
+            Kind kind;
+            std::string binder {};
 
-        // if token is name return ok
-        if (tok.type == TokenType::Name)
-            return ParseResult::make_ok(Variable { tok.value });
+            // whether a let is a letrec
+            bool recursive {false};
 
-        // or if numeral return ok
-        else if (tok.type == TokenType::Numeral)
-            return parse_numeral(tok.value);
+            // the application read so far inside the frame, if any
+            std::optional<Term> applied {};
 
-        // otherwise err
-        return unexpected_token(TokenType::Name, tok.type);
-    }
+            // a let's definition, once its body is being read
+            std::optional<Term> definition {};
+        };
 
-    auto parse_atom(std::queue<Token>& tokens) -> ParseResult
-    {
-        if (tokens.front().type == TokenType::LeftParen)
+        // applies what has been read so far in the frame to the term
+        auto apply(Frame& frame, Term&& term) -> void
         {
-            tokens.pop();
-            ParseResult term_result {parse_term(tokens)};
-
-            // check matching closing paren
-            if (tokens.front().type == TokenType::RightParen)
-            {
-                tokens.pop();
-                return std::move(term_result);
-            }
+            if (frame.applied.has_value())
+                frame.applied = Application {std::move(frame.applied.value()), std::move(term)};
             else
-            {
-                return unexpected_token(TokenType::RightParen, tokens.front().type);
-            }
+                frame.applied = std::move(term);
         }
-        else
+
+        auto close_let(Frame& let) -> Term
         {
-            return parse_name(tokens);
+            term_ptr definition {make_term(std::move(let.definition.value()))};
+            term_ptr body {make_term(std::move(let.applied.value()))};
+            if (let.recursive)
+                return Letrec {std::move(let.binder), std::move(definition), std::move(body)};
+            return Let {std::move(let.binder), std::move(definition), std::move(body)};
         }
+
+        // ends the bodies of the innermost binders and lets; false if one was empty
+        auto close_binders(std::vector<Frame>& stack) -> bool
+        {
+            while (stack.back().kind == Frame::Kind::Binder || stack.back().kind == Frame::Kind::LetBody)
+            {
+                Frame& binder {stack.back()};
+                if (!binder.applied.has_value())
+                    return false;
+
+                Term term {binder.kind == Frame::Kind::Binder
+                    ? Term {Abstraction {std::move(binder.binder), std::move(binder.applied.value())}}
+                    : close_let(binder)};
+                stack.pop_back();
+                apply(stack.back(), std::move(term));
+            }
+            return true;
+        }
+    }
+
+    auto unexpected_token(TokenType expected, const Token& got) -> ParseResult
+    {
+        return ParseResult::make_err(
+                "expected " + as_string(expected) + ", got " + as_string(got.type)
+                + " at column " + std::to_string(got.column));
+    }
+
+    auto end_of_input(TokenType expected, std::size_t column) -> ParseResult
+    {
+        return ParseResult::make_err(
+                "expected " + as_string(expected) + ", got end of input at column " + std::to_string(column));
     }
 
-    auto parse_application(std::queue<Token>& tokens) -> ParseResult
+    auto parse(std::queue<Token> tokens) -> ParseResult
     {
-        ParseResult left_result {parse_atom(tokens)};
+        instrument::PhaseScope scope {instrument::Phase::Parse};
+        std::vector<Frame> stack {};
+        stack.push_back(Frame {Frame::Kind::Top});
 
-        // if it was an error, return early
-        if (left_result.is_err())
-            return left_result;
+        // just past the last token consumed, for errors at the end
+        std::size_t end {1};
+        auto next = [&tokens, &end]() -> Token
+        {
+            Token token {std::move(tokens.front())};
+            tokens.pop();
+            end = token.column + token.value.size();
+            return token;
+        };
 
-        // if nothing left or closing paren, return just the atom
-        if (tokens.empty() || tokens.front().type == TokenType::RightParen)
-            return left_result;
+        while (!tokens.empty())
+        {
+            Token token {next()};
+            switch (token.type)
+            {
+                case TokenType::Name:
+                    apply(stack.back(), Variable {std::move(token.value)});
+                    break;
 
-        // otherwise apply the atom to the remaining tokens
-        ParseResult right_result {parse_atom(tokens)};
+                case TokenType::Numeral:
+                {
+                    ParseResult numeral {parse_numeral(token.value)};
+                    if (numeral.is_err())
+                        return numeral;
+                    apply(stack.back(), std::move(numeral).take_ok());
+                    break;
+                }
 
-        // if error, return the error
-        if (right_result.is_err())
-            return right_result;
+                case TokenType::LeftParen:
+                    stack.push_back(Frame {Frame::Kind::Paren});
+                    break;
 
-        // otherwise both left and right are ok
-        Term& left {*left_result.get_ok()};
-        Term& right {*right_result.get_ok()};
-        Term app {Application {left, right}};
+                case TokenType::Lambda:
+                {
+                    if (tokens.empty())
+                        return end_of_input(TokenType::Name, end);
+                    Token name {next()};
+                    if (name.type != TokenType::Name)
+                        return unexpected_token(TokenType::Name, name);
+
+                    if (tokens.empty())
+                        return end_of_input(TokenType::Dot, end);
+                    if (tokens.front().type != TokenType::Dot)
+                        return unexpected_token(TokenType::Dot, tokens.front());
+                    next();
+
+                    stack.push_back(Frame {Frame::Kind::Binder, std::move(name.value)});
+                    break;
+                }
 
-        while (!tokens.empty() && tokens.front().type != TokenType::RightParen)
-        {
-            // otherwise apply this application to remainder to get a new application
-            ParseResult rem_result{parse_atom(tokens)};
-            if (rem_result.is_err())
-                return rem_result;
+                case TokenType::Let:
+                case TokenType::Letrec:
+                {
+                    if (tokens.empty())
+                        return end_of_input(TokenType::Name, end);
+                    Token name {next()};
+                    if (name.type != TokenType::Name)
+                        return unexpected_token(TokenType::Name, name);
+
+                    if (tokens.empty())
+                        return end_of_input(TokenType::Equals, end);
+                    if (tokens.front().type != TokenType::Equals)
+                        return unexpected_token(TokenType::Equals, tokens.front());
+                    next();
+
+                    stack.push_back(Frame {Frame::Kind::Definition, std::move(name.value),
+                                           token.type == TokenType::Letrec});
+                    break;
+                }
 
-            app = Application(app, *rem_result.get_ok());
+                case TokenType::In:
+                {
+                    // the definition ends here, and with it anything opened inside it
+                    if (!close_binders(stack))
+                        return unexpected_token(TokenType::Name, token);
+                    Frame& let {stack.back()};
+                    if (let.kind != Frame::Kind::Definition)
+                        return ParseResult::make_err("unmatched IN at column " + std::to_string(token.column));
+                    if (!let.applied.has_value())
+                        return unexpected_token(TokenType::Name, token);
+
+                    let.kind = Frame::Kind::LetBody;
+                    let.definition = std::move(let.applied);
+                    let.applied.reset();
+                    break;
+                }
+
+                case TokenType::RightParen:
+                {
+                    if (!close_binders(stack))
+                        return unexpected_token(TokenType::Name, token);
+                    if (stack.back().kind == Frame::Kind::Definition)
+                        return unexpected_token(TokenType::In, token);
+                    if (stack.back().kind != Frame::Kind::Paren)
+                        return ParseResult::make_err("unmatched RIGHT_PAREN at column " + std::to_string(token.column));
+                    if (!stack.back().applied.has_value())
+                        return unexpected_token(TokenType::Name, token);
+
+                    Term inner {std::move(stack.back().applied.value())};
+                    stack.pop_back();
+                    apply(stack.back(), std::move(inner));
+                    break;
+                }
+
+                case TokenType::Dot:
+                case TokenType::Equals:
+                    return unexpected_token(TokenType::Name, token);
+            }
         }
 
-        return ParseResult::make_ok(app);
+        if (!close_binders(stack))
+            return end_of_input(TokenType::Name, end);
+        if (stack.back().kind == Frame::Kind::Paren)
+            return end_of_input(TokenType::RightParen, end);
+        if (stack.back().kind == Frame::Kind::Definition)
+            return end_of_input(TokenType::In, end);
+        if (!stack.back().applied.has_value())
+            return end_of_input(TokenType::Name, end);
+        return ParseResult::make_ok(std::move(stack.back().applied.value()));
     }
 
-    auto parse_abstraction(std::queue<Token>& tokens) -> ParseResult
+    auto as_string(const Term& term) -> std::string
     {
-        if (tokens.front().type == TokenType::Lambda)
+        std::stringstream str {};
+        print(str, term);
+        std::string result {str.str()};
+        instrument::record_bytes(result.capacity());
+        return result;
+    }
+
+    auto operator <<(std::ostream& out, const Term& term) -> std::ostream&
+    {
+        print(out, term);
+        return out;
+    }
+
+    auto fresh_name(const std::string& base, const std::function<bool(const std::string&)>& taken) -> std::string
+    {
+        std::string name {base};
+        for (std::size_t count {1}; taken(name); ++count)
         {
-            tokens.pop();
-            ParseResult name_result {parse_name(tokens)};
+            std::string suffix {};
+            for (std::size_t n {count}; n > 0; n = (n - 1) / 26)
+                suffix.insert(suffix.begin(), static_cast<char>('a' + (n - 1) % 26));
+            name = base + suffix;
+        }
+        return name;
+    }
 
-            if (name_result.is_err())
-                return name_result;
+    auto release_subterm(term_ptr&& subterm) noexcept -> void
+    {
+        // a subterm that is still shared elsewhere isn't torn down yet
+        term_ptr dropped {std::move(subterm)};
+        if (dropped == nullptr || dropped.use_count() > 1)
+            return;
+
+        // destroying a queued subterm queues its own children, which the
+        // outermost call then drops one at a time
+        thread_local std::vector<term_ptr> queued {};
+        thread_local bool releasing {false};
+        queued.push_back(std::move(dropped));
+        if (releasing)
+            return;
+
+        releasing = true;
+        while (!queued.empty())
+        {
+            term_ptr next {std::move(queued.back())};
+            queued.pop_back();
+        }
+        releasing = false;
+    }
 
-            // safe to use get directly because parse_name only returns Variable
-            Variable name {std::get<Variable>(*name_result.get_ok())};
+    /**
+     * Substitutes without recursion. A subterm's result is nullptr when it
+     * is unchanged, so that callers can share it instead of rebuilding it;
+     * each node is visited once to schedule its subterms and once more to
+     * combine their results. A reduction that substitutes into a large term
+     * can be stopped part way through.
+     */
+    class Substitutor
+    {
+    public:
 
-            if (tokens.front().type != TokenType::Dot)
-                return unexpected_token(TokenType::Dot, tokens.front().type);
+        Substitutor() = delete;
+        explicit Substitutor(Substitution sub)
+            : name {std::move(sub.first)}
+            , replacement_free {free_variables(sub.second)}
+            , replacement {make_term(std::move(sub.second))} {}
 
-            tokens.pop();
-            ParseResult subterm_result {parse_abstraction(tokens)};
+        auto operator ()(const Term& term) -> term_ptr;
 
-            // return early if there was an error
-            if (subterm_result.is_err())
-                return subterm_result;
+    private:
+        std::string name;
 
-            // safe to dereference because we just checked if it was an error
-            Term& subterm {*(subterm_result.get_ok())};
+        // free variables of the replacement, which binders must not capture
+        std::unordered_set<std::string> replacement_free;
 
-            return ParseResult::make_ok(Abstraction(name, subterm));
-        }
-        else
+        // shared by every occurrence that gets replaced
+        term_ptr replacement;
+
+        struct Frame
         {
-            return parse_application(tokens);
-        }
-    }
+            const Term* term;
+            bool expanded {false};
+
+            // the subterms visited, which are renamed copies if the binder is renamed
+            std::array<const Term*, 2> children {};
+            std::size_t count {0};
+            std::optional<std::string> renamed {};
+        };
 
-    auto parse_term(std::queue<Token>& tokens) -> ParseResult
+        // renamed copies of binder scopes, kept until they have been visited
+        std::deque<Term> renamed_scopes {};
+
+        auto expand(Frame& frame) -> void;
+        auto combine(const Frame& frame, std::vector<term_ptr>& results) const -> term_ptr;
+
+        // a new name for a binder, if keeping it would capture the replacement
+        auto rename_binder(const std::string& binder, std::initializer_list<const Term*> scope) const
+            -> std::optional<std::string>;
+    };
+
+    auto Substitutor::operator()(const Term& term) -> term_ptr
     {
-        return parse_abstraction(tokens);
+        std::vector<Frame> frames {{&term}};
+        std::vector<term_ptr> results {};
+        while (!frames.empty())
+        {
+            check_current();
+            Frame frame {std::move(frames.back())};
+            frames.pop_back();
+            if (frame.expanded)
+            {
+                results.push_back(combine(frame, results));
+                continue;
+            }
+
+            expand(frame);
+            if (frame.count == 0)
+            {
+                // a variable, a numeral (which is closed) or a binder that shadows the name
+                auto var {std::get_if<Variable>(frame.term)};
+                results.push_back(var && var->name == name ? replacement : nullptr);
+                continue;
+            }
+
+            frame.expanded = true;
+            frames.push_back(frame);
+            for (std::size_t i {frame.count}; i-- > 0;)
+                frames.push_back({frame.children[i]});
+        }
+        return results.back();
     }
 
-    auto parse(std::queue<Token> tokens) -> ParseResult
+    auto Substitutor::rename_binder(const std::string& binder, std::initializer_list<const Term*> scope) const
+        -> std::optional<std::string>
     {
-        ParseResult result {parse_abstraction(tokens)};
-
-        // parse is only successful if it used all tokens
-        if (tokens.empty())
-            return result;
+        auto free_in_scope = [&scope](const std::string& variable) -> bool
+        {
+            return std::any_of(scope.begin(), scope.end(), [&variable](const Term* term)
+            {
+                return is_free(variable, *term);
+            });
+        };
 
-        // otherwise return error
-        return ParseResult::make_err("Tokens remaining after parsing");
+        if (replacement_free.count(binder) == 0 || !free_in_scope(name))
+            return {};
 
+        return fresh_name(binder, [this, &free_in_scope](const std::string& candidate)
+        {
+            return replacement_free.count(candidate) > 0 || free_in_scope(candidate);
+        });
     }
 
-    class TermPrinter
+    auto Substitutor::expand(Frame& frame) -> void
     {
-    public:
-        TermPrinter() = default;
+        // scope is renamed to the binder's new name, if it needs one
+        auto visit_scope = [this, &frame](const std::string& binder, const Term& scope)
+        {
+            const Term* visited {&scope};
+            if (frame.renamed.has_value())
+                visited = &renamed_scopes.emplace_back(substitute({binder, Variable {frame.renamed.value()}}, scope));
+            frame.children[frame.count++] = visited;
+        };
 
-        auto operator ()(Variable var) -> std::string
+        if (auto abstr = std::get_if<Abstraction>(frame.term))
         {
-            return var.name;
+            // the bound variable shadows the one being substituted
+            if (abstr->name.name == name)
+                return;
+            frame.renamed = rename_binder(abstr->name.name, {&*abstr->body});
+            visit_scope(abstr->name.name, *abstr->body);
         }
+        else if (auto appl = std::get_if<Application>(frame.term))
+        {
+            frame.children = {&*appl->lhs, &*appl->rhs};
+            frame.count = 2;
+        }
+        else if (auto let = std::get_if<Let>(frame.term))
+        {
+            // the let binds its name in the body only
+            frame.children[frame.count++] = &*let->definition;
+            if (let->name.name == name)
+                return;
+            frame.renamed = rename_binder(let->name.name, {&*let->body});
+            visit_scope(let->name.name, *let->body);
+        }
+        else if (auto letrec = std::get_if<Letrec>(frame.term))
+        {
+            // the letrec binds its name in both the definition and the body
+            if (letrec->name.name == name)
+                return;
+            frame.renamed = rename_binder(letrec->name.name, {&*letrec->definition, &*letrec->body});
+            visit_scope(letrec->name.name, *letrec->definition);
+            visit_scope(letrec->name.name, *letrec->body);
+        }
+    }
 
-        auto operator ()(Abstraction abstr) -> std::string
+    auto Substitutor::combine(const Frame& frame, std::vector<term_ptr>& results) const -> term_ptr
+    {
+        std::array<term_ptr, 2> changed {};
+        for (std::size_t i {frame.count}; i-- > 0;)
         {
-            std::stringstream str;
-            str << "\\" << abstr.name << "." << *abstr.body;
-            return str.str();
+            changed[i] = std::move(results.back());
+            results.pop_back();
         }
 
-        auto operator ()(Application appl) -> std::string
+        // keeps whichever side doesn't change, unless the binder was renamed
+        bool renamed {frame.renamed.has_value()};
+        auto child = [&](std::size_t i, const term_ptr& original) -> term_ptr
+        {
+            if (changed[i] != nullptr)
+                return std::move(changed[i]);
+            return renamed ? make_term(*frame.children[i]) : original;
+        };
+        if (!renamed && std::all_of(changed.begin(), changed.begin() + frame.count,
+                                    [](const term_ptr& result) { return result == nullptr; }))
+            return nullptr;
+
+        if (auto abstr = std::get_if<Abstraction>(frame.term))
+            return make_term(Abstraction {renamed ? Variable {frame.renamed.value()} : abstr->name, child(0, abstr->body)});
+
+        if (auto appl = std::get_if<Application>(frame.term))
+            return make_term(Application {child(0, appl->lhs), child(1, appl->rhs)});
+
+        if (auto let = std::get_if<Let>(frame.term))
         {
-            std::stringstream str;
-            str << *appl.lhs << " " << *appl.rhs;
-            return str.str();
+            // the definition is outside the let's scope, so never renamed
+            term_ptr definition {changed[0] != nullptr ? std::move(changed[0]) : let->definition};
+            term_ptr body {frame.count == 1 ? let->body : child(1, let->body)};
+            return make_term(Let {renamed ? Variable {frame.renamed.value()} : let->name,
+                                  std::move(definition), std::move(body)});
         }
-    };
 
-    auto as_string(const Term& term) -> std::string
+        const Letrec& letrec {std::get<Letrec>(*frame.term)};
+        return make_term(Letrec {renamed ? Variable {frame.renamed.value()} : letrec.name,
+                                 child(0, letrec.definition), child(1, letrec.body)});
+    }
+
+    auto substitute(Substitution sub, const Term& term) -> Term
     {
-        return std::visit(TermPrinter {}, term);
+        instrument::PhaseScope scope {instrument::Phase::Substitute};
+        Substitutor substitutor {std::move(sub)};
+        term_ptr result {substitutor(term)};
+        return result != nullptr ? *result : term;
     }
 
-    auto operator <<(std::ostream& out, const Term& term) -> std::ostream&
+    auto is_free(const std::string& name, const Term& term) -> bool
     {
-        out << as_string(term);
-        return out;
+        std::vector<const Term*> pending {&term};
+        while (!pending.empty())
+        {
+            const Term& next {*pending.back()};
+            pending.pop_back();
+
+            if (auto var = std::get_if<Variable>(&next))
+            {
+                if (var->name == name)
+                    return true;
+            }
+            else if (auto abstr = std::get_if<Abstraction>(&next))
+            {
+                if (abstr->name.name != name)
+                    pending.push_back(&*abstr->body);
+            }
+            else if (auto appl = std::get_if<Application>(&next))
+            {
+                pending.push_back(&*appl->rhs);
+                pending.push_back(&*appl->lhs);
+            }
+            else if (auto let = std::get_if<Let>(&next))
+            {
+                if (let->name.name != name)
+                    pending.push_back(&*let->body);
+                pending.push_back(&*let->definition);
+            }
+            else if (auto letrec = std::get_if<Letrec>(&next))
+            {
+                if (letrec->name.name != name)
+                {
+                    pending.push_back(&*letrec->body);
+                    pending.push_back(&*letrec->definition);
+                }
+            }
+        }
+        return false;
     }
 
-    auto rename(std::string orig) -> std::string
+    auto free_variables(const Term& term) -> std::unordered_set<std::string>
     {
-        return orig + "`";
+        std::unordered_set<std::string> names {};
+        std::unordered_map<std::string, std::size_t> bound {};
+
+        // binders are entered and left by steps of their own, so that the
+        // walk keeps its own stack
+        struct Step
+        {
+            enum class Kind {Visit, Bind, Unbind} kind;
+            const Term* term;
+            const std::string* name {nullptr};
+        };
+        std::vector<Step> steps {{Step::Kind::Visit, &term}};
+        while (!steps.empty())
+        {
+            Step step {steps.back()};
+            steps.pop_back();
+            if (step.kind != Step::Kind::Visit)
+            {
+                bound[*step.name] += step.kind == Step::Kind::Bind ? 1 : -1;
+                continue;
+            }
+
+            const Term& t {*step.term};
+            if (auto var = std::get_if<Variable>(&t))
+            {
+                if (bound[var->name] == 0)
+                    names.insert(var->name);
+            }
+            else if (auto abstr = std::get_if<Abstraction>(&t))
+            {
+                ++bound[abstr->name.name];
+                steps.push_back({Step::Kind::Unbind, nullptr, &abstr->name.name});
+                steps.push_back({Step::Kind::Visit, &*abstr->body});
+            }
+            else if (auto let = std::get_if<Let>(&t))
+            {
+                steps.push_back({Step::Kind::Unbind, nullptr, &let->name.name});
+                steps.push_back({Step::Kind::Visit, &*let->body});
+                steps.push_back({Step::Kind::Bind, nullptr, &let->name.name});
+                steps.push_back({Step::Kind::Visit, &*let->definition});
+            }
+            else if (auto letrec = std::get_if<Letrec>(&t))
+            {
+                ++bound[letrec->name.name];
+                steps.push_back({Step::Kind::Unbind, nullptr, &letrec->name.name});
+                steps.push_back({Step::Kind::Visit, &*letrec->body});
+                steps.push_back({Step::Kind::Visit, &*letrec->definition});
+            }
+            else if (auto appl = std::get_if<Application>(&t))
+            {
+                steps.push_back({Step::Kind::Visit, &*appl->rhs});
+                steps.push_back({Step::Kind::Visit, &*appl->lhs});
+            }
+        }
+        return names;
     }
 
-    class Substitutor
+    auto replace_subterms(const Term& term, const std::function<std::optional<Term>(const Term&)>& replace) -> Term
     {
-    public:
+        // each node is visited once to replace or expand it, and once more
+        // to rebuild it from its subterms; a binder is in scope from when
+        // it is entered until its node is rebuilt
+        enum class Step {Visit, Enter, Build};
+        std::vector<std::pair<const Term*, Step>> pending {{&term, Step::Visit}};
+        std::vector<Term> results {};
+        std::unordered_map<std::string, std::size_t> bound {};
+
+        auto binder = [](const Term& node) -> const std::string&
+        {
+            if (auto abstr = std::get_if<Abstraction>(&node))
+                return abstr->name.name;
+            if (auto let = std::get_if<Let>(&node))
+                return let->name.name;
+            return std::get<Letrec>(node).name.name;
+        };
+        auto captured = [&bound](const Term& replacement) -> bool
+        {
+            for (const std::string& name : free_variables(replacement))
+            {
+                auto search {bound.find(name)};
+                if (search != bound.end() && search->second > 0)
+                    return true;
+            }
+            return false;
+        };
 
-        Substitutor() = delete;
-        Substitutor(Substitution sub) : sub {std::move(sub)} {}
+        while (!pending.empty())
+        {
+            auto [next, step] {pending.back()};
+            pending.pop_back();
+            if (step == Step::Enter)
+            {
+                ++bound[binder(*next)];
+                continue;
+            }
 
-        auto operator ()(Variable var)      -> Term;
-        auto operator ()(Abstraction abstr) -> Term;
-        auto operator ()(Application appl)  -> Term;
+            if (step == Step::Build)
+            {
+                Term last {std::move(results.back())};
+                results.pop_back();
+                if (std::holds_alternative<Application>(*next))
+                {
+                    Term first {std::move(results.back())};
+                    results.back() = Application {make_term(std::move(first)), make_term(std::move(last))};
+                    continue;
+                }
 
-    private:
-        Substitution sub;
-    };
+                --bound[binder(*next)];
+                if (auto abstr = std::get_if<Abstraction>(next))
+                {
+                    results.push_back(Abstraction {abstr->name, make_term(std::move(last))});
+                    continue;
+                }
+                Term first {std::move(results.back())};
+                if (auto let = std::get_if<Let>(next))
+                    results.back() = Let {let->name, make_term(std::move(first)), make_term(std::move(last))};
+                else
+                    results.back() = Letrec {std::get<Letrec>(*next).name, make_term(std::move(first)),
+                                             make_term(std::move(last))};
+                continue;
+            }
 
-    auto Substitutor::operator()(Variable var) -> Term
-    {
-        if (var.name == sub.first)
-            return sub.second;
+            // a replacement whose free variables a binder around it would
+            // capture means something else here, so it is left alone
+            std::optional<Term> replaced {replace(*next)};
+            if (replaced.has_value() && !bound.empty() && captured(replaced.value()))
+                replaced.reset();
 
-        return var;
+            if (replaced.has_value())
+            {
+                results.push_back(std::move(replaced.value()));
+            }
+            else if (auto abstr = std::get_if<Abstraction>(next))
+            {
+                pending.emplace_back(next, Step::Build);
+                pending.emplace_back(&*abstr->body, Step::Visit);
+                pending.emplace_back(next, Step::Enter);
+            }
+            else if (auto appl = std::get_if<Application>(next))
+            {
+                pending.emplace_back(next, Step::Build);
+                pending.emplace_back(&*appl->rhs, Step::Visit);
+                pending.emplace_back(&*appl->lhs, Step::Visit);
+            }
+            else if (auto let = std::get_if<Let>(next))
+            {
+                // the let binds its name in the body only
+                pending.emplace_back(next, Step::Build);
+                pending.emplace_back(&*let->body, Step::Visit);
+                pending.emplace_back(next, Step::Enter);
+                pending.emplace_back(&*let->definition, Step::Visit);
+            }
+            else if (auto letrec = std::get_if<Letrec>(next))
+            {
+                // the letrec binds its name in both the definition and the body
+                pending.emplace_back(next, Step::Build);
+                pending.emplace_back(&*letrec->body, Step::Visit);
+                pending.emplace_back(&*letrec->definition, Step::Visit);
+                pending.emplace_back(next, Step::Enter);
+            }
+            else
+            {
+                results.push_back(*next);
+            }
+        }
+        return std::move(results.back());
     }
 
-    auto Substitutor::operator()(Abstraction abstr) -> Term
+    auto compare(const Term& lhs, const Term& rhs) -> bool
     {
-        // if name conflict, rename bound variable terms and call again
-        if (abstr.name.name == sub.first)
+        std::vector<std::pair<const Term*, const Term*>> pending {{&lhs, &rhs}};
+        while (!pending.empty())
         {
-            std::string new_name {rename(abstr.name.name)};
-            Substitution sub2 {abstr.name.name, Variable {new_name}};
-            return substitute(sub, Abstraction {new_name, substitute(sub2, *abstr.body)});
+            auto [l, r] {pending.back()};
+            pending.pop_back();
+
+            // a shared subterm is equal to itself
+            if (l == r)
+                continue;
+            if (l->index() != r->index())
+                return false;
+
+            if (auto l_var = std::get_if<Variable>(l))
+            {
+                if (!(*l_var == std::get<Variable>(*r)))
+                    return false;
+            }
+            else if (auto l_numeral = std::get_if<Numeral>(l))
+            {
+                if (!(*l_numeral == std::get<Numeral>(*r)))
+                    return false;
+            }
+            else if (auto l_abstr = std::get_if<Abstraction>(l))
+            {
+                const Abstraction& r_abstr {std::get<Abstraction>(*r)};
+                if (!(l_abstr->name == r_abstr.name))
+                    return false;
+                pending.emplace_back(&*l_abstr->body, &*r_abstr.body);
+            }
+            else if (auto l_appl = std::get_if<Application>(l))
+            {
+                const Application& r_appl {std::get<Application>(*r)};
+                pending.emplace_back(&*l_appl->rhs, &*r_appl.rhs);
+                pending.emplace_back(&*l_appl->lhs, &*r_appl.lhs);
+            }
+            else if (auto l_let = std::get_if<Let>(l))
+            {
+                const Let& r_let {std::get<Let>(*r)};
+                if (!(l_let->name == r_let.name))
+                    return false;
+                pending.emplace_back(&*l_let->body, &*r_let.body);
+                pending.emplace_back(&*l_let->definition, &*r_let.definition);
+            }
+            else
+            {
+                const Letrec& l_letrec {std::get<Letrec>(*l)};
+                const Letrec& r_letrec {std::get<Letrec>(*r)};
+                if (!(l_letrec.name == r_letrec.name))
+                    return false;
+                pending.emplace_back(&*l_letrec.body, &*r_letrec.body);
+                pending.emplace_back(&*l_letrec.definition, &*r_letrec.definition);
+            }
         }
-        return Abstraction {abstr.name, substitute(sub, *abstr.body)};
+        return true;
     }
 
-    auto Substitutor::operator()(Application appl) -> Term
+    auto Application::operator ==(const Application& other) const -> bool
     {
-        // sub each side
-        return Application {substitute(sub, *appl.lhs), substitute(sub, *appl.rhs)};
+        return compare(*lhs, *other.lhs) && compare(*rhs, *other.rhs);
     }
 
-    auto substitute(Substitution sub, const Term& term) -> Term
+    auto Abstraction::operator ==(const Abstraction& other) const -> bool
     {
-        return std::visit(Substitutor(std::move(sub)), term);
+        return name == other.name && compare(*body, *other.body);
     }
 
-    auto compare(const Term& lhs, const Term& rhs) -> bool
+    auto Let::operator ==(const Let& other) const -> bool
     {
-        auto lhs_as_var {std::get_if<Variable>(&lhs)};
-        auto rhs_as_var {std::get_if<Variable>(&rhs)};
-        if (lhs_as_var && rhs_as_var)
-            return *lhs_as_var == *rhs_as_var;
-
-        auto lhs_as_abstr {std::get_if<Abstraction>(&lhs)};
-        auto rhs_as_abstr {std::get_if<Abstraction>(&rhs)};
-        if (lhs_as_abstr && rhs_as_abstr)
-            return *lhs_as_abstr == *rhs_as_abstr;
-
-        auto lhs_as_appl {std::get_if<Application>(&lhs)};
-        auto rhs_as_appl {std::get_if<Application>(&rhs)};
-        if (lhs_as_appl && rhs_as_appl)
-            return *lhs_as_appl == *rhs_as_appl;
-
-        return false;
+        return name == other.name && compare(*definition, *other.definition) && compare(*body, *other.body);
     }
 
-    auto Application::operator ==(const Application& other) const -> bool
+    auto Letrec::operator ==(const Letrec& other) const -> bool
     {
-        return compare(*lhs, *other.lhs) && compare(*rhs, *other.rhs);
+        return name == other.name && compare(*definition, *other.definition) && compare(*body, *other.body);
     }
 
     auto parse_string(std::string str) -> std::optional<Term>
@@ -282,21 +786,15 @@ namespace lambda
         std::stringstream stream {str};
         auto lex_result {read(stream)};
         std::queue<Token> tokens;
-        for (auto token : lex_result)
+        for (auto& token : lex_result)
         {
-            tokens.push(token);
+            tokens.push(std::move(token));
         }
-        auto parse_result {parse(tokens)};
-        Term* term {parse_result.get_ok()};
-        if (term) return *term;
+        auto parse_result {parse(std::move(tokens))};
+        if (parse_result.is_ok()) return std::move(parse_result).take_ok();
         return {};
     }
 
-    auto with_name(const std::string& name) -> std::function<std::pair<std::string, Term>(Term)>
-    {
-        return [name](const Term& t) -> std::pair<std::string, Term> { return {name, t}; };
-    }
-
     auto parse_line(std::string line) -> lang_tools::ParseResult<std::pair<std::string, Term>>
     {
         std::stringstream stream {line};
@@ -310,8 +808,7 @@ namespace lambda
             err_msg << "Expected =, got " << assignment;
             return lang_tools::ParseResult<std::pair<std::string, Term>>::make_err(err_msg.str());
         }
-        std::function<ParseErr(std::queue<lang_tools::LexErr>)> to_parse_err =
-            [](std::queue<lang_tools::LexErr> errs) -> ParseErr
+        auto to_parse_err = [](std::queue<lang_tools::LexErr> errs) -> ParseErr
             {
                 std::stringstream err_msg {"Lex errors: "};
                 while (!errs.empty())
@@ -321,25 +818,22 @@ namespace lambda
                 }
                 return err_msg.str();
             };
+        auto with_name = [&name](Term&& term) -> std::pair<std::string, Term>
+            {
+                return {std::move(name), std::move(term)};
+            };
         return lex_all(stream)
-                .map_err<ParseErr>(to_parse_err)
-                .and_then<Term>(parse)
-                .map_ok<std::pair<std::string, Term>>(with_name(name));
+                .map_err(to_parse_err)
+                .and_then(parse)
+                .map_ok(with_name);
     }
 
     auto parse_file(std::fstream& file) -> lang_tools::ParseResult<lang_tools::Context<Term>>
     {
-        lang_tools::Context<Term> context {};
-        std::string buffer {};
-        while (std::getline(file, buffer))
-        {
-            auto parse_result {parse_line(buffer)};
-            Substitution* as_sub {parse_result.get_ok()};
-            if (as_sub == nullptr)
-                return lang_tools::ParseResult<lang_tools::Context<Term>>::make_err(*parse_result.get_err());
-            else
-                context.insert(*as_sub);
-        }
-        return lang_tools::ParseResult<lang_tools::Context<Term>>::make_ok(context);
+        std::string source {std::istreambuf_iterator<char> {file}, std::istreambuf_iterator<char> {}};
+        LoadResult loaded {load_definitions(source)};
+        if (loaded.errors.empty())
+            return lang_tools::ParseResult<lang_tools::Context<Term>>::make_ok(std::move(loaded.context));
+        return lang_tools::ParseResult<lang_tools::Context<Term>>::make_err(as_string(loaded.errors));
     }
-}
\ No newline at end of file
+}
@@ -6,14 +6,19 @@
 #define LAMBDA_PARSE_H
 
 #include <fstream>
+#include <functional>
 #include <queue>
 #include <string>
 #include <memory>
+#include <optional>
+#include <unordered_set>
 #include <utility>
 
 #include "lang_tools/parse/parse.hpp"
 #include "lang_tools/eval/eval.hpp"
+#include "instrument.h"
 #include "lex.h"
+#include "natural.h"
 #include "result/Result.hpp"
 
 namespace lambda
@@ -21,12 +26,38 @@ namespace lambda
     struct Variable;
     struct Application;
     struct Abstraction;
+    struct Let;
+    struct Letrec;
 
-    using Term = std::variant<Variable, Application, Abstraction>;
+    /**
+     * The Church numeral \s.\z. s (... (s z)) with the given number of s,
+     * kept as its value until something looks inside it. See numerals.h.
+     */
+    struct Numeral {
+        Natural value;
+
+        auto operator ==(const Numeral& other) const -> bool
+        {
+            return value == other.value;
+        }
+    };
+
+    using Term = std::variant<Variable, Application, Abstraction, Numeral, Let, Letrec>;
     using term_ptr = std::shared_ptr<Term>;
 
     auto compare(const Term& lhs, const Term& rhs) -> bool;
 
+    // allocates a term node through the accounting allocator
+    template <typename ...Args>
+    auto make_term(Args&& ...args) -> term_ptr;
+
+    /**
+     * Drops a node's reference to a subterm. The last reference to a
+     * subterm is queued rather than dropped on the spot, so that tearing
+     * down a deep term takes a loop instead of a destructor call per level.
+     */
+    auto release_subterm(term_ptr&& subterm) noexcept -> void;
+
     struct Variable {
         Variable(const char* name) : name {name} {}
         Variable(std::string name) : name {std::move(name)} {}
@@ -38,10 +69,16 @@ namespace lambda
         }
     };
 
+    // nodes can be built from copies, moved terms, or shared existing subterms
     struct Application {
-        Application(const Term& lhs, const Term& rhs)
-            : lhs {std::make_shared<Term>(lhs)}
-            , rhs {std::make_shared<Term>(rhs)} {}
+        Application(const Term& lhs, const Term& rhs);
+        Application(Term&& lhs, Term&& rhs);
+        Application(term_ptr lhs, term_ptr rhs);
+        Application(const Application&) = default;
+        Application(Application&&) noexcept = default;
+        ~Application();
+        auto operator =(const Application&) -> Application& = default;
+        auto operator =(Application&&) noexcept -> Application& = default;
         term_ptr lhs;
         term_ptr rhs;
 
@@ -50,19 +87,115 @@ namespace lambda
     };
 
     struct Abstraction {
-        Abstraction(Variable name, const Term& body)
-            : name {std::move(name)}, body {std::make_shared<Term>(body)} {}
-        Abstraction(Variable name, Term&& body)
-            : name {std::move(name)}, body {std::make_shared<Term>(body)} {}
+        Abstraction(Variable name, const Term& body);
+        Abstraction(Variable name, Term&& body);
+        Abstraction(Variable name, term_ptr body);
+        Abstraction(const Abstraction&) = default;
+        Abstraction(Abstraction&&) noexcept = default;
+        ~Abstraction();
+        auto operator =(const Abstraction&) -> Abstraction& = default;
+        auto operator =(Abstraction&&) noexcept -> Abstraction& = default;
         Variable name;
         term_ptr body;
 
-        auto operator ==(const Abstraction& other) const -> bool
-        {
-            return name == other.name && compare(*body, *other.body);
-        }
+        auto operator ==(const Abstraction& other) const -> bool;
     };
 
+    /**
+     * let name = definition in body, where the name is bound only in the
+     * body. Unlike (\name. body) definition, the definition is reduced at
+     * most once however many times the body uses it.
+     */
+    struct Let {
+        Let(Variable name, term_ptr definition, term_ptr body);
+        Let(const Let&) = default;
+        Let(Let&&) noexcept = default;
+        ~Let();
+        auto operator =(const Let&) -> Let& = default;
+        auto operator =(Let&&) noexcept -> Let& = default;
+        Variable name;
+        term_ptr definition;
+        term_ptr body;
+
+        auto operator ==(const Let& other) const -> bool;
+    };
+
+    /**
+     * letrec name = definition in body, where the name is bound in both the
+     * definition and the body. The reducers move letrecs out into the
+     * definitions they look names up in, so that recursion goes through the
+     * name rather than copying the definition; see letrec.h.
+     */
+    struct Letrec {
+        Letrec(Variable name, term_ptr definition, term_ptr body);
+        Letrec(const Letrec&) = default;
+        Letrec(Letrec&&) noexcept = default;
+        ~Letrec();
+        auto operator =(const Letrec&) -> Letrec& = default;
+        auto operator =(Letrec&&) noexcept -> Letrec& = default;
+        Variable name;
+        term_ptr definition;
+        term_ptr body;
+
+        auto operator ==(const Letrec& other) const -> bool;
+    };
+
+    template <typename ...Args>
+    auto make_term(Args&& ...args) -> term_ptr
+    {
+        return std::allocate_shared<Term>(instrument::Allocator<Term> {}, std::forward<Args>(args)...);
+    }
+
+    // node constructors need the complete Term to allocate through make_term
+    inline Application::Application(const Term& lhs, const Term& rhs)
+        : lhs {make_term(lhs)}
+        , rhs {make_term(rhs)} {}
+
+    inline Application::Application(Term&& lhs, Term&& rhs)
+        : lhs {make_term(std::move(lhs))}
+        , rhs {make_term(std::move(rhs))} {}
+
+    inline Application::Application(term_ptr lhs, term_ptr rhs)
+        : lhs {std::move(lhs)}
+        , rhs {std::move(rhs)} {}
+
+    inline Abstraction::Abstraction(Variable name, const Term& body)
+        : name {std::move(name)}, body {make_term(body)} {}
+
+    inline Abstraction::Abstraction(Variable name, Term&& body)
+        : name {std::move(name)}, body {make_term(std::move(body))} {}
+
+    inline Abstraction::Abstraction(Variable name, term_ptr body)
+        : name {std::move(name)}, body {std::move(body)} {}
+
+    inline Let::Let(Variable name, term_ptr definition, term_ptr body)
+        : name {std::move(name)}, definition {std::move(definition)}, body {std::move(body)} {}
+
+    inline Letrec::Letrec(Variable name, term_ptr definition, term_ptr body)
+        : name {std::move(name)}, definition {std::move(definition)}, body {std::move(body)} {}
+
+    inline Application::~Application()
+    {
+        release_subterm(std::move(lhs));
+        release_subterm(std::move(rhs));
+    }
+
+    inline Abstraction::~Abstraction()
+    {
+        release_subterm(std::move(body));
+    }
+
+    inline Let::~Let()
+    {
+        release_subterm(std::move(definition));
+        release_subterm(std::move(body));
+    }
+
+    inline Letrec::~Letrec()
+    {
+        release_subterm(std::move(definition));
+        release_subterm(std::move(body));
+    }
 
     using Substitution = std::pair<std::string, Term>;
     using lang_tools::ParseErr;
@@ -71,14 +204,38 @@ namespace lambda
 
     auto parse(std::queue<Token> tokens) -> ParseResult;
 
+    // capture-avoiding: bound variables that clash with the replacement's
+    // free variables are renamed. Subterms without a free occurrence of the
+    // name are shared with the input rather than copied
     auto substitute(Substitution sub, const Term& term) -> Term;
 
+    auto is_free(const std::string& name, const Term& term) -> bool;
+
+    // the first of base, then base followed by a, b, ..., z, aa, ab, ...,
+    // that isn't taken. It is made of letters only, so it lexes back
+    auto fresh_name(const std::string& base, const std::function<bool(const std::string&)>& taken) -> std::string;
+    auto free_variables(const Term& term) -> std::unordered_set<std::string>;
+
+    /**
+     * Rebuilds a term through its abstractions, applications, lets and
+     * letrecs, putting in place of each subterm whatever replace gives for
+     * it, if anything. Replaced subterms aren't walked into. A replacement
+     * is dropped if a binder around the subterm would capture one of its
+     * free variables. The walk keeps its own stack, so terms can nest as
+     * deeply as memory allows.
+     */
+    auto replace_subterms(const Term& term, const std::function<std::optional<Term>(const Term&)>& replace) -> Term;
+
     auto as_string(const Term& term) -> std::string;
 
     auto operator <<(std::ostream& out, const Term& term) -> std::ostream&;
 
     auto parse_string(std::string str) -> std::optional<Term>;
 
+    // parses a single `name = term` definition
+    auto parse_line(std::string line) -> lang_tools::ParseResult<std::pair<std::string, Term>>;
+
+    // reports every error in the file, see load_definitions
     auto parse_file(std::fstream& file) -> lang_tools::ParseResult<lang_tools::Context<Term>>;
 }
 
@@ -2,10 +2,12 @@
 // Created by colin on 6/6/20.
 //
 
+#include "loader.h"
 #include "prelude.h"
 
 #include <filesystem>
 #include <fstream>
+#include <iostream>
 #include <string>
 #include <utility>
 
@@ -16,11 +18,33 @@ namespace lambda
         return parse_string(std::move(term_str)).value();
     }
 
+    namespace
+    {
+        // a function rather than a global, since the prelude may be loaded during static initialisation
+        auto prelude_path() -> std::filesystem::path
+        {
+            return "../data/prelude.lam";
+        }
+    }
+
     auto get_prelude() -> lang_tools::Context<Term>
     {
-        std::filesystem::path prelude_path {"../data/prelude.lam"};
-        std::fstream file {prelude_path};
-        auto context {*parse_file(file).get_ok()};
-        return context;
+        LoadResult loaded {load_file(prelude_path())};
+
+        // keep whatever did load, but don't hide what didn't
+        if (!loaded.errors.empty())
+            std::cerr << "errors loading prelude:" << std::endl << as_string(loaded.errors);
+        return std::move(loaded.context);
+    }
+
+    auto get_prelude_library() -> Library
+    {
+        Library library {Library::from_file(prelude_path())};
+
+        // only shape errors are known up front; parse errors show up as undefined names
+        std::vector<LoadError> errors {library.errors()};
+        if (!errors.empty())
+            std::cerr << "errors loading prelude:" << std::endl << as_string(errors);
+        return library;
     }
-}
\ No newline at end of file
+}
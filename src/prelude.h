@@ -12,6 +12,7 @@
 
 #include "lang_tools/eval/eval.hpp"
 
+#include "library.h"
 #include "parse.h"
 #include "helpers.h"
 
@@ -19,6 +20,9 @@ namespace lambda
 {
     auto get_prelude() -> lang_tools::Context<Term>;
 
+    // the same definitions, parsed on first use
+    auto get_prelude_library() -> Library;
+
 
 }
 
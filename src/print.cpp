@@ -0,0 +1,512 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "instrument.h"
+#include "print.h"
+
+namespace lambda
+{
+    namespace
+    {
+        /**
+         * Either a term still to be written or a fixed piece of text (a space
+         * or closing paren) that follows one.
+         */
+        struct Frame
+        {
+            const Term* term;
+            std::size_t depth;
+            bool parens;
+            std::string_view text;
+        };
+
+        class Writer
+        {
+        public:
+            Writer(std::ostream& out, std::size_t max_length) : out {out}, remaining {max_length} {}
+
+            auto write(std::string_view text) -> bool
+            {
+                if (text.size() > remaining)
+                {
+                    out << text.substr(0, remaining) << "...";
+                    remaining = 0;
+                    return false;
+                }
+                out << text;
+                remaining -= text.size();
+                return true;
+            }
+
+        private:
+            std::ostream& out;
+            std::size_t remaining;
+        };
+
+        constexpr std::size_t none {std::numeric_limits<std::size_t>::max()};
+
+        // where a free variable of a subterm is bound, besides binder nodes
+        constexpr std::size_t unseen {none - 2};
+        constexpr std::size_t outside {none - 1};
+        constexpr std::size_t ambiguous {none};
+
+        /**
+         * The term as a graph with one node per distinct subterm, so that
+         * equal subterms share a node whether or not they were the same
+         * node to begin with. Building it visits each node of the input once,
+         * so it takes time in the size of the graph rather than of the tree
+         * it stands for.
+         */
+        class Sharing
+        {
+        public:
+            Sharing(const Term& term, std::size_t min_size);
+
+            // the term with the subterms worth sharing bound by lets
+            auto result() const -> Term;
+
+        private:
+            struct Node
+            {
+                const Term* term;
+
+                // lhs and rhs, definition and body, or just the body
+                std::size_t children[2] {none, none};
+
+                // edges into the node from other nodes
+                std::size_t uses {0};
+
+                // as a tree, saturating
+                std::size_t size {1};
+
+                // free variables, sorted, with the node binding each one on
+                // every path here, if it is always the same
+                std::vector<std::string> free {};
+                std::vector<std::size_t> binders {};
+
+                // the let's name, if the node is shared
+                std::string name {};
+            };
+
+            struct Key
+            {
+                std::size_t kind;
+                std::string name;
+                std::size_t lhs;
+                std::size_t rhs;
+
+                auto operator ==(const Key& other) const -> bool
+                {
+                    return kind == other.kind && name == other.name && lhs == other.lhs && rhs == other.rhs;
+                }
+            };
+
+            struct KeyHash
+            {
+                auto operator ()(const Key& key) const -> std::size_t
+                {
+                    std::size_t seed {std::hash<std::string> {}(key.name) ^ key.kind};
+                    for (std::size_t value : {key.lhs, key.rhs})
+                        seed ^= value + 0x9e3779b9u + (seed << 6u) + (seed >> 2u);
+                    return seed;
+                }
+            };
+
+            std::vector<Node> nodes {};
+            std::size_t root {none};
+
+            // the shared nodes bound at the start of each binder's body, or of
+            // the whole term, innermost last
+            std::unordered_map<std::size_t, std::vector<std::size_t>> lets {};
+
+            auto add(const Term& term) -> void;
+            auto bind(std::size_t parent, std::size_t slot, Node& child) const -> void;
+            auto scope(const Node& node) const -> std::size_t;
+            auto binds(std::size_t binder, std::size_t slot, const std::string& name) const -> bool;
+            auto name_shared(std::size_t min_size) -> void;
+        };
+
+        auto children_of(const Term& term) -> std::vector<const Term*>
+        {
+            if (auto abstr = std::get_if<Abstraction>(&term))
+                return {abstr->body.get()};
+            if (auto appl = std::get_if<Application>(&term))
+                return {appl->lhs.get(), appl->rhs.get()};
+            if (auto let = std::get_if<Let>(&term))
+                return {let->definition.get(), let->body.get()};
+            if (auto letrec = std::get_if<Letrec>(&term))
+                return {letrec->definition.get(), letrec->body.get()};
+            return {};
+        }
+
+        // the variable, binder or numeral a node carries, if any
+        auto label_of(const Term& term) -> std::string
+        {
+            if (auto var = std::get_if<Variable>(&term))
+                return var->name;
+            if (auto numeral = std::get_if<Numeral>(&term))
+                return as_string(numeral->value);
+            if (auto abstr = std::get_if<Abstraction>(&term))
+                return abstr->name.name;
+            if (auto let = std::get_if<Let>(&term))
+                return let->name.name;
+            if (auto letrec = std::get_if<Letrec>(&term))
+                return letrec->name.name;
+            return {};
+        }
+
+        auto without(std::vector<std::string> names, const std::string& name) -> std::vector<std::string>
+        {
+            auto search {std::lower_bound(names.begin(), names.end(), name)};
+            if (search != names.end() && *search == name)
+                names.erase(search);
+            return names;
+        }
+
+        auto merged(const std::vector<std::string>& lhs, const std::vector<std::string>& rhs)
+            -> std::vector<std::string>
+        {
+            std::vector<std::string> names {};
+            std::set_union(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(names));
+            return names;
+        }
+
+        auto index_of(const std::vector<std::string>& names, const std::string& name) -> std::size_t
+        {
+            return std::lower_bound(names.begin(), names.end(), name) - names.begin();
+        }
+
+        Sharing::Sharing(const Term& term, std::size_t min_size)
+        {
+            add(term);
+
+            // parents are added after their children, so going backwards
+            // every path into a node has been seen before the node is
+            Node& top {nodes[root]};
+            top.binders.assign(top.free.size(), outside);
+            for (std::size_t parent {nodes.size()}; parent-- > 0;)
+            {
+                for (std::size_t slot {0}; slot < 2 && nodes[parent].children[slot] != none; ++slot)
+                    bind(parent, slot, nodes[nodes[parent].children[slot]]);
+            }
+
+            name_shared(min_size);
+        }
+
+        auto Sharing::add(const Term& term) -> void
+        {
+            std::unordered_map<const Term*, std::size_t> seen {};
+            std::unordered_map<Key, std::size_t, KeyHash> table {};
+
+            // terms can be deep, so this keeps its own stack
+            std::vector<std::pair<const Term*, bool>> stack {{&term, false}};
+            while (!stack.empty())
+            {
+                auto [next, expanded] {stack.back()};
+                stack.pop_back();
+                if (seen.count(next) > 0)
+                    continue;
+
+                std::vector<const Term*> children {children_of(*next)};
+                if (!expanded)
+                {
+                    stack.emplace_back(next, true);
+                    for (const Term* child : children)
+                        stack.emplace_back(child, false);
+                    continue;
+                }
+
+                Key key {next->index(), label_of(*next), none, none};
+                if (!children.empty())
+                    key.lhs = seen.at(children[0]);
+                if (children.size() > 1)
+                    key.rhs = seen.at(children[1]);
+
+                auto [found, inserted] {table.emplace(key, nodes.size())};
+                seen.emplace(next, found->second);
+                if (!inserted)
+                    continue;
+
+                Node node {next, {key.lhs, key.rhs}};
+                for (std::size_t child : node.children)
+                {
+                    if (child == none)
+                        continue;
+                    ++nodes[child].uses;
+                    node.size = nodes[child].size > none - node.size ? none : node.size + nodes[child].size;
+                }
+
+                if (std::holds_alternative<Variable>(*next))
+                    node.free = {key.name};
+                else if (std::holds_alternative<Abstraction>(*next))
+                    node.free = without(nodes[key.lhs].free, key.name);
+                else if (std::holds_alternative<Application>(*next))
+                    node.free = merged(nodes[key.lhs].free, nodes[key.rhs].free);
+                else if (std::holds_alternative<Let>(*next))
+                    node.free = merged(nodes[key.lhs].free, without(nodes[key.rhs].free, key.name));
+                else if (std::holds_alternative<Letrec>(*next))
+                    node.free = without(merged(nodes[key.lhs].free, nodes[key.rhs].free), key.name);
+                node.binders.assign(node.free.size(), unseen);
+                nodes.push_back(std::move(node));
+            }
+
+            root = seen.at(&term);
+            ++nodes[root].uses;
+        }
+
+        auto Sharing::binds(std::size_t binder, std::size_t slot, const std::string& name) const -> bool
+        {
+            const Term& term {*nodes[binder].term};
+            if (auto abstr = std::get_if<Abstraction>(&term))
+                return abstr->name.name == name;
+            if (auto let = std::get_if<Let>(&term))
+                return slot == 1 && let->name.name == name;
+            if (auto letrec = std::get_if<Letrec>(&term))
+                return letrec->name.name == name;
+            return false;
+        }
+
+        // records, for each free variable of the child, what binds it along this edge
+        auto Sharing::bind(std::size_t parent, std::size_t slot, Node& child) const -> void
+        {
+            const Node& from {nodes[parent]};
+            for (std::size_t i {0}; i < child.free.size(); ++i)
+            {
+                const std::string& name {child.free[i]};
+                std::size_t binder {binds(parent, slot, name) ? parent : from.binders[index_of(from.free, name)]};
+                if (child.binders[i] == unseen)
+                    child.binders[i] = binder;
+                else if (child.binders[i] != binder)
+                    child.binders[i] = ambiguous;
+            }
+        }
+
+        /**
+         * The innermost binder of any of the node's free variables, which is
+         * where a let for it has to go, or ambiguous if different paths to
+         * the node disagree about what binds them.
+         */
+        auto Sharing::scope(const Node& node) const -> std::size_t
+        {
+            for (std::size_t binder : node.binders)
+            {
+                if (binder == ambiguous || binder == unseen)
+                    return ambiguous;
+            }
+
+            // an outer binder's variable is still free inside an inner one
+            auto innermost = [this, &node](std::size_t binder) -> bool
+            {
+                for (std::size_t i {0}; i < node.free.size(); ++i)
+                {
+                    std::size_t other {node.binders[i]};
+                    const std::vector<std::string>& free {nodes[binder].free};
+                    if (other != outside && other != binder
+                        && !std::binary_search(free.begin(), free.end(), node.free[i]))
+                        return false;
+                }
+                return true;
+            };
+
+            for (std::size_t binder : node.binders)
+            {
+                if (binder == outside || !innermost(binder))
+                    continue;
+
+                // a letrec's definition is inside its scope too, so no let can go before it
+                if (std::holds_alternative<Letrec>(*nodes[binder].term))
+                    return ambiguous;
+                return binder;
+            }
+            return outside;
+        }
+
+        auto Sharing::name_shared(std::size_t min_size) -> void
+        {
+            std::unordered_set<std::string> taken {"let", "letrec", "in"};
+            for (const Node& node : nodes)
+            {
+                std::string label {label_of(*node.term)};
+                if (!label.empty())
+                    taken.insert(std::move(label));
+            }
+
+            // a, b, ..., z, aa, ab, ..., skipping names the term uses
+            std::size_t count {0};
+            auto fresh = [&taken, &count]() -> std::string
+            {
+                std::string name {};
+                do
+                {
+                    name.clear();
+                    for (std::size_t n {++count}; n > 0; n = (n - 1) / 26)
+                        name.insert(name.begin(), static_cast<char>('a' + (n - 1) % 26));
+                } while (taken.count(name) > 0);
+                return name;
+            };
+
+            // children come first, so a let only uses the lets before it
+            for (std::size_t id {0}; id < nodes.size(); ++id)
+            {
+                Node& node {nodes[id]};
+                if (node.uses < 2 || node.size < min_size)
+                    continue;
+                std::size_t where {scope(node)};
+                if (where == ambiguous)
+                    continue;
+                node.name = fresh();
+                lets[where].push_back(id);
+            }
+        }
+
+        auto Sharing::result() const -> Term
+        {
+            std::vector<term_ptr> built(nodes.size());
+            auto use = [this, &built](std::size_t id) -> term_ptr
+            {
+                if (nodes[id].name.empty())
+                    return built[id];
+                return make_term(Variable {nodes[id].name});
+            };
+            auto with_lets = [this, &built](std::size_t where, term_ptr body) -> term_ptr
+            {
+                auto search {lets.find(where)};
+                if (search == lets.end())
+                    return body;
+                for (auto it {search->second.rbegin()}; it != search->second.rend(); ++it)
+                    body = make_term(Let {Variable {nodes[*it].name}, built[*it], std::move(body)});
+                return body;
+            };
+
+            for (std::size_t id {0}; id < nodes.size(); ++id)
+            {
+                const Node& node {nodes[id]};
+                const Term& term {*node.term};
+                if (auto abstr = std::get_if<Abstraction>(&term))
+                    built[id] = make_term(Abstraction {abstr->name, with_lets(id, use(node.children[0]))});
+                else if (std::holds_alternative<Application>(term))
+                    built[id] = make_term(Application {use(node.children[0]), use(node.children[1])});
+                else if (auto let = std::get_if<Let>(&term))
+                    built[id] = make_term(Let {let->name, use(node.children[0]), with_lets(id, use(node.children[1]))});
+                else if (auto letrec = std::get_if<Letrec>(&term))
+                    built[id] = make_term(Letrec {letrec->name, use(node.children[0]), use(node.children[1])});
+                else
+                    built[id] = make_term(term);
+            }
+            return *with_lets(outside, use(root));
+        }
+    }
+
+    auto share_subterms(const Term& term, std::size_t min_size) -> Term
+    {
+        instrument::PhaseScope scope {instrument::Phase::Print};
+        return Sharing {term, min_size}.result();
+    }
+
+    auto print(std::ostream& out, const Term& term, const PrintOptions& options) -> bool
+    {
+        if (options.share)
+        {
+            PrintOptions tree {options};
+            tree.share = false;
+            return print(out, share_subterms(term, options.min_shared_size), tree);
+        }
+
+        instrument::PhaseScope scope {instrument::Phase::Print};
+        Writer writer {out, options.max_length};
+        std::vector<Frame> stack {{&term, 0, false, {}}};
+
+        while (!stack.empty())
+        {
+            Frame frame {stack.back()};
+            stack.pop_back();
+
+            if (frame.term == nullptr)
+            {
+                if (!writer.write(frame.text))
+                    return false;
+                continue;
+            }
+
+            if (frame.depth > options.max_depth)
+            {
+                if (!writer.write("..."))
+                    return false;
+                continue;
+            }
+
+            if (auto var = std::get_if<Variable>(frame.term))
+            {
+                if (!writer.write(var->name))
+                    return false;
+                continue;
+            }
+
+            // written as the literal it was parsed from
+            if (auto numeral = std::get_if<Numeral>(frame.term))
+            {
+                if (!writer.write(as_string(numeral->value)))
+                    return false;
+                continue;
+            }
+
+            // frames are popped in reverse order of pushing
+            if (frame.parens)
+            {
+                if (!writer.write("("))
+                    return false;
+                stack.push_back({nullptr, 0, false, ")"});
+            }
+
+            if (auto abstr = std::get_if<Abstraction>(frame.term))
+            {
+                // an abstraction's body extends as far right as possible
+                if (!writer.write("\\") || !writer.write(abstr->name.name) || !writer.write("."))
+                    return false;
+                stack.push_back({abstr->body.get(), frame.depth + 1, false, {}});
+                continue;
+            }
+
+            auto let {std::get_if<Let>(frame.term)};
+            auto letrec {std::get_if<Letrec>(frame.term)};
+            if (let || letrec)
+            {
+                // in ends the definition, so only the body needs to be last
+                const Variable& name {let ? let->name : letrec->name};
+                if (!writer.write(let ? "let " : "letrec ") || !writer.write(name.name) || !writer.write(" = "))
+                    return false;
+                stack.push_back({let ? let->body.get() : letrec->body.get(), frame.depth + 1, false, {}});
+                stack.push_back({nullptr, 0, false, " in "});
+                stack.push_back({let ? let->definition.get() : letrec->definition.get(), frame.depth + 1, false, {}});
+                continue;
+            }
+
+            // application is left associative, so only the right side needs
+            // parens around another application; abstractions and lets
+            // extend to the right, so they get parens on either side. The
+            // function side stays at the same depth so a spine counts as one
+            // level.
+            const Application& appl {std::get<Application>(*frame.term)};
+            bool rhs_parens {std::holds_alternative<Application>(*appl.rhs)
+                             || std::holds_alternative<Abstraction>(*appl.rhs)
+                             || std::holds_alternative<Let>(*appl.rhs)
+                             || std::holds_alternative<Letrec>(*appl.rhs)};
+            bool lhs_parens {std::holds_alternative<Abstraction>(*appl.lhs)
+                             || std::holds_alternative<Let>(*appl.lhs)
+                             || std::holds_alternative<Letrec>(*appl.lhs)};
+            stack.push_back({appl.rhs.get(), frame.depth + 1, rhs_parens, {}});
+            stack.push_back({nullptr, 0, false, " "});
+            stack.push_back({appl.lhs.get(), frame.depth, lhs_parens, {}});
+        }
+        return true;
+    }
+}
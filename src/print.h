@@ -0,0 +1,57 @@
+//
+// Created by colin on 10/19/26.
+//
+
+/**
+ * Writing terms to a stream. Output uses the fewest parentheses the parser
+ * needs to read it back, and can be cut short for very large terms, or
+ * written with repeated subterms bound once by lets.
+ */
+
+#ifndef LAMBDA_PRINT_H
+#define LAMBDA_PRINT_H
+
+#include <cstddef>
+#include <iostream>
+#include <limits>
+
+#include "parse.h"
+
+namespace lambda
+{
+    struct PrintOptions
+    {
+        // arguments and abstraction bodies nested deeper than this are
+        // written as "..."
+        std::size_t max_depth {std::numeric_limits<std::size_t>::max()};
+
+        // output stops with "..." once this many characters are written
+        std::size_t max_length {std::numeric_limits<std::size_t>::max()};
+
+        // write subterms that occur more than once, and have at least
+        // min_shared_size nodes, once each as a let; see share_subterms
+        bool share {false};
+        std::size_t min_shared_size {4};
+    };
+
+    /**
+     * The term with each subterm that occurs more than once bound by a let
+     * and referred to by name, whether the occurrences are the same node or
+     * only equal. Each let goes just inside the innermost binder of its
+     * free variables; subterms whose variables are bound by different
+     * binders at different occurrences stay as they are. Takes time in the
+     * number of distinct nodes, so terms that are exponentially large as
+     * trees can still be written.
+     */
+    auto share_subterms(const Term& term, std::size_t min_size = 4) -> Term;
+
+    /**
+     * Writes the term straight to the stream without building intermediate
+     * strings. Uses an explicit stack, so deep terms do not recurse.
+     *
+     * @return  false if the output was truncated.
+     */
+    auto print(std::ostream& out, const Term& term, const PrintOptions& options = {}) -> bool;
+}
+
+#endif //LAMBDA_PRINT_H
@@ -0,0 +1,479 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "async.h"
+#include "print.h"
+#include "server.h"
+#include "simplify.h"
+
+namespace lambda
+{
+    namespace
+    {
+        auto system_error(const std::string& what) -> std::runtime_error
+        {
+            return std::runtime_error(what + ": " + std::strerror(errno));
+        }
+
+        auto send_all(int connection, const std::string& text) -> bool
+        {
+            std::size_t sent {0};
+            while (sent < text.size())
+            {
+                ssize_t n {::send(connection, text.data() + sent, text.size() - sent, MSG_NOSIGNAL)};
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    return false;
+                sent += static_cast<std::size_t>(n);
+            }
+            return true;
+        }
+
+        // how often a running evaluation looks for a client hanging up
+        constexpr std::chrono::milliseconds watch_interval {50};
+
+        // true once the peer has closed the connection; a peer that only
+        // shut down its sending side is still waiting for responses
+        auto hung_up(int connection) -> bool
+        {
+            pollfd watched {connection, 0, 0};
+            return ::poll(&watched, 1, 0) > 0 && (watched.revents & (POLLHUP | POLLERR)) != 0;
+        }
+
+        auto parse_strategy(const std::string& value) -> std::optional<Strategy>
+        {
+            if (value == "tree")
+                return Strategy::Tree;
+            if (value == "optimal")
+                return Strategy::Optimal;
+            if (value == "lifted")
+                return Strategy::Lifted;
+            return {};
+        }
+
+        // nothing unless the whole value is a number that fits
+        auto parse_limit(const std::string& value) -> std::optional<std::size_t>
+        {
+            std::size_t limit {0};
+            auto [end, error] {std::from_chars(value.data(), value.data() + value.size(), limit)};
+            if (value.empty() || error != std::errc {} || end != value.data() + value.size())
+                return {};
+            return limit;
+        }
+
+        auto parse_target(const std::string& value) -> std::optional<NormalForm>
+        {
+            if (value == "whnf")
+                return NormalForm::WeakHead;
+            if (value == "head")
+                return NormalForm::Head;
+            if (value == "full")
+                return NormalForm::Full;
+            return {};
+        }
+    }
+
+    Server::Server(const Library& prelude, ServerOptions options)
+        : prelude {prelude}, options {std::move(options)}
+    {
+        if (this->options.threads == 0)
+            this->options.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    Server::~Server()
+    {
+        stop();
+    }
+
+    auto Server::run() -> void
+    {
+        const std::string path {options.socket_path.string()};
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(address.sun_path))
+            throw std::runtime_error("Invalid socket path: " + path);
+        std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+        int fd {::socket(AF_UNIX, SOCK_STREAM, 0)};
+        if (fd < 0)
+            throw system_error("socket");
+
+        // a socket file left behind by an earlier server would block bind
+        ::unlink(path.c_str());
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0
+            || ::listen(fd, SOMAXCONN) < 0)
+        {
+            std::runtime_error error {system_error("bind " + path)};
+            ::close(fd);
+            throw error;
+        }
+
+        int wake_pipe[2];
+        if (::pipe2(wake_pipe, O_NONBLOCK | O_CLOEXEC) < 0)
+        {
+            std::runtime_error error {system_error("pipe")};
+            ::close(fd);
+            throw error;
+        }
+        wake = wake_pipe[1];
+
+        std::vector<std::thread> workers {};
+        for (std::size_t i {0}; i < options.threads; ++i)
+            workers.emplace_back([this]() { worker(); });
+
+        std::vector<pollfd> watched {};
+        while (!stopping)
+        {
+            // a connection is read from only once its earlier requests are
+            // handed out, but it is always watched for hanging up
+            watched.assign({{wake_pipe[0], POLLIN, 0}, {fd, POLLIN, 0}});
+            {
+                std::lock_guard<std::mutex> lock {connections_mutex};
+                for (const auto& [connection, state] : connections)
+                {
+                    if (!state.hung_up)
+                    {
+                        short events {static_cast<short>(state.reading && state.requests.empty() ? POLLIN : 0)};
+                        watched.push_back({connection, events, 0});
+                    }
+                }
+            }
+
+            if (::poll(watched.data(), watched.size(), -1) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+
+            char drained[64];
+            while (::read(wake_pipe[0], drained, sizeof(drained)) > 0)
+            {}
+            if (stopping || (watched[1].revents & (POLLERR | POLLHUP)) != 0)
+                break;
+
+            if ((watched[1].revents & POLLIN) != 0)
+            {
+                int connection {::accept(fd, nullptr, nullptr)};
+                if (connection >= 0)
+                {
+                    std::lock_guard<std::mutex> lock {connections_mutex};
+                    connections.emplace(connection, Connection {});
+                }
+                else if (errno != EINTR && errno != ECONNABORTED && errno != EAGAIN)
+                {
+                    break;
+                }
+            }
+
+            for (std::size_t i {2}; i < watched.size(); ++i)
+            {
+                if (watched[i].revents != 0)
+                    receive(watched[i].fd, watched[i].revents);
+            }
+            dispatch();
+        }
+
+        stopping = true;
+        jobs_ready.notify_all();
+        for (std::thread& thread : workers)
+            thread.join();
+
+        for (const auto& [connection, state] : connections)
+            ::close(connection);
+        connections.clear();
+        jobs = {};
+
+        wake = -1;
+        ::close(wake_pipe[0]);
+        ::close(wake_pipe[1]);
+        ::close(fd);
+        ::unlink(path.c_str());
+    }
+
+    auto Server::stop() -> void
+    {
+        stopping = true;
+        wake_up();
+        jobs_ready.notify_all();
+    }
+
+    auto Server::wake_up() -> void
+    {
+        int fd {wake};
+        char byte {0};
+
+        // a full pipe already wakes the loop, so a failed write is fine
+        if (fd >= 0 && ::write(fd, &byte, 1) < 0)
+            return;
+    }
+
+    auto Server::receive(int connection, short events) -> void
+    {
+        char buffer[4096];
+        ssize_t n {0};
+        if ((events & POLLIN) != 0)
+        {
+            n = ::recv(connection, buffer, sizeof(buffer), 0);
+            if (n < 0 && (errno == EINTR || errno == EAGAIN))
+                return;
+        }
+
+        std::lock_guard<std::mutex> lock {connections_mutex};
+        Connection& state {connections.at(connection)};
+        if ((events & POLLIN) == 0)
+        {
+            // hung up or failed: nothing waiting for it is answered
+            state.hung_up = true;
+            state.reading = false;
+            state.requests.clear();
+            return;
+        }
+        if (n <= 0)
+        {
+            // the client has sent all it will, but may still want responses
+            state.reading = false;
+            return;
+        }
+
+        state.pending.append(buffer, static_cast<std::size_t>(n));
+        std::size_t start {0};
+        std::size_t end;
+        while ((end = state.pending.find('\n', start)) != std::string::npos)
+        {
+            std::string line {state.pending.substr(start, end - start)};
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            state.requests.push_back({std::move(line)});
+            start = end + 1;
+        }
+        state.pending.erase(0, start);
+
+        // there is no telling where a line that is too long ends, so the
+        // connection is answered and closed
+        if (state.pending.size() > options.max_request)
+        {
+            state.requests.push_back({{}, true});
+            state.pending.clear();
+            state.reading = false;
+        }
+    }
+
+    auto Server::dispatch() -> void
+    {
+        std::lock_guard<std::mutex> lock {connections_mutex};
+        for (auto it {connections.begin()}; it != connections.end();)
+        {
+            auto& [connection, state] {*it};
+            if (state.busy)
+            {
+                ++it;
+            }
+            else if (!state.requests.empty())
+            {
+                jobs.emplace(connection, std::move(state.requests.front()));
+                state.requests.pop_front();
+                state.busy = true;
+                jobs_ready.notify_one();
+                ++it;
+            }
+            else if (state.hung_up || !state.reading)
+            {
+                ::close(connection);
+                it = connections.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    auto Server::worker() -> void
+    {
+        while (true)
+        {
+            std::pair<int, Request> job {};
+            {
+                std::unique_lock<std::mutex> lock {connections_mutex};
+                jobs_ready.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (stopping)
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop();
+            }
+
+            auto& [connection, request] {job};
+            std::string response {request.too_long ? "err request too long" : respond(request.line, connection)};
+            bool sent {send_all(connection, response + "\n")};
+            {
+                std::lock_guard<std::mutex> lock {connections_mutex};
+                Connection& state {connections.at(connection)};
+                state.busy = false;
+                if (!sent)
+                {
+                    state.hung_up = true;
+                    state.requests.clear();
+                }
+            }
+            wake_up();
+        }
+    }
+
+    auto Server::handle(const std::string& request) -> std::string
+    {
+        return respond(request, -1);
+    }
+
+    auto Server::respond(const std::string& request, int connection) -> std::string
+    {
+        // a request that fails, even for lack of memory, only fails itself
+        try
+        {
+            return answer(request, connection);
+        }
+        catch (std::exception& e)
+        {
+            return std::string {"err "} + e.what();
+        }
+    }
+
+    auto Server::answer(const std::string& request, int connection) -> std::string
+    {
+        EngineOptions engine_options {options.engine};
+        bool simplify_result {options.simplify};
+
+        // leading @name=value words are options
+        std::size_t start {request.find_first_not_of(' ')};
+        while (start != std::string::npos && request[start] == '@')
+        {
+            std::size_t end {request.find(' ', start)};
+            std::string option {request.substr(start + 1, end == std::string::npos ? end : end - start - 1)};
+            start = end == std::string::npos ? end : request.find_first_not_of(' ', end);
+
+            std::size_t equals {option.find('=')};
+            std::string name {option.substr(0, equals)};
+            std::string value {equals == std::string::npos ? "" : option.substr(equals + 1)};
+            if (name == "strategy" && parse_strategy(value).has_value())
+                engine_options.strategy = parse_strategy(value).value();
+            else if (name == "target" && parse_target(value).has_value())
+                engine_options.target = parse_target(value).value();
+            else if (name == "limit" && parse_limit(value).has_value())
+                engine_options.limit = parse_limit(value).value();
+            else if (name == "simplify" && (value == "on" || value == "off"))
+                simplify_result = value == "on";
+            else
+                return "err unknown option " + option;
+        }
+        if (start == std::string::npos)
+            return "err empty request";
+        std::string expression {request.substr(start)};
+
+        std::stringstream key {};
+        key << as_string(engine_options.strategy) << ' ' << static_cast<int>(engine_options.target)
+            << ' ' << engine_options.limit << ' ' << simplify_result << ' ' << expression;
+        {
+            std::lock_guard<std::mutex> lock {cache_mutex};
+            auto search {cache.find(key.str())};
+            if (search != cache.end())
+                return search->second;
+        }
+
+        std::optional<std::string> response {evaluate(expression, engine_options, simplify_result, connection)};
+        if (!response.has_value())
+            return "err evaluation abandoned";
+        remember(key.str(), response.value());
+        return response.value();
+    }
+
+    auto Server::evaluate(const std::string& expression, const EngineOptions& engine_options, bool simplify_result,
+                          int connection) -> std::optional<std::string>
+    {
+        std::stringstream stream {expression};
+        auto tokens {lex_all(stream)};
+        if (tokens.is_err())
+            return "err lex error: " + tokens.get_err()->front();
+
+        ParseResult parsed {parse(std::move(tokens).take_ok())};
+        if (parsed.is_err())
+            return "err parse error: " + *parsed.get_err();
+        const Term& term {*parsed.get_ok()};
+
+        learn(prelude.load_closure(free_variables(term)));
+        Evaluation evaluation {term, prelude, engine_options};
+        bool abandoned {false};
+        while (!evaluation.wait_for(watch_interval))
+        {
+            if (!abandoned && (stopping || (connection >= 0 && hung_up(connection))))
+            {
+                evaluation.cancel();
+                abandoned = true;
+            }
+        }
+        ReduceResult reduction {evaluation.get()};
+        if (abandoned)
+            return {};
+        if (reduction.is_err())
+            return "err " + *reduction.get_err();
+
+        std::shared_lock<std::shared_mutex> lock {tables_mutex};
+        Term result {simplify_result ? tidy(*reduction.get_ok(), simplifier) : tidy(*reduction.get_ok(), contractions)};
+        lock.unlock();
+
+        std::stringstream response {};
+        response << "ok ";
+        print(response, result);
+        return response.str();
+    }
+
+    auto Server::learn(std::vector<std::string> names) -> void
+    {
+        // in name order, so that what a result is named doesn't depend on hashing
+        std::sort(names.begin(), names.end());
+        std::unique_lock<std::shared_mutex> lock {tables_mutex};
+        for (const std::string& name : names)
+        {
+            if (contractions.contains(name))
+                continue;
+            if (const Term* definition {prelude.find(name)})
+            {
+                contractions.add(name, *definition);
+                simplifier.add(name, *definition);
+            }
+        }
+    }
+
+    auto Server::remember(const std::string& key, const std::string& response) -> void
+    {
+        if (options.cache_size == 0)
+            return;
+
+        std::lock_guard<std::mutex> lock {cache_mutex};
+        if (!cache.emplace(key, response).second)
+            return;
+        cache_order.push_back(key);
+        if (cache_order.size() > options.cache_size)
+        {
+            cache.erase(cache_order.front());
+            cache_order.pop_front();
+        }
+    }
+}
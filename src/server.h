@@ -0,0 +1,159 @@
+//
+// Created by colin on 10/19/26.
+//
+
+/**
+ * Evaluation server listening on a Unix domain socket, so that many clients
+ * can share one process with the prelude and recent results already loaded.
+ *
+ * Each request is a line holding an expression, optionally preceded by
+ * options:
+ *
+ *      @strategy=lifted @limit=100000 times 2 3
+ *
+ * and is answered with a line that is either "ok <result>" or
+ * "err <message>". Options are strategy (tree, optimal, lifted), target
+ * (whnf, head, full), limit and simplify (on, off). A connection can send
+ * any number of requests, which are answered in order. One thread waits on
+ * every connection at once and hands each whole request line to a fixed
+ * pool of workers, so idle clients don't hold a worker. An evaluation is
+ * abandoned if its client hangs up or the server stops.
+ */
+
+#ifndef LAMBDA_SERVER_H
+#define LAMBDA_SERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "engine.h"
+#include "library.h"
+#include "simplify.h"
+
+namespace lambda
+{
+    struct ServerOptions
+    {
+        std::filesystem::path socket_path {};
+
+        // worker threads; 0 means one per hardware thread
+        std::size_t threads {0};
+
+        // responses remembered for repeated requests
+        std::size_t cache_size {1024};
+
+        // a longer request line is answered with an error and its
+        // connection is closed
+        std::size_t max_request {1u << 20u};
+
+        // defaults for requests that don't set their own
+        EngineOptions engine {};
+        bool simplify {false};
+    };
+
+    class Server
+    {
+    public:
+        Server(const Library& prelude, ServerOptions options);
+        ~Server();
+
+        Server(const Server&) = delete;
+        auto operator =(const Server&) -> Server& = delete;
+
+        /**
+         * Accepts connections and reads their requests until stop() is
+         * called. Throws std::runtime_error if the socket can't be set up.
+         */
+        auto run() -> void;
+
+        // safe to call from any thread
+        auto stop() -> void;
+
+        // answers one request line; safe to call from several threads
+        auto handle(const std::string& request) -> std::string;
+
+    private:
+        const Library& prelude;
+        ServerOptions options;
+
+        std::atomic<bool> stopping {false};
+
+        // the write end of the pipe that wakes run() from waiting on sockets
+        std::atomic<int> wake {-1};
+
+        struct Request
+        {
+            std::string line;
+            bool too_long {false};
+        };
+
+        // an open connection; its requests are answered one at a time
+        struct Connection
+        {
+            // text received after the last whole line
+            std::string pending {};
+            std::deque<Request> requests {};
+
+            // one of its requests is with a worker
+            bool busy {false};
+
+            // the client may still send requests
+            bool reading {true};
+
+            // the client is gone, so nothing more is sent to it
+            bool hung_up {false};
+        };
+
+        // open connections and the requests waiting for a worker, with the
+        // connection each came from
+        std::mutex connections_mutex {};
+        std::condition_variable jobs_ready {};
+        std::unordered_map<int, Connection> connections {};
+        std::queue<std::pair<int, Request>> jobs {};
+
+        // names for results, extended as requests load more of the prelude
+        std::shared_mutex tables_mutex {};
+        Contractions contractions {};
+        Simplifier simplifier {};
+
+        // oldest entries are evicted first
+        std::mutex cache_mutex {};
+        std::unordered_map<std::string, std::string> cache {};
+        std::deque<std::string> cache_order {};
+
+        auto worker() -> void;
+        auto wake_up() -> void;
+
+        // reads what the connection has sent, or notes that it is gone
+        auto receive(int connection, short events) -> void;
+
+        // hands each idle connection's next request to the workers and
+        // closes the connections that are done
+        auto dispatch() -> void;
+
+        // connection is watched for hang ups while evaluating, unless it is
+        // -1; anything thrown while answering is turned into an error response
+        auto respond(const std::string& request, int connection) -> std::string;
+        auto answer(const std::string& request, int connection) -> std::string;
+
+        // nothing if the evaluation was abandoned
+        auto evaluate(const std::string& expression, const EngineOptions& engine_options, bool simplify_result,
+                      int connection) -> std::optional<std::string>;
+        auto remember(const std::string& key, const std::string& response) -> void;
+
+        // adds the prelude definitions with these names to the tables
+        auto learn(std::vector<std::string> names) -> void;
+    };
+}
+
+#endif //LAMBDA_SERVER_H
@@ -0,0 +1,691 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "decode.h"
+#include "helpers.h"
+#include "simplify.h"
+
+namespace lambda
+{
+    namespace
+    {
+        // bound variables all hash alike, so that a subterm hashes the same
+        // wherever it sits; lookups confirm matches with alpha_equal
+        constexpr std::size_t bound_tag {0x9e3779b97f4a7c15u};
+        constexpr std::size_t abstraction_tag {0xc2b2ae3d27d4eb4fu};
+        constexpr std::size_t application_tag {0x165667b19e3779f9u};
+        constexpr std::size_t numeral_tag {0x27d4eb2f165667c5u};
+        constexpr std::size_t let_tag {0xff51afd7ed558ccdu};
+        constexpr std::size_t letrec_tag {0x85ebca77c2b2ae63u};
+
+        auto combine(std::size_t seed, std::size_t value) -> std::size_t
+        {
+            return seed ^ (value + 0x9e3779b9u + (seed << 6u) + (seed >> 2u));
+        }
+
+        auto free_hash(const std::string& name) -> std::size_t
+        {
+            return std::hash<std::string> {}(name);
+        }
+
+        auto abstraction_hash(std::size_t body) -> std::size_t
+        {
+            return combine(abstraction_tag, body);
+        }
+
+        auto application_hash(std::size_t lhs, std::size_t rhs) -> std::size_t
+        {
+            return combine(combine(application_tag, lhs), rhs);
+        }
+
+        auto numeral_hash(const Numeral& numeral) -> std::size_t
+        {
+            return combine(numeral_tag, numeral.value.hash());
+        }
+
+        auto let_hash(std::size_t definition, std::size_t body) -> std::size_t
+        {
+            return combine(combine(let_tag, definition), body);
+        }
+
+        auto letrec_hash(std::size_t definition, std::size_t body) -> std::size_t
+        {
+            return combine(combine(letrec_tag, definition), body);
+        }
+
+        // the name a binder node binds
+        auto binder_of(const Term& term) -> const std::string&
+        {
+            if (auto abstr = std::get_if<Abstraction>(&term))
+                return abstr->name.name;
+            if (auto let = std::get_if<Let>(&term))
+                return let->name.name;
+            return std::get<Letrec>(term).name.name;
+        }
+
+        /**
+         * Hashes the shape of the term, bound variable names left out. The
+         * walk keeps its own stack: a binder is in scope from when it is
+         * bound until it is unbound, and each node is hashed from the hashes
+         * its subterms left.
+         */
+        auto shape_hash(const Term& term) -> std::size_t
+        {
+            enum class Step {Visit, Bind, Unbind, Hash};
+            std::vector<std::pair<const Term*, Step>> pending {{&term, Step::Visit}};
+            std::vector<std::size_t> hashes {};
+            std::unordered_map<std::string, std::size_t> bound {};
+            while (!pending.empty())
+            {
+                auto [next, step] {pending.back()};
+                pending.pop_back();
+                if (step == Step::Bind)
+                {
+                    ++bound[binder_of(*next)];
+                    continue;
+                }
+                if (step == Step::Unbind)
+                {
+                    --bound[binder_of(*next)];
+                    continue;
+                }
+
+                if (step == Step::Hash)
+                {
+                    std::size_t last {hashes.back()};
+                    if (std::holds_alternative<Abstraction>(*next))
+                    {
+                        hashes.back() = abstraction_hash(last);
+                        continue;
+                    }
+                    hashes.pop_back();
+                    if (std::holds_alternative<Let>(*next))
+                        hashes.back() = let_hash(hashes.back(), last);
+                    else if (std::holds_alternative<Letrec>(*next))
+                        hashes.back() = letrec_hash(hashes.back(), last);
+                    else
+                        hashes.back() = application_hash(hashes.back(), last);
+                    continue;
+                }
+
+                if (auto var = std::get_if<Variable>(next))
+                {
+                    hashes.push_back(bound[var->name] > 0 ? bound_tag : free_hash(var->name));
+                }
+                else if (auto numeral = std::get_if<Numeral>(next))
+                {
+                    hashes.push_back(numeral_hash(*numeral));
+                }
+                else if (auto abstr = std::get_if<Abstraction>(next))
+                {
+                    pending.insert(pending.end(), {{next, Step::Hash}, {next, Step::Unbind},
+                                                   {&*abstr->body, Step::Visit}, {next, Step::Bind}});
+                }
+                else if (auto let = std::get_if<Let>(next))
+                {
+                    // the let binds its name in the body only
+                    pending.insert(pending.end(), {{next, Step::Hash}, {next, Step::Unbind}, {&*let->body, Step::Visit},
+                                                   {next, Step::Bind}, {&*let->definition, Step::Visit}});
+                }
+                else if (auto letrec = std::get_if<Letrec>(next))
+                {
+                    pending.insert(pending.end(), {{next, Step::Hash}, {next, Step::Unbind},
+                                                   {&*letrec->body, Step::Visit}, {&*letrec->definition, Step::Visit},
+                                                   {next, Step::Bind}});
+                }
+                else
+                {
+                    const Application& appl {std::get<Application>(*next)};
+                    pending.insert(pending.end(), {{next, Step::Hash}, {&*appl.rhs, Step::Visit},
+                                                   {&*appl.lhs, Step::Visit}});
+                }
+            }
+            return hashes.back();
+        }
+
+        /**
+         * Hashes of the exact structure of each node, names of bound
+         * variables included, so that equal terms hash alike. Every node is
+         * hashed in one pass from the leaves up.
+         */
+        auto exact_hashes(const Term& term) -> std::unordered_map<const Term*, std::size_t>
+        {
+            std::unordered_map<const Term*, std::size_t> hashes {};
+            std::vector<std::pair<const Term*, bool>> pending {{&term, false}};
+            while (!pending.empty())
+            {
+                auto [next, expanded] {pending.back()};
+                pending.pop_back();
+
+                auto abstr {std::get_if<Abstraction>(next)};
+                auto appl {std::get_if<Application>(next)};
+                auto let {std::get_if<Let>(next)};
+                auto letrec {std::get_if<Letrec>(next)};
+                if (!expanded && (abstr || appl || let || letrec))
+                {
+                    pending.emplace_back(next, true);
+                    for (const term_ptr* child : {abstr ? &abstr->body : nullptr,
+                                                  appl ? &appl->lhs : nullptr, appl ? &appl->rhs : nullptr,
+                                                  let ? &let->definition : nullptr, let ? &let->body : nullptr,
+                                                  letrec ? &letrec->definition : nullptr, letrec ? &letrec->body : nullptr})
+                    {
+                        if (child != nullptr)
+                            pending.emplace_back(child->get(), false);
+                    }
+                    continue;
+                }
+
+                std::size_t hash;
+                if (auto var = std::get_if<Variable>(next))
+                    hash = free_hash(var->name);
+                else if (auto numeral = std::get_if<Numeral>(next))
+                    hash = numeral_hash(*numeral);
+                else if (abstr)
+                    hash = combine(abstraction_hash(hashes.at(abstr->body.get())), free_hash(abstr->name.name));
+                else if (appl)
+                    hash = application_hash(hashes.at(appl->lhs.get()), hashes.at(appl->rhs.get()));
+                else if (let)
+                    hash = combine(let_hash(hashes.at(let->definition.get()), hashes.at(let->body.get())),
+                                   free_hash(let->name.name));
+                else
+                    hash = combine(letrec_hash(hashes.at(letrec->definition.get()), hashes.at(letrec->body.get())),
+                                   free_hash(letrec->name.name));
+                hashes.emplace(next, hash);
+            }
+            return hashes;
+        }
+
+        /**
+         * Compares two terms up to renaming of bound variables. Variables
+         * that are free in `lhs` but bound further out (by `outer`) never
+         * match a free variable of `rhs`, since they mean something else.
+         */
+        class AlphaComparison
+        {
+        public:
+            explicit AlphaComparison(std::function<bool(const std::string&)> outer = {})
+                : outer {std::move(outer)} {}
+
+            // compares pairs of subterms from a stack of its own, binding
+            // each pair of binders around their scopes
+            auto operator ()(const Term& lhs, const Term& rhs) const -> bool
+            {
+                enum class Step {Compare, Bind, Unbind};
+                struct Pair
+                {
+                    const Term* lhs;
+                    const Term* rhs;
+                    Step step;
+                };
+                std::vector<Pair> pending {{&lhs, &rhs, Step::Compare}};
+                std::vector<std::string> lhs_binders {};
+                std::vector<std::string> rhs_binders {};
+                while (!pending.empty())
+                {
+                    auto [l, r, step] {pending.back()};
+                    pending.pop_back();
+                    if (step == Step::Bind)
+                    {
+                        lhs_binders.push_back(binder_of(*l));
+                        rhs_binders.push_back(binder_of(*r));
+                        continue;
+                    }
+                    if (step == Step::Unbind)
+                    {
+                        lhs_binders.pop_back();
+                        rhs_binders.pop_back();
+                        continue;
+                    }
+
+                    if (l->index() != r->index())
+                        return false;
+
+                    if (auto lhs_var = std::get_if<Variable>(l))
+                    {
+                        const Variable& rhs_var {std::get<Variable>(*r)};
+                        std::optional<std::size_t> l_index {index_of(lhs_binders, lhs_var->name)};
+                        std::optional<std::size_t> r_index {index_of(rhs_binders, rhs_var.name)};
+                        if (l_index.has_value() || r_index.has_value())
+                        {
+                            if (l_index != r_index)
+                                return false;
+                        }
+                        else if ((outer && outer(lhs_var->name)) || lhs_var->name != rhs_var.name)
+                        {
+                            return false;
+                        }
+                    }
+                    else if (auto lhs_numeral = std::get_if<Numeral>(l))
+                    {
+                        if (!(*lhs_numeral == std::get<Numeral>(*r)))
+                            return false;
+                    }
+                    else if (auto lhs_abstr = std::get_if<Abstraction>(l))
+                    {
+                        const Abstraction& rhs_abstr {std::get<Abstraction>(*r)};
+                        pending.insert(pending.end(), {{l, r, Step::Unbind},
+                                                       {&*lhs_abstr->body, &*rhs_abstr.body, Step::Compare},
+                                                       {l, r, Step::Bind}});
+                    }
+                    else if (auto lhs_let = std::get_if<Let>(l))
+                    {
+                        // the let binds its name in the body only
+                        const Let& rhs_let {std::get<Let>(*r)};
+                        pending.insert(pending.end(), {{l, r, Step::Unbind},
+                                                       {&*lhs_let->body, &*rhs_let.body, Step::Compare},
+                                                       {l, r, Step::Bind},
+                                                       {&*lhs_let->definition, &*rhs_let.definition, Step::Compare}});
+                    }
+                    else if (auto lhs_letrec = std::get_if<Letrec>(l))
+                    {
+                        const Letrec& rhs_letrec {std::get<Letrec>(*r)};
+                        pending.insert(pending.end(), {{l, r, Step::Unbind},
+                                                       {&*lhs_letrec->body, &*rhs_letrec.body, Step::Compare},
+                                                       {&*lhs_letrec->definition, &*rhs_letrec.definition, Step::Compare},
+                                                       {l, r, Step::Bind}});
+                    }
+                    else
+                    {
+                        const Application& lhs_appl {std::get<Application>(*l)};
+                        const Application& rhs_appl {std::get<Application>(*r)};
+                        pending.insert(pending.end(), {{&*lhs_appl.rhs, &*rhs_appl.rhs, Step::Compare},
+                                                       {&*lhs_appl.lhs, &*rhs_appl.lhs, Step::Compare}});
+                    }
+                }
+                return true;
+            }
+
+        private:
+            std::function<bool(const std::string&)> outer;
+
+            // de Bruijn index of the innermost binder with the name
+            static auto index_of(const std::vector<std::string>& binders, const std::string& name)
+                -> std::optional<std::size_t>
+            {
+                auto search {std::find(binders.rbegin(), binders.rend(), name)};
+                if (search == binders.rend())
+                    return {};
+                return static_cast<std::size_t>(search - binders.rbegin());
+            }
+        };
+
+        struct Combinator
+        {
+            std::string name;
+            Term term;
+            std::size_t hash;
+        };
+
+        auto combinators() -> const std::vector<Combinator>&
+        {
+            static const std::vector<Combinator> table {[]()
+            {
+                std::vector<Combinator> terms {};
+                auto add = [&terms](std::string name, Term term)
+                {
+                    std::size_t hash {shape_hash(term)};
+                    terms.push_back({std::move(name), std::move(term), hash});
+                };
+                add("I", lam("x", var("x")));
+                add("K", lam("x", lam("y", var("x"))));
+                add("S", lam("x", lam("y", lam("z", app(app(var("x"), var("z")), app(var("y"), var("z")))))));
+                add("B", lam("f", lam("g", lam("x", app(var("f"), app(var("g"), var("x")))))));
+                return terms;
+            }()};
+            return table;
+        }
+    }
+
+    auto alpha_equal(const Term& lhs, const Term& rhs) -> bool
+    {
+        return AlphaComparison {}(lhs, rhs);
+    }
+
+    auto alpha_hash(const Term& term) -> std::size_t
+    {
+        return shape_hash(term);
+    }
+
+    /**
+     * Lookups are made on the subterm as it was in the input, so that a
+     * definition is still recognised after parts of it have been named or
+     * eta-reduced; a match on a larger subterm replaces any inside it.
+     */
+    class Simplifier::Pass
+    {
+    public:
+        explicit Pass(const Simplifier& simplifier) : simplifier {simplifier} {}
+
+        struct Simplified
+        {
+            Term term;
+
+            // shape hash of the input subterm
+            std::size_t hash;
+            bool changed;
+        };
+
+        /**
+         * Simplifies from a stack of its own, so terms can nest as deeply as
+         * memory allows. A binder is in scope from when it is bound until
+         * its node is finished, which takes its subterms' results off the
+         * results.
+         */
+        auto visit(const Term& term) -> Simplified
+        {
+            enum class Step {Visit, Bind, Finish};
+            std::vector<std::pair<const Term*, Step>> pending {{&term, Step::Visit}};
+            std::vector<Simplified> results {};
+            while (!pending.empty())
+            {
+                auto [next, step] {pending.back()};
+                pending.pop_back();
+                if (step == Step::Bind)
+                {
+                    uses.push_back(0);
+                    binders[binder_of(*next)].push_back(uses.size() - 1);
+                    continue;
+                }
+                if (step == Step::Finish)
+                {
+                    finish(*next, results);
+                    continue;
+                }
+
+                if (auto var = std::get_if<Variable>(next))
+                {
+                    if (bound_outside(var->name))
+                    {
+                        ++uses[binders[var->name].back()];
+                        results.push_back({*next, bound_tag, false});
+                    }
+                    else
+                    {
+                        results.push_back({*next, free_hash(var->name), false});
+                    }
+                }
+                else if (auto numeral = std::get_if<Numeral>(next))
+                {
+                    results.push_back({*next, numeral_hash(*numeral), false});
+                }
+                else if (auto abstr = std::get_if<Abstraction>(next))
+                {
+                    pending.insert(pending.end(), {{next, Step::Finish}, {&*abstr->body, Step::Visit},
+                                                   {next, Step::Bind}});
+                }
+                else if (auto let = std::get_if<Let>(next))
+                {
+                    // the let binds its name in the body only
+                    pending.insert(pending.end(), {{next, Step::Finish}, {&*let->body, Step::Visit},
+                                                   {next, Step::Bind}, {&*let->definition, Step::Visit}});
+                }
+                else if (auto letrec = std::get_if<Letrec>(next))
+                {
+                    pending.insert(pending.end(), {{next, Step::Finish}, {&*letrec->body, Step::Visit},
+                                                   {&*letrec->definition, Step::Visit}, {next, Step::Bind}});
+                }
+                else
+                {
+                    const Application& appl {std::get<Application>(*next)};
+                    pending.insert(pending.end(), {{next, Step::Finish}, {&*appl.rhs, Step::Visit},
+                                                   {&*appl.lhs, Step::Visit}});
+                }
+            }
+            return std::move(results.back());
+        }
+
+    private:
+        const Simplifier& simplifier;
+
+        // occurrences of each enclosing binder, outermost first
+        std::vector<std::size_t> uses {};
+
+        // positions in `uses` of the binders for each name, innermost last
+        std::unordered_map<std::string, std::vector<std::size_t>> binders {};
+
+        // takes the binder out of scope, giving the number of its occurrences
+        auto unbind(const std::string& name) -> std::size_t
+        {
+            binders[name].pop_back();
+            std::size_t occurrences {uses.back()};
+            uses.pop_back();
+            return occurrences;
+        }
+
+        // replaces the results of the node's subterms with its own
+        auto finish(const Term& term, std::vector<Simplified>& results) -> void
+        {
+            Simplified last {std::move(results.back())};
+            results.pop_back();
+            if (auto abstr = std::get_if<Abstraction>(&term))
+            {
+                results.push_back(finish(*abstr, term, std::move(last)));
+                return;
+            }
+
+            Simplified first {std::move(results.back())};
+            if (auto let = std::get_if<Let>(&term))
+                results.back() = finish(*let, term, std::move(first), std::move(last));
+            else if (auto letrec = std::get_if<Letrec>(&term))
+                results.back() = finish(*letrec, term, std::move(first), std::move(last));
+            else
+                results.back() = finish(term, std::move(first), std::move(last));
+        }
+
+        auto finish(const Term& term, Simplified lhs, Simplified rhs) const -> Simplified
+        {
+            std::size_t hash {application_hash(lhs.hash, rhs.hash)};
+            if (std::optional<Simplified> named {lookup(term, hash)})
+                return std::move(named.value());
+
+            if (!lhs.changed && !rhs.changed)
+                return {term, hash, false};
+            return {Application {std::move(lhs.term), std::move(rhs.term)}, hash, true};
+        }
+
+        auto finish(const Abstraction& abstr, const Term& term, Simplified body) -> Simplified
+        {
+            const std::string& name {abstr.name.name};
+            std::size_t occurrences {unbind(name)};
+
+            std::size_t hash {abstraction_hash(body.hash)};
+            if (std::optional<Simplified> named {lookup(term, hash)})
+                return std::move(named.value());
+
+            // \x. M x is M when x is not free in M, i.e. its only use is the argument
+            if (simplifier.options.eta && occurrences == 1)
+            {
+                auto appl {std::get_if<Application>(&body.term)};
+                auto arg {appl ? std::get_if<Variable>(&*appl->rhs) : nullptr};
+                if (arg && arg->name == name)
+                    return {*appl->lhs, hash, true};
+            }
+
+            if (!body.changed)
+                return {term, hash, false};
+            return {Abstraction {abstr.name, std::move(body.term)}, hash, true};
+        }
+
+        // simplifies inside, but a let is never itself named, so that its
+        // sharing survives
+        auto finish(const Let& let, const Term& term, Simplified definition, Simplified body) -> Simplified
+        {
+            unbind(let.name.name);
+            std::size_t hash {let_hash(definition.hash, body.hash)};
+            if (!definition.changed && !body.changed)
+                return {term, hash, false};
+            return {Let {let.name, make_term(std::move(definition.term)), make_term(std::move(body.term))},
+                    hash, true};
+        }
+
+        // simplifies inside, but a letrec is never itself named or eta-reduced
+        auto finish(const Letrec& letrec, const Term& term, Simplified definition, Simplified body) -> Simplified
+        {
+            unbind(letrec.name.name);
+            std::size_t hash {letrec_hash(definition.hash, body.hash)};
+            if (!definition.changed && !body.changed)
+                return {term, hash, false};
+            return {Letrec {letrec.name, make_term(std::move(definition.term)), make_term(std::move(body.term))},
+                    hash, true};
+        }
+
+        auto bound_outside(const std::string& name) const -> bool
+        {
+            auto search {binders.find(name)};
+            return search != binders.end() && !search->second.empty();
+        }
+
+        auto matches(const Term& term, const Term& candidate) const -> bool
+        {
+            return AlphaComparison {[this](const std::string& name) { return bound_outside(name); }}(term, candidate);
+        }
+
+        auto lookup(const Term& term, std::size_t hash) const -> std::optional<Simplified>
+        {
+            auto match = [this, &term](const Term& candidate) { return matches(term, candidate); };
+            if (const std::string* name {simplifier.known.find(hash, match)})
+                return Simplified {Variable {*name}, hash, true};
+
+            if (!simplifier.options.combinators)
+                return {};
+            for (const Combinator& combinator : combinators())
+            {
+                if (combinator.hash == hash && matches(term, combinator.term))
+                    return Simplified {Variable {combinator.name}, hash, true};
+            }
+            return {};
+        }
+    };
+
+    auto DefinitionTable::add(const std::string& name, const Term& term, std::size_t hash) -> void
+    {
+        auto known {hashes.find(name)};
+        if (known != hashes.end())
+        {
+            auto [begin, end] {entries.equal_range(known->second)};
+            for (auto it {begin}; it != end; ++it)
+            {
+                if (it->second.name == name)
+                {
+                    entries.erase(it);
+                    break;
+                }
+            }
+        }
+        hashes.insert_or_assign(name, hash);
+        entries.emplace(hash, Entry {name, term, added++});
+    }
+
+    auto DefinitionTable::contains(const std::string& name) const -> bool
+    {
+        return hashes.count(name) > 0;
+    }
+
+    auto DefinitionTable::empty() const -> bool
+    {
+        return entries.empty();
+    }
+
+    auto DefinitionTable::find(std::size_t hash, const std::function<bool(const Term&)>& matches) const
+        -> const std::string*
+    {
+        const Entry* first {nullptr};
+        auto [begin, end] {entries.equal_range(hash)};
+        for (auto it {begin}; it != end; ++it)
+        {
+            if ((first == nullptr || it->second.order < first->order) && matches(it->second.term))
+                first = &it->second;
+        }
+        return first != nullptr ? &first->name : nullptr;
+    }
+
+    auto Simplifier::add(const std::string& name, const Term& term) -> void
+    {
+        known.add(name, term, shape_hash(term));
+    }
+
+    auto Simplifier::add(const Context& context) -> void
+    {
+        std::vector<const std::string*> names {};
+        for (const auto& [name, term] : context)
+            names.push_back(&name);
+        std::sort(names.begin(), names.end(), [](const std::string* lhs, const std::string* rhs)
+        {
+            return *lhs < *rhs;
+        });
+
+        for (const std::string* name : names)
+            add(*name, context.at(*name));
+    }
+
+    auto Simplifier::operator()(const Term& term) const -> Term
+    {
+        instrument::PhaseScope scope {instrument::Phase::Contract};
+        Pass pass {*this};
+        return pass.visit(term).term;
+    }
+
+    auto simplify(const Term& term, const Context& context, SimplifyOptions options) -> Term
+    {
+        Simplifier simplifier {options};
+        simplifier.add(context);
+        return simplifier(term);
+    }
+
+    Contractions::Contractions(const Context& context)
+    {
+        for (const auto& [name, term] : context)
+            add(name, term);
+    }
+
+    auto Contractions::add(const std::string& name, const Term& term) -> void
+    {
+        known.add(name, term, exact_hashes(term).at(&term));
+    }
+
+    auto Contractions::contains(const std::string& name) const -> bool
+    {
+        return known.contains(name);
+    }
+
+    auto Contractions::operator()(const Term& term) const -> Term
+    {
+        instrument::PhaseScope scope {instrument::Phase::Contract};
+        if (known.empty())
+            return term;
+
+        std::unordered_map<const Term*, std::size_t> hashes {exact_hashes(term)};
+        return replace_subterms(term, [this, &hashes](const Term& subterm) -> std::optional<Term>
+        {
+            auto equal = [&subterm](const Term& definition) { return subterm == definition; };
+            if (const std::string* name {known.find(hashes.at(&subterm), equal)})
+                return Variable {*name};
+            return {};
+        });
+    }
+
+    auto tidy(const Term& normal, const Context& known, bool simplify_result) -> Term
+    {
+        // decoding first leaves contraction less to match
+        Term decoded {decode(normal)};
+        if (simplify_result)
+            return simplify(decoded, known);
+        return contract_term(decoded, known);
+    }
+
+    auto tidy(const Term& normal, const Contractions& known) -> Term
+    {
+        return known(decode(normal));
+    }
+
+    auto tidy(const Term& normal, const Simplifier& simplifier) -> Term
+    {
+        return simplifier(decode(normal));
+    }
+}
@@ -0,0 +1,129 @@
+//
+// Created by colin on 10/19/26.
+//
+
+/**
+ * Tidies up a normal form for display: eta-reduces \x. f x to f and
+ * replaces closed subterms that match a known definition or a standard
+ * combinator with its name. Done in one bottom-up pass, looking subterms up
+ * by an alpha-invariant hash rather than comparing against every entry.
+ */
+
+#ifndef LAMBDA_SIMPLIFY_H
+#define LAMBDA_SIMPLIFY_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#include "eval.h"
+
+namespace lambda
+{
+    struct SimplifyOptions
+    {
+        bool eta {true};
+
+        // also recognise I, K, S and B when no definition has claimed them
+        bool combinators {true};
+    };
+
+    /**
+     * Definitions looked up by a hash of their terms. A name added again
+     * has its term replaced; of several definitions that match a term, the
+     * one added first wins.
+     */
+    class DefinitionTable
+    {
+    public:
+        auto add(const std::string& name, const Term& term, std::size_t hash) -> void;
+        auto contains(const std::string& name) const -> bool;
+        auto empty() const -> bool;
+
+        // the name of the first definition added with the hash that matches
+        auto find(std::size_t hash, const std::function<bool(const Term&)>& matches) const -> const std::string*;
+
+    private:
+        struct Entry
+        {
+            std::string name;
+            Term term;
+            std::size_t order;
+        };
+
+        std::unordered_multimap<std::size_t, Entry> entries {};
+        std::unordered_map<std::string, std::size_t> hashes {};
+        std::size_t added {0};
+    };
+
+    class Simplifier
+    {
+    public:
+        explicit Simplifier(SimplifyOptions options = {}) : options {options} {}
+
+        // a name added again is given the new term; when two definitions
+        // are alpha equivalent the first one added wins
+        auto add(const std::string& name, const Term& term) -> void;
+
+        // adds the context in name order, so the result doesn't depend on hashing
+        auto add(const Context& context) -> void;
+
+        auto operator ()(const Term& term) const -> Term;
+
+    private:
+        class Pass;
+
+        SimplifyOptions options;
+
+        // keyed by shape hash, which ignores the names of bound variables
+        DefinitionTable known {};
+    };
+
+    auto simplify(const Term& term, const Context& context, SimplifyOptions options = {}) -> Term;
+
+    /**
+     * The names contract_term gives to subterms equal to a definition.
+     * Definitions are indexed by a hash of their exact structure, so a term
+     * is contracted by looking each subterm up rather than comparing it
+     * with every definition, and a table can be added to as definitions
+     * are loaded instead of rebuilt for each term.
+     */
+    class Contractions
+    {
+    public:
+        Contractions() = default;
+        explicit Contractions(const Context& context);
+
+        // a name added again is given the new term, and when two
+        // definitions are equal the first one added wins
+        auto add(const std::string& name, const Term& term) -> void;
+        auto contains(const std::string& name) const -> bool;
+
+        // replaces each outermost subterm equal to a definition with its name
+        auto operator ()(const Term& term) const -> Term;
+
+    private:
+        // keyed by a hash of the exact structure
+        DefinitionTable known {};
+    };
+
+    /**
+     * How a normal form is shown: encoded values are decoded, then what is
+     * left is contracted to the names of known definitions, with
+     * contract_term or, if asked for, the simplification pass.
+     */
+    auto tidy(const Term& normal, const Context& known, bool simplify_result = false) -> Term;
+
+    // the same with tables kept between calls
+    auto tidy(const Term& normal, const Contractions& known) -> Term;
+    auto tidy(const Term& normal, const Simplifier& simplifier) -> Term;
+
+    // equality up to the names of bound variables
+    auto alpha_equal(const Term& lhs, const Term& rhs) -> bool;
+
+    // a hash that alpha equivalent terms share
+    auto alpha_hash(const Term& term) -> std::size_t;
+}
+
+#endif //LAMBDA_SIMPLIFY_H
@@ -0,0 +1,93 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include <csignal>
+#include <thread>
+
+#include "shared_tests.h"
+
+#include "async.h"
+#include "helpers.h"
+#include "prelude.h"
+
+static const Context prelude {get_prelude()};
+
+// the optimal engine runs this until stopped, in constant space
+static const std::string diverges {"(\\x.x x) (\\x.x x)"};
+
+go_bandit([]() {
+    describe("async evaluation tests", []() {
+        it("produces the same result as a blocking reduction", []() {
+            Term term {parse_string("times 2 3").value()};
+            ContextDefinitions definitions {prelude};
+            Evaluation evaluation {term, definitions};
+            ReduceResult result {evaluation.get()};
+            AssertThat(*result.get_ok(), Equals(reduce(term, prelude)));
+            AssertThat(evaluation.stats().reductions, Equals(1u));
+            AssertThat(evaluation.stats().last_steps > 0, IsTrue());
+        });
+        it("can be cancelled while it runs", []() {
+            ContextDefinitions definitions {prelude};
+            Evaluation evaluation {parse_string(diverges).value(), definitions,
+                                   {Strategy::Optimal, NormalForm::Full, std::size_t(-1)}};
+            while (evaluation.steps() == 0)
+                std::this_thread::yield();
+            AssertThat(evaluation.ready(), IsFalse());
+
+            evaluation.cancel();
+            ReduceResult result {evaluation.get()};
+            AssertThat(*result.get_err(), Equals(std::string {"Evaluation cancelled"}));
+            AssertThat(evaluation.stats().failures, Equals(1u));
+        });
+        it("gives up at its deadline", []() {
+            ContextDefinitions definitions {prelude};
+            Evaluation evaluation {evaluate_async(parse_string(diverges).value(), definitions,
+                                                  {Strategy::Optimal, NormalForm::Full, std::size_t(-1)},
+                                                  std::chrono::milliseconds {20})};
+            AssertThat(evaluation.wait_for(std::chrono::seconds {10}), IsTrue());
+            AssertThat(*evaluation.get().get_err(), Equals(std::string {"Deadline exceeded"}));
+        });
+        it("is checked by every strategy", []() {
+            Term term {parse_string("times 2 3").value()};
+            for (Strategy strategy : {Strategy::Tree, Strategy::Optimal, Strategy::Lifted})
+            {
+                CancelToken token {};
+                token.cancel();
+                Engine engine {{strategy}};
+                ReduceResult result {engine.reduce(term, prelude, &token)};
+                AssertThat(*result.get_err(), Equals(std::string {"Evaluation cancelled"}));
+                AssertThat(token.steps(), Equals(1u));
+            }
+        });
+        it("notices a deadline while substituting and reading back", []() {
+            // one reduction, then a body of thousands of nodes to walk
+            std::string body {"x"};
+            for (std::size_t i {0}; i < 5000; ++i)
+                body = "f (" + body + ")";
+            Term term {parse_string("(\\y.\\f.\\x." + body + ") y").value()};
+            for (Strategy strategy : {Strategy::Tree, Strategy::Optimal, Strategy::Lifted})
+            {
+                CancelToken token {std::chrono::steady_clock::now() - std::chrono::seconds {1}};
+                Engine engine {{strategy}};
+                ReduceResult result {engine.reduce(term, prelude, &token)};
+                AssertThat(*result.get_err(), Equals(std::string {"Deadline exceeded"}));
+
+                token.reset();
+                AssertThat(engine.reduce(term, prelude, &token).is_ok(), IsTrue());
+            }
+        });
+        it("turns SIGINT into a cancellation while interruptible", []() {
+            CancelToken token {};
+            {
+                InterruptScope scope {token};
+                std::raise(SIGINT);
+            }
+            AssertThat(token.is_cancelled(), IsTrue());
+
+            ReduceResult result {reduce(parse_string("times 2 3").value(), ContextDefinitions {prelude},
+                                        NormalForm::Full, 1000, nullptr, &token)};
+            AssertThat(result.is_err(), IsTrue());
+        });
+    });
+});
@@ -0,0 +1,55 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include "shared_tests.h"
+
+#include "fixed_term.h"
+#include "helpers.h"
+
+namespace
+{
+    // prelude definitions, checked at compile time
+    constexpr auto true_ {fixed::parse<4>("\\t.\\f. t")};
+    constexpr auto false_ {fixed::parse<4>("\\t.\\f. f")};
+    constexpr auto and_ {fixed::parse<16>("\\b.\\c. b c (\\t.\\f. f)")};
+    constexpr auto pair {fixed::parse<16>("\\f.\\s.\\b. b f s")};
+    constexpr auto first {fixed::parse<8>("\\p. p (\\t.\\f. t)")};
+    constexpr auto second {fixed::parse<8>("\\p. p (\\t.\\f. f)")};
+    constexpr auto plus {fixed::parse<16>("\\m.\\n.\\s.\\z. m s (n s z)")};
+    constexpr auto times {fixed::parse<32>("\\m.\\n. m ((\\m.\\n.\\s.\\z. m s (n s z)) n) 0")};
+
+    static_assert(fixed::normalize(fixed::apply(and_, true_, false_)) == false_);
+    static_assert(fixed::normalize(fixed::apply(and_, true_, true_)) == true_);
+    static_assert(fixed::normalize<64>(fixed::apply(first, fixed::apply(pair, true_, false_))) == true_);
+    static_assert(fixed::normalize<64>(fixed::apply(second, fixed::apply(pair, true_, false_))) == false_);
+    static_assert(fixed::normalize<64>(fixed::apply(plus, fixed::numeral<16>(2), fixed::numeral<16>(3))) == fixed::numeral<16>(5));
+    static_assert(fixed::normalize<64>(fixed::apply(times, fixed::numeral<16>(2), fixed::numeral<16>(3))) == fixed::numeral<16>(6));
+    static_assert(fixed::parse<16>("(\\x. x) 3") == fixed::apply(fixed::parse<2>("\\x. x"), fixed::numeral<16>(3)));
+    static_assert(!(fixed::parse<4>("\\x.\\y. x") == fixed::parse<4>("\\x.\\y. y")));
+}
+
+go_bandit([]() {
+    describe("fixed term tests", []() {
+        it("converts to a runtime term", []() {
+            AssertThat(fixed::parse<16>("\\f.\\x. f (g x)").to_term(),
+                       Equals(lam("f", lam("x", app(var("f"), app(var("g"), var("x")))))));
+        });
+        it("matches the runtime reducer", []() {
+            constexpr auto term {fixed::parse<32>("(\\m.\\n.\\s.\\z. m s (n s z)) 2 3")};
+            constexpr auto normal {fixed::normalize(term)};
+            AssertThat(normal.to_term(), Equals(reduce(term.to_term(), Context {})));
+        });
+        it("renames binders that would capture", []() {
+            // \y. (\x.\y. x) y reduces to \y.\ya. y, where the y is bound outside
+            constexpr auto normal {fixed::normalize(fixed::parse<8>("\\y. (\\x.\\y. x) y"))};
+            AssertThat(normal.to_term(), Equals(lam("y", lam("ya", var("y")))));
+        });
+        it("renames binders that would capture a free variable", []() {
+            constexpr auto term {fixed::parse<8>("(\\x.\\y. x) y")};
+            constexpr auto normal {fixed::normalize(term)};
+            AssertThat(normal.to_term(), Equals(lam("ya", var("y"))));
+            AssertThat(normal.to_term(), Equals(reduce(term.to_term(), Context {})));
+        });
+    });
+});
@@ -5,7 +5,12 @@
 #include <numerals.h>
 
 #include "shared_tests.h"
+#include "decode.h"
+#include "engine.h"
 #include "helpers.h"
+#include "instrument.h"
+#include "print.h"
+#include "simplify.h"
 
 go_bandit([]() {
     const Term ident {lam("x",var("x"))};
@@ -27,6 +32,21 @@ go_bandit([]() {
             AssertThat(compare(fls,tru), IsFalse());
         });
     });
+    describe("lex tests", []() {
+        it("reads every token of a line", []() {
+            std::vector<Token> tokens {read("\\x.(x 12)")};
+            AssertThat(tokens.size(), Equals(7u));
+            AssertThat(tokens[1].value, Equals(std::string {"x"}));
+            AssertThat(tokens[5].type == TokenType::Numeral, IsTrue());
+            AssertThat(tokens[5].value, Equals(std::string {"12"}));
+        });
+        it("keeps lexing past a bad character", []() {
+            std::stringstream line {"x ! y"};
+            auto tokens {lex_all(line)};
+            AssertThat(tokens.is_err(), IsTrue());
+            AssertThat(tokens.get_err()->size(), Equals(1u));
+        });
+    });
     describe("parse tests", [&]() {
         it("can parse single variable", [&]() {
             AssertThat(parse_string("x").value(), Equals(x));
@@ -70,6 +90,41 @@ go_bandit([]() {
         it("can parse parenthesized abstraction", [&]() {
             parse_test("\\x.x", lam("x", x));
         });
+        it("lets an abstraction end an application", [&]() {
+            parse_test("f \\x.x y", app("f", lam("x", app("x", "y"))));
+        });
+        it("parses nesting deeper than the call stack would allow", [&]() {
+            std::size_t depth {100'000};
+            AssertThat(parse_string(std::string(depth, '(') + "x" + std::string(depth, ')')).value(), Equals(x));
+
+            std::string binders {};
+            for (std::size_t i {0}; i < 1'000'000; ++i)
+                binders += "\\x.";
+            Term term {parse_string(binders + "x").value()};
+            std::size_t found {0};
+            for (const Term* t {&term}; std::holds_alternative<Abstraction>(*t); t = std::get<Abstraction>(*t).body.get())
+                ++found;
+            AssertThat(found, Equals(1'000'000u));
+
+            // released without recursing when they go out of scope
+            std::string arguments {};
+            for (std::size_t i {0}; i < 1'000'000; ++i)
+                arguments += "x (";
+            Term nested {parse_string(arguments + "x" + std::string(1'000'000, ')')).value()};
+            AssertThat(std::holds_alternative<Application>(nested), IsTrue());
+        });
+        it("reports where parsing failed", []() {
+            auto error = [](const std::string& text) -> std::string
+            {
+                std::vector<Token> tokens {read(text)};
+                ParseResult result {parse(std::queue<Token> {std::deque<Token> {tokens.begin(), tokens.end()}})};
+                return result.is_err() ? *result.get_err() : "";
+            };
+            AssertThat(error("(x y"), Equals(std::string {"expected RIGHT_PAREN, got end of input at column 5"}));
+            AssertThat(error("\\x y"), Equals(std::string {"expected DOT, got NAME at column 4"}));
+            AssertThat(error("x ())"), Equals(std::string {"expected NAME, got RIGHT_PAREN at column 4"}));
+            AssertThat(error("x)"), Equals(std::string {"unmatched RIGHT_PAREN at column 2"}));
+        });
     });
     describe("numeral tests", []() {
         it("can contract zero", []() {
@@ -84,5 +139,451 @@ go_bandit([]() {
             Term term {contract_numeral(parse_string("2").value())};
             AssertThat(term, Equals(var("2")));
         });
+        it("reads back the numerals it builds", []() {
+            for (uint n : {0u, 1u, 7u, 100'000u})
+                AssertThat(from_numeral(to_numeral(n)), Equals(std::optional<int> {static_cast<int>(n)}));
+        });
+        it("keeps literals past the int range exact", []() {
+            std::string digits {"123456789012345678901234567890"};
+            Term term {parse_string(digits).value()};
+            AssertThat(std::holds_alternative<Numeral>(term), IsTrue());
+            AssertThat(contract_numeral(term), Equals(var(digits)));
+            AssertThat(as_string(term), Equals(digits));
+            AssertThat(from_numeral(term).has_value(), IsFalse());
+        });
+        it("unfolds large numerals only as far as reduction needs", []() {
+            Term is_zero {parse_string("(\\n. n (\\x.\\t.\\f. f) (\\t.\\f. t)) 100000000000").value()};
+            std::size_t steps {0};
+            ReduceResult result {reduce(is_zero, ContextDefinitions {{}}, NormalForm::Full, 100, &steps)};
+            AssertThat(*result.get_ok(), Equals(lam("t", lam("f", var("f")))));
+            AssertThat(steps < 10, IsTrue());
+
+            // head normal form leaves the successor's argument alone
+            Term succ {parse_string("(\\n.\\s.\\z. s (n s z)) 4294967296").value()};
+            Term head {reduce(succ, Context {}, NormalForm::Head)};
+            AssertThat(read_numeral(head), Equals(Natural::parse("4294967297")));
+        });
+        it("builds numerals on top of smaller ones already built", []() {
+            auto spine = [](const Term& numeral) -> term_ptr
+            {
+                return std::get<Abstraction>(*std::get<Abstraction>(numeral).body).body;
+            };
+            term_ptr eleven {spine(to_numeral(11))};
+            term_ptr thirteen {spine(to_numeral(13))};
+            AssertThat(std::get<Application>(*std::get<Application>(*thirteen).rhs).rhs == eleven, IsTrue());
+        });
+    });
+    describe("normal form tests", []() {
+        const Term term {parse_string("(\\x.x) (\\x. (\\y.y) x ((\\z.z) w))").value()};
+        it("weak head normal form stops at the abstraction", [&]() {
+            Term expected {lam("x", app(app(lam("y", var("y")), var("x")), app(lam("z", var("z")), var("w"))))};
+            AssertThat(reduce(term, {}, NormalForm::WeakHead), Equals(expected));
+        });
+        it("head normal form leaves arguments alone", [&]() {
+            Term expected {lam("x", app(var("x"), app(lam("z", var("z")), var("w"))))};
+            AssertThat(reduce(term, {}, NormalForm::Head), Equals(expected));
+        });
+        it("full normal form reduces everywhere", [&]() {
+            AssertThat(reduce(term), Equals(lam("x", app(var("x"), var("w")))));
+        });
+        it("substitution does not capture free variables", []() {
+            Term term {parse_string("(\\x.\\y. x y) y").value()};
+            AssertThat(reduce(term), Equals(lam("ya", app(var("y"), var("ya")))));
+        });
+        it("stops a reduction that needs itself when asked to look for loops", []() {
+            for (const char* text : {"(\\x.x x) (\\x.x x)", "\\y. (\\x.x x y) (\\x.x x y)"})
+            {
+                std::size_t steps {0};
+                ReduceResult result {reduce(parse_string(text).value(), ContextDefinitions {{}}, NormalForm::Full,
+                                            1'000'000, &steps, nullptr, 8)};
+                AssertThat(result.is_err(), IsTrue());
+                AssertThat(steps < 10, IsTrue());
+            }
+        });
+        it("does not mistake repeated work for a loop", []() {
+            Term repeated {parse_string("x ((\\y.y) a) ((\\y.y) a)").value()};
+            Term recursive {parse_string("(\\f.(\\x.f (x x)) (\\x.f (x x))) (\\r.\\n.n)").value()};
+            ReduceResult result {reduce(repeated, ContextDefinitions {{}}, NormalForm::Full, 100, nullptr, nullptr, 8)};
+            AssertThat(*result.get_ok(), Equals(app(app("x", "a"), "a")));
+            result = reduce(recursive, ContextDefinitions {{}}, NormalForm::Full, 100, nullptr, nullptr, 8);
+            AssertThat(*result.get_ok(), Equals(lam("n", var("n"))));
+        });
+    });
+    describe("engine tests", []() {
+        it("reduces and counts beta steps", []() {
+            Engine engine {};
+            ReduceResult result {engine.reduce(parse_string("(\\x.\\y. x) a b").value())};
+            AssertThat(*result.get_ok(), Equals(var("a")));
+            AssertThat(engine.stats().last_steps, Equals(2u));
+            AssertThat(engine.stats().reductions, Equals(1u));
+        });
+        it("gives up at the limit", []() {
+            Engine engine {{Strategy::Tree, NormalForm::Full, 100}};
+            ReduceResult result {engine.reduce(parse_string("(\\x. x x) (\\x. x x)").value())};
+            AssertThat(result.is_err(), IsTrue());
+            AssertThat(engine.stats().failures, Equals(1u));
+        });
+        it("reaches the limit of a long head reduction without running out of stack", []() {
+            for (const char* text : {"(\\x. x x) (\\x. x x)", "(\\x. x x x) (\\x. x x x)"})
+            {
+                Engine engine {{Strategy::Tree, NormalForm::Full, 1'000'000}};
+                ReduceResult result {engine.reduce(parse_string(text).value())};
+                AssertThat(*result.get_err(), Equals(std::string {"Reduction limit exceeded"}));
+            }
+        });
+        it("reduces terms nested deeper than the call stack would allow", []() {
+            std::string binders {};
+            std::string arguments {};
+            for (std::size_t i {0}; i < 30'000; ++i)
+            {
+                binders += "\\x.";
+                arguments += "x (";
+            }
+            Term term {parse_string("(\\y. " + binders + "y) z").value()};
+            Term reduced {*Engine {}.reduce(term).get_ok()};
+            std::size_t found {0};
+            const Term* t {&reduced};
+            for (; std::holds_alternative<Abstraction>(*t); t = std::get<Abstraction>(*t).body.get())
+                ++found;
+            AssertThat(found, Equals(30'000u));
+            AssertThat(*t, Equals(var("z")));
+
+            Term spine {parse_string("(\\y. " + arguments + "y" + std::string(30'000, ')') + ") z").value()};
+            AssertThat(std::holds_alternative<Application>(*Engine {}.reduce(spine).get_ok()), IsTrue());
+        });
+        it("gives the same normal form with either strategy", []() {
+            Term term {parse_string("(\\f.\\x. f (f x)) (\\y. y) z").value()};
+            Engine tree {};
+            Engine optimal {{Strategy::Optimal}};
+            AssertThat(*tree.reduce(term).get_ok(), Equals(*optimal.reduce(term).get_ok()));
+            AssertThat(optimal.stats().peak_nodes > 0, IsTrue());
+        });
+    });
+    describe("let tests", [&]() {
+        it("parses and prints let", [&]() {
+            Term term {parse_string("let i = \\x. x in f i i").value()};
+            AssertThat(term, Equals(Term {Let {Variable {"i"}, make_term(lam("x", x)), make_term(app(app("f", "i"), "i"))}}));
+            AssertThat(as_string(term), Equals(std::string {"let i = \\x.x in f i i"}));
+            AssertThat(parse_string(as_string(app("g", term))).value(), Equals(app("g", term)));
+        });
+        it("reduces the definition once however often it is used", []() {
+            Engine shared {};
+            ReduceResult let {shared.reduce(parse_string("let i = (\\x. x) (\\x. x) in i (i (i z))").value())};
+            Engine copied {};
+            ReduceResult beta {copied.reduce(parse_string("(\\i. i (i (i z))) ((\\x. x) (\\x. x))").value())};
+            AssertThat(*let.get_ok(), Equals(var("z")));
+            AssertThat(*beta.get_ok(), Equals(var("z")));
+            AssertThat(shared.stats().last_steps, Equals(4u));
+            AssertThat(copied.stats().last_steps, Equals(7u));
+        });
+        it("does not let a binder capture the shared definition", []() {
+            AssertThat(reduce(parse_string("let d = y in \\y. d").value()), Equals(lam("ya", var("y"))));
+            AssertThat(reduce(parse_string("\\y. let d = y in \\y. d").value()), Equals(lam("y", lam("ya", var("y")))));
+        });
+        it("puts back lets that a weak head normal form still needs", [&]() {
+            Term term {parse_string("let i = (\\x. x) (\\x. x) in \\y. i").value()};
+            AssertThat(reduce(term, Context {}, NormalForm::WeakHead), Equals(term));
+            AssertThat(Term {*evaluate(term, Context {}).get_ok()}, Equals(lam("y", app(lam("x", x), lam("x", x)))));
+        });
+        it("reduces the same way with every strategy", []() {
+            Term term {parse_string("let k = \\a.\\b. a in let i = k (\\x. x) k in k (i z) (i w)").value()};
+            for (Strategy strategy : {Strategy::Tree, Strategy::Optimal, Strategy::Lifted})
+            {
+                Engine engine {{strategy}};
+                AssertThat(*engine.reduce(term).get_ok(), Equals(var("z")));
+            }
+        });
+    });
+    describe("letrec tests", []() {
+        const std::string pred {"(\\n.\\f.\\x. n (\\g.\\h. h (g f)) (\\u. x) (\\u. u))"};
+        const std::string if_zero {"(\\n. n (\\p.\\a.\\b. b) (\\a.\\b. a))"};
+
+        it("parses and prints letrec", []() {
+            Term term {parse_string("letrec f = \\x. f x in f y").value()};
+            AssertThat(term, Equals(Term {Letrec {Variable {"f"}, make_term(lam("x", app("f", "x"))), make_term(app("f", "y"))}}));
+            AssertThat(as_string(term), Equals(std::string {"letrec f = \\x.f x in f y"}));
+            AssertThat(parse_string(as_string(app(term, var("z")))).value(), Equals(app(term, var("z"))));
+        });
+        it("recurses the same way with every strategy", [&]() {
+            Term term {parse_string("letrec down = \\n. " + if_zero + " n 0 (down (" + pred + " n)) in down 3").value()};
+            for (Strategy strategy : {Strategy::Tree, Strategy::Optimal, Strategy::Lifted})
+            {
+                Engine engine {{strategy}};
+                AssertThat(*engine.reduce(term).get_ok(), Equals(parse_string("\\s.\\z. z").value()));
+            }
+        });
+        it("resolves definitions unfolded under a binder of the same name with every engine", []() {
+            Context context {{"plus", parse_string("\\m.\\n.\\s.\\z. m s (n s z)").value()},
+                             {"times", parse_string("\\m.\\n. m (plus n) 0").value()}};
+            Term term {parse_string("\\plus. times 2 3").value()};
+            for (Strategy strategy : {Strategy::Tree, Strategy::Lifted, Strategy::Optimal})
+            {
+                Engine engine {{strategy}};
+                AssertThat(*engine.reduce(term, context).get_ok(), Equals(parse_string("\\plus. 6").value()));
+            }
+
+            // a binder that only clashes while its body is reduced keeps its name
+            AssertThat(reduce(parse_string("\\plus. plus").value(), context), Equals(parse_string("\\plus. plus").value()));
+        });
+        it("does not confuse a hoisted letrec with a definition of the same name", [&]() {
+            Context context {{"down", var("elsewhere")}};
+            Term term {parse_string("down (letrec down = \\n. " + if_zero + " n 0 (down (" + pred + " n)) in down 2)").value()};
+            Engine engine {};
+            AssertThat(*engine.reduce(term, context).get_ok(), Equals(app("elsewhere", lam("s", lam("z", "z")))));
+        });
+        it("reduces letrecs that use enclosing variables with every engine", [&]() {
+            // the tree engine unfolds them in place, the others lift them out
+            // with the enclosing variables as parameters
+            Term term {parse_string("(\\y. letrec g = \\n. " + if_zero + " n y (g (" + pred + " n)) in g 2) z").value()};
+            for (Strategy strategy : {Strategy::Tree, Strategy::Lifted, Strategy::Optimal})
+            {
+                Engine engine {{strategy}};
+                AssertThat(*engine.reduce(term).get_ok(), Equals(var("z")));
+            }
+
+            // a binder in the letrec's body named like a captured variable is renamed
+            Term shadowed {parse_string("\\y. letrec f = \\x. y in \\y. f y").value()};
+            Term expected {reduce(shadowed)};
+            AssertThat(*Engine {{Strategy::Lifted}}.reduce(shadowed).get_ok(), Equals(expected));
+        });
+        it("stops letrecs and definitions that only unfold themselves", []() {
+            for (const char* text : {"letrec f = f in f", "letrec f = \\x. f x in f"})
+            {
+                Term term {parse_string(text).value()};
+                ReduceResult limited {reduce(term, ContextDefinitions {{}}, NormalForm::Full, 100'000)};
+                AssertThat(*limited.get_err(), Equals(std::string {"Reduction limit exceeded"}));
+
+                std::size_t steps {0};
+                ReduceResult watched {reduce(term, ContextDefinitions {{}}, NormalForm::Full, 100'000,
+                                             &steps, nullptr, 8)};
+                AssertThat(*watched.get_err(), Equals(std::string {"Term diverges: a redex needs itself reduced"}));
+                AssertThat(steps < 10, IsTrue());
+            }
+
+            Context context {{"loop", var("loop")}};
+            ReduceResult result {reduce(var("loop"), ContextDefinitions {context}, NormalForm::Full, 1000)};
+            AssertThat(*result.get_err(), Equals(std::string {"Reduction limit exceeded"}));
+        });
+    });
+    describe("simplify tests", []() {
+        it("eta reduces", []() {
+            AssertThat(simplify(parse_string("\\x. f x").value(), {}), Equals(var("f")));
+            AssertThat(simplify(parse_string("\\x.\\y. f x y").value(), {}), Equals(var("f")));
+            AssertThat(simplify(parse_string("\\x. x x").value(), {}), Equals(parse_string("\\x. x x").value()));
+            AssertThat(simplify(parse_string("\\x. f x x").value(), {}), Equals(parse_string("\\x. f x x").value()));
+        });
+        it("names definitions and combinators", []() {
+            Context context {{"true", parse_string("\\t.\\f. t").value()}};
+            AssertThat(simplify(parse_string("g (\\a.\\b. a) (\\x.x)").value(), context),
+                       Equals(app(app(var("g"), var("true")), var("I"))));
+            AssertThat(simplify(parse_string("\\a.\\b. a").value(), {}), Equals(var("K")));
+        });
+        it("contracts subterms equal to definitions", []() {
+            Contractions contractions {};
+            contractions.add("true", parse_string("\\t.\\f. t").value());
+            contractions.add("id", parse_string("\\x. x").value());
+            contractions.add("same", parse_string("\\x. x").value());
+            AssertThat(contractions.contains("id"), IsTrue());
+            AssertThat(contractions(parse_string("g (\\t.\\f. t) (\\x. x)").value()),
+                       Equals(app(app(var("g"), var("true")), var("id"))));
+
+            // a name added again is given the new term, and the first name added for a term wins
+            contractions.add("id", parse_string("\\y. y").value());
+            AssertThat(contractions(parse_string("\\y. y").value()), Equals(var("id")));
+            AssertThat(contractions(parse_string("\\x. x").value()), Equals(var("same")));
+            Context context {{"true", parse_string("\\t.\\f. t").value()}};
+            AssertThat(contract_term(parse_string("\\a. \\t.\\f. t").value(), context), Equals(lam("a", var("true"))));
+
+            // nor where a binder would capture the name
+            for (const char* text : {"\\true. \\t.\\f. t", "let true = x in \\t.\\f. t", "letrec true = \\t.\\f. t in true"})
+                AssertThat(contractions(parse_string(text).value()), Equals(parse_string(text).value()));
+            AssertThat(contractions(parse_string("let a = \\x. x in a").value()),
+                       Equals(Term {Let {Variable {"a"}, make_term(var("same")), make_term(var("a"))}}));
+        });
+        it("simplifies, compares and hashes deeply nested terms", []() {
+            Term term {var("y")};
+            Term renamed {var("y")};
+            for (int i {0}; i < 100'000; ++i)
+            {
+                term = lam("x", app(term, var("x")));
+                renamed = lam("z", app(renamed, var("z")));
+            }
+            AssertThat(simplify(term, {}), Equals(var("y")));
+            AssertThat(alpha_equal(term, renamed), IsTrue());
+            AssertThat(alpha_hash(term), Equals(alpha_hash(renamed)));
+        });
+        it("learns session definitions as they are made", []() {
+            Contractions contractions {};
+            lang_tools::Session<Term> session {};
+            session.on_define([&contractions](const std::string& name, const Term& term) { contractions.add(name, term); });
+            session.load({{"id", parse_string("\\x. x").value()}});
+            session.load({{"id", parse_string("\\t.\\f. t").value()}});
+            AssertThat(contractions(parse_string("\\x. x").value()), Equals(var("id")));
+
+            session.define("id", parse_string("\\t.\\f. t").value());
+            AssertThat(contractions(parse_string("\\x. x").value()), Equals(parse_string("\\x. x").value()));
+            AssertThat(contractions(parse_string("\\t.\\f. t").value()), Equals(var("id")));
+        });
+        it("does not name subterms that use outer binders", []() {
+            Context context {{"first", parse_string("\\p. p true").value()}};
+            Term term {parse_string("\\true. \\p. p true").value()};
+            AssertThat(simplify(term, context, {.combinators = false}), Equals(term));
+        });
+    });
+    describe("decode tests", []() {
+        it("decodes numerals and booleans", []() {
+            AssertThat(decode(parse_string("3").value()), Equals(var("3")));
+            AssertThat(decode(parse_string("0").value()), Equals(var("0")));
+            AssertThat(decode(parse_string("\\t.\\f. f").value()), Equals(var("false")));
+            AssertThat(decode(parse_string("\\a.\\b. a").value()), Equals(var("true")));
+        });
+        it("decodes nested pairs and lists", []() {
+            AssertThat(decode(parse_string("\\b. b 1 (\\t.\\f. t)").value()), Equals(var("(1, true)")));
+            AssertThat(decode(parse_string("\\b. b (\\p. p x y) 2").value()), Equals(var("((x, y), 2)")));
+            AssertThat(decode(parse_string("\\c.\\n. c 1 (c 2 n)").value()), Equals(var("[1, 2]")));
+            AssertThat(decode(parse_string("\\b. b b 2").value()), Equals(lam("b", app(app(var("b"), var("b")), var("2")))));
+        });
+        it("decodes inside other terms", []() {
+            AssertThat(decode(parse_string("f 2 (\\x. x)").value()), Equals(app(app(var("f"), var("2")), lam("x", var("x")))));
+        });
+        it("decodes inside lets and letrecs", []() {
+            AssertThat(decode(parse_string("let a = 2 in f a (\\t.\\f. f)").value()),
+                       Equals(Term {Let {Variable {"a"}, make_term(var("2")), make_term(app(app("f", "a"), var("false")))}}));
+            AssertThat(decode(parse_string("letrec g = \\x. g 3 in g").value()),
+                       Equals(Term {Letrec {Variable {"g"}, make_term(lam("x", app(var("g"), var("3")))), make_term(var("g"))}}));
+        });
+        it("accepts custom decoders", []() {
+            Decoders decoders {};
+            decoders.add("identity", [](const Term& term, const Decoders&) -> std::optional<std::string>
+            {
+                if (term == parse_string("\\x. x").value())
+                    return "id";
+                return {};
+            });
+            AssertThat(decode(parse_string("f (\\x. x)").value(), decoders), Equals(app(var("f"), var("id"))));
+        });
+    });
+    describe("print tests", []() {
+        it("uses only the parentheses the parser needs", []() {
+            AssertThat(as_string(app(app(var("f"), var("x")), var("y"))), Equals(std::string {"f x y"}));
+            AssertThat(as_string(app(var("f"), app(var("x"), var("y")))), Equals(std::string {"f (x y)"}));
+            AssertThat(as_string(app(lam("x", var("x")), lam("y", var("y")))), Equals(std::string {"(\\x.x) (\\y.y)"}));
+            AssertThat(as_string(lam("x", app(var("x"), var("x")))), Equals(std::string {"\\x.x x"}));
+        });
+        it("round trips through the parser", []() {
+            Term term {parse_string("(\\x.x x) (f (\\y.y) z) w").value()};
+            AssertThat(parse_string(as_string(term)).value(), Equals(term));
+        });
+        it("writes renamed binders so that they parse back", []() {
+            Term term {parse_string("(\\x.\\y. x (x y) (x (x y))) y").value()};
+            for (Strategy strategy : {Strategy::Tree, Strategy::Lifted, Strategy::Optimal})
+            {
+                Term reduction {*Engine {{strategy}}.reduce(term).get_ok()};
+                AssertThat(parse_string(as_string(reduction)).value(), Equals(reduction));
+
+                std::stringstream shared {};
+                print(shared, reduction, PrintOptions {.share = true});
+                AssertThat(reduce(parse_string(shared.str()).value()), Equals(reduction));
+            }
+        });
+        it("truncates long and deep output", []() {
+            Term term {app(app(var("f"), app(var("g"), app(var("h"), var("x")))), var("y"))};
+            std::stringstream shallow {};
+            AssertThat(print(shallow, term, PrintOptions {1}), IsTrue());
+            AssertThat(shallow.str(), Equals(std::string {"f (g ...) y"}));
+
+            std::stringstream short_output {};
+            AssertThat(print(short_output, term, PrintOptions {.max_length = 5}), IsFalse());
+            AssertThat(short_output.str(), Equals(std::string {"f (g ..."}));
+        });
+        it("prints deeply nested terms", []() {
+            Term term {var("z")};
+            for (int i {0}; i < 20000; ++i)
+                term = lam("x", term);
+            AssertThat(as_string(term).size(), Equals(20000u * 3 + 1));
+        });
+        it("writes repeated subterms once", []() {
+            Term term {parse_string("\\f.\\x. g (f (f x)) (f (f x))").value()};
+            AssertThat(as_string(share_subterms(term)), Equals(std::string {"\\f.\\x.let a = f (f x) in g a a"}));
+
+            // the same text means different things under different binders
+            Term apart {parse_string("h (\\x. x x x) (\\x. x x x) (\\y. x x x)").value()};
+            AssertThat(as_string(share_subterms(apart)), Equals(std::string {"let a = \\x.x x x in h a a (\\y.x x x)"}));
+        });
+        it("writes terms that only fit as graphs", []() {
+            Term term {var("x")};
+            for (int i {0}; i < 64; ++i)
+                term = app(term, term);
+
+            std::stringstream out {};
+            AssertThat(print(out, term, PrintOptions {.share = true}), IsTrue());
+            AssertThat(out.str().size() < 2000, IsTrue());
+            AssertThat(out.str().substr(0, 24), Equals(std::string {"let a = x x (x x) in let"}));
+        });
+    });
+    describe("instrumentation tests", []() {
+        it("charges numeral construction to parsing", []() {
+            instrument::enable();
+            instrument::reset();
+            parse_string("longerthanaslotinthetoken 5");
+            instrument::Report report {instrument::report()};
+            instrument::enable(false);
+            AssertThat(report[instrument::Phase::Parse].allocations > 0, IsTrue());
+            AssertThat(report[instrument::Phase::Lex].allocations > 0, IsTrue());
+            AssertThat(report[instrument::Phase::Reduce].allocations, Equals(0u));
+        });
+        it("charges lexing only for the text buffers it grows", []() {
+            Token token {};
+            std::stringstream text {"x longerthanaslotinthetoken longerthanaslotinthetoken y"};
+            instrument::PhaseScope scope {instrument::Phase::Lex};
+            instrument::enable();
+            instrument::reset();
+            lex(text, token);
+            std::size_t short_name {instrument::report()[instrument::Phase::Lex].allocations};
+            lex(text, token);
+            std::size_t grown {instrument::report()[instrument::Phase::Lex].allocations};
+            lex(text, token);
+            lex(text, token);
+            std::size_t reused {instrument::report()[instrument::Phase::Lex].allocations};
+            instrument::enable(false);
+            AssertThat(short_name, Equals(0u));
+            AssertThat(grown > 0, IsTrue());
+            AssertThat(reused, Equals(grown));
+        });
+        it("releases nodes when terms are destroyed", []() {
+            instrument::enable();
+            std::size_t before {instrument::report().live_nodes};
+            std::size_t during {};
+            {
+                Term term {app(lam("x", var("x")), var("y"))};
+                during = instrument::report().live_nodes;
+            }
+            std::size_t after {instrument::report().live_nodes};
+            instrument::enable(false);
+            AssertThat(during > before, IsTrue());
+            AssertThat(after, Equals(before));
+        });
+        it("counts nothing while tracking is off", []() {
+            instrument::enable(false);
+            std::size_t before {instrument::report().live_nodes};
+            Term term {app(lam("x", var("x")), var("y"))};
+            AssertThat(instrument::report().live_nodes, Equals(before));
+        });
+        it("shares subterms that substitution leaves alone", []() {
+            Term term {app(lam("y", var("y")), app(var("x"), var("x")))};
+            Term replacement {lam("z", app(var("z"), var("z")))};
+
+            instrument::enable();
+            std::size_t before {instrument::report().live_nodes};
+            Term result {substitute({"x", replacement}, term)};
+            std::size_t after {instrument::report().live_nodes};
+            instrument::enable(false);
+
+            // the new spine and one shared copy of the replacement
+            AssertThat(after - before, Equals(2u));
+            const Application& appl {std::get<Application>(result)};
+            AssertThat(appl.lhs == std::get<Application>(term).lhs, IsTrue());
+            AssertThat(std::get<Application>(*appl.rhs).lhs == std::get<Application>(*appl.rhs).rhs, IsTrue());
+        });
     });
 });
@@ -0,0 +1,59 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include <thread>
+
+#include "shared_tests.h"
+
+#include "helpers.h"
+#include "library.h"
+
+go_bandit([]() {
+    describe("library tests", []() {
+        it("parses definitions only when they are looked up", []() {
+            Library library {"id = \\x.x\nk = \\x.\\y.x\n"};
+            AssertThat(library.size(), Equals(2u));
+            AssertThat(library.loaded().empty(), IsTrue());
+
+            AssertThat(*library.find("k"), Equals(lam("x", lam("y", var("x")))));
+            AssertThat(library.loaded().size(), Equals(1u));
+            AssertThat(library.find("missing") == nullptr, IsTrue());
+        });
+        it("reports shape errors up front and parse errors once parsed", []() {
+            Library library {"id = \\x.x\nbad \\x.x\nworse = (x\nid = \\y.y\n"};
+            AssertThat(library.errors().size(), Equals(2u));
+
+            AssertThat(library.find("worse") == nullptr, IsTrue());
+            std::vector<LoadError> errors {library.errors()};
+            AssertThat(errors.size(), Equals(3u));
+            AssertThat(errors[1].line, Equals(3u));
+        });
+        it("loads the closure of a term's dependencies", []() {
+            Library library {"id = \\x.x\napp = \\f. id f\ntwice = \\f. app (app f)\nk = \\x.\\y.x\n"};
+            AssertThat(library.dependencies("twice"), Equals(std::vector<std::string> {"app"}));
+
+            library.load_closure({"twice"});
+            Context loaded {library.loaded()};
+            AssertThat(loaded.size(), Equals(3u));
+            AssertThat(loaded.find("k") == loaded.end(), IsTrue());
+        });
+        it("reduces through the library", []() {
+            Library library {"id = \\x.x\nk = \\x.\\y.x\n"};
+            Term term {app(app(var("k"), var("id")), var("k"))};
+            AssertThat(reduce(term, library), Equals(lam("x", var("x"))));
+        });
+        it("parses each definition once across threads", []() {
+            Library library {"k = \\x.\\y.x\n"};
+            std::vector<const Term*> found(4, nullptr);
+            std::vector<std::thread> threads {};
+            for (std::size_t i {0}; i < found.size(); ++i)
+                threads.emplace_back([&library, &found, i]() { found[i] = library.find("k"); });
+            for (std::thread& thread : threads)
+                thread.join();
+
+            for (const Term* term : found)
+                AssertThat(term, Equals(found[0]));
+        });
+    });
+});
@@ -0,0 +1,73 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include "shared_tests.h"
+
+#include "helpers.h"
+#include "lifted.h"
+#include "numerals.h"
+#include "prelude.h"
+
+static const Context prelude {get_prelude()};
+
+auto lifted_numeral(std::string term_str) -> std::optional<int>
+{
+    ReduceResult result {lifted::reduce(parse_string(term_str).value(), prelude)};
+    AssertThat(result.is_ok(), IsTrue());
+    return from_numeral(*result.get_ok());
+}
+
+go_bandit([]() {
+    describe("lifted reduction tests", []() {
+        it("compiles definitions once with their full arity", []() {
+            lifted::Program program {parse_string("times (times 2 3) 2").value(), ContextDefinitions {prelude}};
+            const lifted::Supercombinator* times {program.find("times")};
+            AssertThat(times == nullptr, IsFalse());
+            AssertThat(times->arity(), Equals(2u));
+            AssertThat(program.find("plus")->arity(), Equals(4u));
+            AssertThat(program.find("succ") == nullptr, IsTrue());
+        });
+        it("lifts inner abstractions with the variables they capture", []() {
+            lifted::Program program {parse_string("\\x. f (\\y. x y)").value(), ContextDefinitions {{}}};
+            const auto& combinators {program.supercombinators()};
+            auto inner {std::find_if(combinators.begin(), combinators.end(), [](const auto& sc)
+            {
+                return sc.params == std::vector<std::string> {"x", "y"};
+            })};
+            AssertThat(inner == combinators.end(), IsFalse());
+        });
+        it("reduces church arithmetic from the prelude", []() {
+            AssertThat(lifted_numeral("plus 2 3"), Equals(std::optional<int> {5}));
+            AssertThat(lifted_numeral("times 2 3"), Equals(std::optional<int> {6}));
+            AssertThat(lifted_numeral("times (times 10 10) 10"), Equals(std::optional<int> {1000}));
+        });
+        it("compiles and reads back deeply nested terms", []() {
+            AssertThat(lifted_numeral("succ 20000"), Equals(std::optional<int> {20001}));
+            ReduceResult result {lifted::reduce(parse_string("(\\n. n (\\x. false) true) 20000").value(), prelude)};
+            AssertThat(*result.get_ok(), Equals(prelude.find("false")->second));
+        });
+        it("unfolds large numerals one successor at a time", []() {
+            ReduceResult result {lifted::reduce(parse_string("(\\n. n (\\x. false) true) 5000000").value(), prelude)};
+            AssertThat(*result.get_ok(), Equals(prelude.find("false")->second));
+            AssertThat(lifted_numeral("5000000"), Equals(std::optional<int> {5'000'000}));
+            AssertThat(lifted_numeral("succ 100000"), Equals(std::optional<int> {100'001}));
+        });
+        it("agrees with the tree reducer", []() {
+            for (std::string term_str : {"and true false", "second (pair x y)", "\\x. x y",
+                                         "(\\x.\\y. x y) y", "(\\f.\\x. f (f x)) (\\f.\\x. f (f x))"})
+            {
+                Term term {parse_string(term_str).value()};
+                AssertThat(*lifted::reduce(term, prelude).get_ok(), Equals(reduce(term, prelude)));
+            }
+        });
+        it("does not reduce discarded arguments", []() {
+            ReduceResult result {lifted::reduce(parse_string("(\\x.\\y.y) ((\\x.x x) (\\x.x x))").value())};
+            AssertThat(*result.get_ok(), Equals(lam("y", var("y"))));
+        });
+        it("stops at the instantiation limit", []() {
+            ReduceResult result {lifted::reduce(parse_string("(\\x.x x) (\\x.x x)").value(), Context {}, 1000)};
+            AssertThat(result.is_err(), IsTrue());
+        });
+    });
+});
@@ -0,0 +1,48 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include <sstream>
+
+#include "shared_tests.h"
+
+#include "helpers.h"
+#include "loader.h"
+
+go_bandit([]() {
+    describe("loader tests", []() {
+        it("skips blank lines and keeps line numbers", []() {
+            std::vector<SourceLine> lines {split_lines("id = \\x.x\n\n  \r\nk = \\x.\\y.x\r\n")};
+            AssertThat(lines.size(), Equals(2u));
+            AssertThat(lines[1].line, Equals(4u));
+            AssertThat(std::string {lines[1].text}, Equals(std::string {"k = \\x.\\y.x"}));
+        });
+        it("reports every bad line and keeps the good ones", []() {
+            LoadResult loaded {load_definitions("id = \\x.x\nbad \\x.x\nk = \\x.\\y.x\nworse = (x\n")};
+            AssertThat(loaded.context.size(), Equals(2u));
+            AssertThat(loaded.errors.size(), Equals(2u));
+            AssertThat(loaded.errors[0].line, Equals(2u));
+            AssertThat(loaded.errors[1].line, Equals(4u));
+        });
+        it("reports duplicate definitions", []() {
+            LoadResult loaded {load_definitions("id = \\x.x\nid = \\y.y\n")};
+            AssertThat(loaded.errors.size(), Equals(1u));
+            AssertThat(loaded.errors[0].line, Equals(2u));
+            AssertThat(loaded.context.find("id")->second, Equals(lam("x", var("x"))));
+        });
+        it("parses large files in parallel", []() {
+            std::stringstream source {};
+            for (int i {0}; i < 5000; ++i)
+                source << "def" << char('a' + i % 26) << char('a' + i / 26 % 26) << char('a' + i / 676)
+                       << " = \\x.\\y. x y" << std::endl;
+            LoadResult loaded {load_definitions(source.str(), 4)};
+            AssertThat(loaded.errors.empty(), IsTrue());
+            AssertThat(loaded.context.size(), Equals(5000u));
+        });
+        it("reports files that cannot be opened", []() {
+            LoadResult loaded {load_file("does/not/exist.lam")};
+            AssertThat(loaded.errors.size(), Equals(1u));
+            AssertThat(loaded.errors[0].line, Equals(0u));
+        });
+    });
+});
@@ -0,0 +1,74 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include "shared_tests.h"
+
+#include "helpers.h"
+#include "numerals.h"
+#include "optimal.h"
+#include "prelude.h"
+
+static const Context prelude {get_prelude()};
+
+auto optimal_numeral(std::string term_str) -> std::optional<int>
+{
+    optimal::ReduceResult result {optimal::reduce(parse_string(term_str).value(), prelude)};
+    AssertThat(result.is_ok(), IsTrue());
+    return from_numeral(*result.get_ok());
+}
+
+go_bandit([]() {
+    describe("optimal reduction tests", []() {
+        it("reduces church arithmetic from the prelude", []() {
+            AssertThat(optimal_numeral("plus 2 3"), Equals(std::optional<int> {5}));
+            AssertThat(optimal_numeral("times 2 3"), Equals(std::optional<int> {6}));
+            AssertThat(optimal_numeral("times (times 10 10) 10"), Equals(std::optional<int> {1000}));
+        });
+        it("builds numerals in unary only up to a limit", []() {
+            optimal::ReduceResult result {optimal::reduce(parse_string("(\\n. n (\\x. false) true) 100000").value(),
+                                                          prelude)};
+            AssertThat(*result.get_ok(), Equals(prelude.find("false")->second));
+            result = optimal::reduce(parse_string("(\\n. n (\\x. false) true) 5000000").value(), prelude);
+            AssertThat(*result.get_err(), Equals(std::string {"Numeral 5000000 is too large to expand"}));
+        });
+        it("reads back large numerals in time linear in their size", []() {
+            AssertThat(optimal_numeral("100000"), Equals(std::optional<int> {100000}));
+            AssertThat(optimal_numeral("succ 70000"), Equals(std::optional<int> {70001}));
+            AssertThat(optimal_numeral("plus 70000 70000"), Equals(std::optional<int> {140000}));
+        });
+        it("reads back booleans and free variables", []() {
+            optimal::ReduceResult result {optimal::reduce(parse_string("and true false").value(), prelude)};
+            AssertThat(*result.get_ok(), Equals(prelude.find("false")->second));
+            result = optimal::reduce(parse_string("second (pair x y)").value(), prelude);
+            AssertThat(*result.get_ok(), Equals(var("y")));
+        });
+        it("does not reduce discarded arguments", []() {
+            optimal::ReduceResult result {optimal::reduce(parse_string("(\\x.\\y.y) ((\\x.x x) (\\x.x x))").value())};
+            AssertThat(*result.get_ok(), Equals(lam("y", var("y"))));
+        });
+        it("keeps bound names distinct after duplication", []() {
+            optimal::ReduceResult result {optimal::reduce(parse_string("(\\f.\\x. f (f x)) (\\f.\\x. f (f x))").value())};
+            AssertThat(from_numeral(*result.get_ok()), Equals(std::optional<int> {4}));
+        });
+        it("pairs up copies of shared arguments", []() {
+            AssertThat(optimal_numeral("(\\a. times a a) (plus 2 3)"), Equals(std::optional<int> {25}));
+            AssertThat(optimal_numeral("let a = plus 2 3 in times a a"), Equals(std::optional<int> {25}));
+            AssertThat(optimal_numeral("(\\a. a a) 2"), Equals(std::optional<int> {4}));
+            AssertThat(optimal_numeral("(\\t. t t t) 2"), Equals(std::optional<int> {16}));
+        });
+        it("counts only beta reductions and duplications against the limit", []() {
+            AssertThat(optimal_numeral("succ 999"), Equals(std::optional<int> {1000}));
+            AssertThat(optimal_numeral("times 100 100"), Equals(std::optional<int> {10000}));
+
+            optimal::Stats stats {};
+            optimal::ReduceResult result {optimal::reduce(parse_string("times 1000 3").value(), prelude, 10'000'000, &stats)};
+            AssertThat(from_numeral(*result.get_ok()), Equals(std::optional<int> {3000}));
+            AssertThat(stats.interactions < stats.bookkeeping, IsTrue());
+        });
+        it("stops at the interaction limit", []() {
+            optimal::ReduceResult result {optimal::reduce(parse_string("(\\x.x x) (\\x.x x)").value(), {}, 1000)};
+            AssertThat(result.is_err(), IsTrue());
+        });
+    });
+});
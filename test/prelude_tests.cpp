@@ -6,6 +6,7 @@
 
 #include "prelude.h"
 #include "helpers.h"
+#include "numerals.h"
 
 static const Context prelude {get_prelude()};
 
@@ -27,5 +28,14 @@ go_bandit([]() {
             run_test("and true false", fls);
             run_test("and false true", fls);
         });
+        it("times 2 3 == 6", []() {
+            Term actual {reduce(parse_string("times 2 3").value(), prelude)};
+            AssertThat(from_numeral(actual), Equals(std::optional<int> {6}));
+        });
+        it("evaluate stops at an abstraction", []() {
+            EvalResult result {evaluate(parse_string("first (pair (\\y. (\\z.z) y) x)").value(), prelude)};
+            AssertThat(result.is_ok(), IsTrue());
+            AssertThat(compare(*result.get_ok()->body, app(lam("z", var("z")), var("y"))), IsTrue());
+        });
     });
 });
\ No newline at end of file
@@ -0,0 +1,132 @@
+//
+// Created by colin on 10/19/26.
+//
+
+#include <cstring>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "shared_tests.h"
+
+#include "server.h"
+
+static const Library library {"true = \\t.\\f. t\nfalse = \\t.\\f. f\npair = \\f.\\s.\\b. b f s\n"
+                              "plus = \\m.\\n.\\s.\\z. m s (n s z)\n"};
+
+auto connect_to(const std::string& path) -> int
+{
+    int fd {::socket(AF_UNIX, SOCK_STREAM, 0)};
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    // the server may still be starting up
+    for (int attempt {0}; ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0; ++attempt)
+    {
+        AssertThat(attempt < 100, IsTrue());
+        std::this_thread::sleep_for(std::chrono::milliseconds {10});
+    }
+    return fd;
+}
+
+auto round_trip(const std::string& path, const std::string& requests) -> std::string
+{
+    int fd {connect_to(path)};
+    ::send(fd, requests.data(), requests.size(), 0);
+    ::shutdown(fd, SHUT_WR);
+
+    std::string received {};
+    char buffer[256];
+    ssize_t n;
+    while ((n = ::recv(fd, buffer, sizeof(buffer), 0)) > 0)
+        received.append(buffer, static_cast<std::size_t>(n));
+    ::close(fd);
+    return received;
+}
+
+go_bandit([]() {
+    describe("server tests", []() {
+        it("answers requests with results and errors", []() {
+            Server server {library, {}};
+            AssertThat(server.handle("plus 2 3"), Equals(std::string {"ok 5"}));
+            AssertThat(server.handle("pair 1 true"), Equals(std::string {"ok (1, true)"}));
+            AssertThat(server.handle("(x").starts_with("err parse error"), IsTrue());
+            AssertThat(server.handle("@colour=red x").starts_with("err unknown option"), IsTrue());
+        });
+        it("answers requests that can't be carried out with errors", []() {
+            Server server {library, {}};
+            AssertThat(server.handle("@limit=99999999999999999999999 x").starts_with("err unknown option"), IsTrue());
+            AssertThat(server.handle("@limit=12abc x").starts_with("err unknown option"), IsTrue());
+            AssertThat(server.handle("@strategy=tree @limit=100000 (\\x.x x) (\\x.x x)"),
+                       Equals(std::string {"err Reduction limit exceeded"}));
+        });
+        it("applies per-request options", []() {
+            Server server {library, {}};
+            AssertThat(server.handle("@strategy=lifted plus 1 1"), Equals(std::string {"ok 2"}));
+            AssertThat(server.handle("@target=whnf (\\x.\\y. (\\z.z) y) a"), Equals(std::string {"ok \\y.(\\z.z) y"}));
+            AssertThat(server.handle("@limit=10 (\\x.x x) (\\x.x x)").starts_with("err"), IsTrue());
+        });
+        it("serves several clients over a socket", []() {
+            std::string path {"/tmp/lambda_server_test_" + std::to_string(::getpid())};
+            Server server {library, {path, 2}};
+            std::thread running {[&server]() { server.run(); }};
+
+            std::vector<std::string> responses(4);
+            std::vector<std::thread> clients {};
+            for (std::size_t i {0}; i < responses.size(); ++i)
+                clients.emplace_back([&path, &responses, i]() { responses[i] = round_trip(path, "plus 1 2\nfalse\n"); });
+            for (std::thread& client : clients)
+                client.join();
+
+            server.stop();
+            running.join();
+            for (const std::string& response : responses)
+                AssertThat(response, Equals(std::string {"ok 3\nok false\n"}));
+        });
+        it("keeps answering while a client is connected but idle", []() {
+            std::string path {"/tmp/lambda_server_test_idle_" + std::to_string(::getpid())};
+            Server server {library, {path, 1}};
+            std::thread running {[&server]() { server.run(); }};
+
+            int idle {connect_to(path)};
+            std::string response {round_trip(path, "plus 1 2\n")};
+
+            // stopping doesn't wait for the idle client either
+            server.stop();
+            running.join();
+            ::close(idle);
+            AssertThat(response, Equals(std::string {"ok 3\n"}));
+        });
+        it("answers a request line that is too long with an error", []() {
+            std::string path {"/tmp/lambda_server_test_long_" + std::to_string(::getpid())};
+            ServerOptions options {path, 1};
+            options.max_request = 64;
+            Server server {library, options};
+            std::thread running {[&server]() { server.run(); }};
+
+            std::string response {round_trip(path, "plus 1 2\n" + std::string(10'000, 'x'))};
+            server.stop();
+            running.join();
+            AssertThat(response, Equals(std::string {"ok 3\nerr request too long\n"}));
+        });
+        it("abandons evaluations when the client hangs up", []() {
+            std::string path {"/tmp/lambda_server_test_hangup_" + std::to_string(::getpid())};
+            Server server {library, {path, 1}};
+            std::thread running {[&server]() { server.run(); }};
+
+            // would keep the only worker busy for a long time if it ran to the limit
+            int fd {connect_to(path)};
+            std::string request {"@strategy=optimal @limit=1000000000000 (\\x.x x) (\\x.x x)\n"};
+            ::send(fd, request.data(), request.size(), 0);
+            ::close(fd);
+
+            std::string response {round_trip(path, "plus 1 2\n")};
+            server.stop();
+            running.join();
+            AssertThat(response, Equals(std::string {"ok 3\n"}));
+        });
+    });
+});